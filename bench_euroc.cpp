@@ -0,0 +1,942 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "src/database/Frame.h"
+#include "src/database/Feature.h"
+#include "src/database/SlidingWindowMap.h"
+#include "src/module/DisparityEstimator.h"
+#include "src/module/FeatureTracker.h"
+#include "src/dataset/Calibration.h"
+#include "src/dataset/DatasetReader.h"
+#include "src/dataset/GroundTruth.h"
+#include "src/module/FrontendPipeline.h"
+#include "src/module/PoseEstimator.h"
+#include "src/module/SlidingWindowOptimizer.h"
+#include "src/util/ExternalAllocationScope.h"
+#include "src/util/ImagePool.h"
+#include "src/util/Logger.h"
+#include "src/util/Profiler.h"
+#include "src/util/StereoRectifier.h"
+
+using namespace lightweight_vio;
+
+// Allocation-counting hooks, process-wide: the tracker's pool workers
+// allocate too. operator new and cv::Mat buffers (which come from
+// cv::fastMalloc through the Mat allocator) are both counted, once each.
+// Whatever a thread allocates inside an ExternalAllocationScope, i.e. inside
+// an OpenCV call, is counted apart as OpenCV's own.
+static std::atomic<size_t> g_allocations{0};
+static std::atomic<size_t> g_external_allocations{0};
+static thread_local bool t_in_mat_allocator = false;  // Its UMatData new is part of the buffer
+
+static void count_allocation() {
+    if (t_in_mat_allocator) return;
+    if (ExternalAllocationScope::is_active()) {
+        g_external_allocations.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void* operator new(std::size_t size) {
+    count_allocation();
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return ::operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    count_allocation();
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return ::operator new(size, tag); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+// Default cv::Mat allocator: counts each new buffer, then defers to OpenCV's
+class CountingMatAllocator : public cv::MatAllocator {
+public:
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage_flags) const override {
+        if (!data) count_allocation();  // User data is wrapped, not allocated
+        t_in_mat_allocator = true;
+        cv::UMatData* u = cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step, flags, usage_flags);
+        t_in_mat_allocator = false;
+        return u;
+    }
+    bool allocate(cv::UMatData* data, cv::AccessFlag access_flags, cv::UMatUsageFlags usage_flags) const override {
+        return cv::Mat::getStdAllocator()->allocate(data, access_flags, usage_flags);
+    }
+    void deallocate(cv::UMatData* data) const override {
+        cv::Mat::getStdAllocator()->deallocate(data);
+    }
+};
+
+// --check-allocations without --max-frames: the frames are all held decoded at once
+constexpr size_t CHECK_ALLOCATIONS_FRAMES = 200;
+
+// Per-stage latency samples in milliseconds
+class StageTimings {
+public:
+    void add(const std::string& stage, double ms) {
+        if (m_samples.find(stage) == m_samples.end()) {
+            m_order.push_back(stage);
+        }
+        m_samples[stage].push_back(ms);
+    }
+
+    void write_json(std::ostream& os) const {
+        os << "{";
+        for (size_t i = 0; i < m_order.size(); ++i) {
+            std::vector<double> sorted = m_samples.at(m_order[i]);
+            std::sort(sorted.begin(), sorted.end());
+
+            double sum = 0.0;
+            for (double v : sorted) sum += v;
+
+            os << (i ? ", " : "") << "\"" << m_order[i] << "\": {"
+               << "\"count\": " << sorted.size()
+               << ", \"mean_ms\": " << (sorted.empty() ? 0.0 : sum / sorted.size())
+               << ", \"p50_ms\": " << percentile(sorted, 0.50)
+               << ", \"p95_ms\": " << percentile(sorted, 0.95)
+               << ", \"p99_ms\": " << percentile(sorted, 0.99)
+               << ", \"max_ms\": " << (sorted.empty() ? 0.0 : sorted.back())
+               << "}";
+        }
+        os << "}";
+    }
+
+private:
+    // Nearest-rank percentile of an ascending sample vector
+    static double percentile(const std::vector<double>& sorted, double q) {
+        if (sorted.empty()) return 0.0;
+        size_t rank = static_cast<size_t>(std::ceil(q * sorted.size()));
+        rank = std::max<size_t>(rank, 1);
+        return sorted[std::min(rank, sorted.size()) - 1];
+    }
+
+    std::vector<std::string> m_order;
+    std::map<std::string, std::vector<double>> m_samples;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start,
+                  std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// EuRoC cam0/cam1 rig (sensor.yaml): stereo baseline [m] and cam0 focal length [px],
+// for depth when the calibration is not loaded
+constexpr float EUROC_BASELINE = 0.110078f;
+constexpr float EUROC_FOCAL_LENGTH = 458.654f;
+
+struct BenchResult {
+    StageTimings timings;
+    size_t frames_processed = 0;
+    size_t frames_skipped = 0;
+    double processing_ms = 0.0;   // Sum of per-frame processing time (serial mode)
+    long long total_features = 0;
+    long long total_tracked = 0;
+    long long total_stereo_matches = 0;
+    long long total_depth = 0;
+    long long total_track_length = 0;   // Sum of track counts (frames each feature has been seen)
+    double total_occupied_cells = 0.0;  // Fraction of DISTRIBUTION_GRID cells holding a feature
+    double image_bytes_copied = 0.0;    // Pixels copied into frames (serial mode, --copy-images)
+    size_t map_peak_bytes = 0;          // Largest SlidingWindowMap footprint seen
+
+    // Camera pose of every processed frame (in the first frame's camera)
+    struct TrajectorySample {
+        long long timestamp;
+        Eigen::Matrix4d pose;
+    };
+    std::vector<TrajectorySample> trajectory;
+    // Keyframe poses as the sliding-window optimizer last left them
+    std::map<long long, Eigen::Matrix4d> backend_poses;
+    long long backend_iterations = 0;
+    long long backend_landmarks = 0;
+    size_t backend_solves = 0;
+
+    // Allocations per frame after warm-up (serial mode): the project's own in
+    // track_features, OpenCV's inside it, and everything in the stereo stage
+    static constexpr size_t ALLOC_WARMUP_FRAMES = 10;
+    std::vector<size_t> track_allocations;
+    std::vector<size_t> track_opencv_allocations;
+    std::vector<size_t> stereo_allocations;
+
+    void add_allocations(size_t track, size_t track_opencv, size_t stereo) {
+        if (frames_processed < ALLOC_WARMUP_FRAMES) return;
+        track_allocations.push_back(track);
+        track_opencv_allocations.push_back(track_opencv);
+        stereo_allocations.push_back(stereo);
+    }
+
+    static void write_allocations_json(std::ostream& os, const std::vector<size_t>& samples) {
+        size_t total = 0;
+        size_t max_count = 0;
+        for (size_t count : samples) {
+            total += count;
+            max_count = std::max(max_count, count);
+        }
+        os << "{\"mean_per_frame\": " << (samples.empty() ? 0.0 : static_cast<double>(total) / samples.size())
+           << ", \"max_per_frame\": " << max_count << "}";
+    }
+
+    // Coarse grid used to score how evenly features cover the image
+    static constexpr int DISTRIBUTION_GRID_COLS = 8;
+    static constexpr int DISTRIBUTION_GRID_ROWS = 6;
+
+    void add_frame(const Frame& frame) {
+        TrajectorySample sample;
+        sample.timestamp = frame.get_timestamp();
+        sample.pose.setIdentity();
+        sample.pose.topLeftCorner<3, 3>() = frame.get_rotation().cast<double>();
+        sample.pose.topRightCorner<3, 1>() = frame.get_translation().cast<double>();
+        trajectory.push_back(sample);
+
+        const cv::Size size = frame.get_image().size();
+        std::vector<uchar> occupied(DISTRIBUTION_GRID_COLS * DISTRIBUTION_GRID_ROWS, 0);
+        for (const auto& feature : frame.get_features()) {
+            if (feature->get_track_count() > 1) total_tracked++;
+            total_track_length += feature->get_track_count();
+            if (feature->has_stereo_match()) total_stereo_matches++;
+            if (feature->get_depth() > 0.0f) total_depth++;
+
+            const cv::Point2f& pt = feature->get_pixel_coord();
+            if (size.width > 0 && size.height > 0 && pt.x >= 0 && pt.y >= 0 && pt.x < size.width && pt.y < size.height) {
+                int cx = static_cast<int>(pt.x) * DISTRIBUTION_GRID_COLS / size.width;
+                int cy = static_cast<int>(pt.y) * DISTRIBUTION_GRID_ROWS / size.height;
+                occupied[cy * DISTRIBUTION_GRID_COLS + cx] = 1;
+            }
+        }
+        total_occupied_cells += static_cast<double>(std::count(occupied.begin(), occupied.end(), 1)) / occupied.size();
+        total_features += frame.get_feature_count();
+        frames_processed++;
+    }
+};
+
+// Stereo / frame handling shared by both run modes
+struct RunOptions {
+    bool rectified = false;
+    bool stereo_reuse = true;
+    DisparityEstimator* dense = nullptr;  // Not owned; null = no dense disparity
+    bool copy_images = false;             // Serial mode: clone images into the frame (old behaviour)
+    SlidingWindowMap* map = nullptr;      // Not owned; null = no map
+    PoseEstimator* pose = nullptr;        // Not owned; null = frames keep the identity pose
+    SlidingWindowOptimizer* backend = nullptr;  // Not owned; null = no bundle adjustment
+    bool preload = false;                 // Serial mode: decode every frame before tracking starts
+    size_t queue_capacity = 4;            // Pipelined mode: capacity of each stage queue
+};
+
+// Keyframes only (every frame with --all-keyframes), then bundle adjustment
+// over the map's window
+void insert_into_map(const RunOptions& options, const Frame& frame, BenchResult& result) {
+    if (!options.map || !frame.is_keyframe()) return;
+    if (!options.map->insert_keyframe(frame)) return;
+    result.map_peak_bytes = std::max(result.map_peak_bytes, options.map->get_memory_bytes());
+    if (!options.backend) return;
+
+    const SlidingWindowOptimizer::Result solve = options.backend->optimize(*options.map);
+    result.timings.add("backend", solve.solve_ms);
+    result.backend_iterations += solve.iterations;
+    result.backend_landmarks += solve.landmarks;
+    result.backend_solves++;
+    for (size_t i = 0; i < options.backend->get_keyframe_count(); ++i) {
+        result.backend_poses[options.backend->get_keyframe_timestamp(i)] = options.backend->get_keyframe_pose(i);
+    }
+}
+
+// Track -> stereo -> depth back-to-back on this thread. With preload, every
+// frame is decoded before tracking starts.
+void run_serial(DatasetReader& reader, FeatureTracker& tracker, const StereoCamera& stereo,
+                const RunOptions& options, BenchResult& result) {
+    std::shared_ptr<Frame> previous_frame = nullptr;
+    std::shared_ptr<Frame> previous_keyframe = nullptr;  // Stereo reuse source
+    cv::Mat disparity;  // Reused across frames
+    reader.start(0);
+
+    // Preloaded, the reader's workers have exited before the first frame is
+    // tracked, so the process-wide allocation counters see tracking alone
+    std::vector<StereoImageData> preloaded;
+    size_t next_preloaded = 0;
+    if (options.preload) {
+        StereoImageData data;
+        while (reader.pop(data)) {
+            preloaded.push_back(std::move(data));
+        }
+        reader.stop();
+    }
+    auto next_frame = [&](StereoImageData& data) {
+        if (!options.preload) {
+            return reader.pop(data);
+        }
+        if (next_preloaded == preloaded.size()) {
+            return false;
+        }
+        data = std::move(preloaded[next_preloaded++]);
+        return true;
+    };
+
+    StereoImageData stereo_data;
+    while (true) {
+        // Decoding and CLAHE run on the reader's workers; this only waits for a ready pair
+        auto load_start = std::chrono::steady_clock::now();
+        if (!next_frame(stereo_data)) {
+            break;
+        }
+        auto load_end = std::chrono::steady_clock::now();
+
+        if (stereo_data.left_image.empty()) {
+            result.frames_skipped++;
+            continue;
+        }
+
+        // The popped images are ours alone: move them into the frame unless
+        // the copying path is being measured
+        auto frame_start = std::chrono::steady_clock::now();
+        auto current_frame = std::make_shared<Frame>(stereo_data.timestamp, static_cast<int>(stereo_data.index));
+        if (options.copy_images) {
+            result.image_bytes_copied += stereo_data.left_image.total() * stereo_data.left_image.elemSize() +
+                                         stereo_data.right_image.total() * stereo_data.right_image.elemSize();
+            if (!stereo_data.right_image.empty()) {
+                current_frame->set_stereo_images(stereo_data.left_image, stereo_data.right_image);
+            } else {
+                current_frame->set_left_image(stereo_data.left_image);
+            }
+        } else if (!stereo_data.right_image.empty()) {
+            current_frame->set_stereo_images(std::move(stereo_data.left_image), std::move(stereo_data.right_image));
+        } else {
+            current_frame->set_left_image(std::move(stereo_data.left_image));
+        }
+
+        const size_t allocs_start = g_allocations.load();
+        const size_t external_start = g_external_allocations.load();
+        auto track_start = std::chrono::steady_clock::now();
+        tracker.track_features(current_frame, previous_frame);
+        auto track_end = std::chrono::steady_clock::now();
+        const size_t allocs_track_end = g_allocations.load();
+        const size_t external_track_end = g_external_allocations.load();
+
+        // Stereo, depth and dense disparity on keyframes only
+        if (current_frame->is_keyframe() && current_frame->is_stereo()) {
+            const Frame* reuse_from = options.stereo_reuse ? previous_keyframe.get() : nullptr;
+            if (options.rectified) {
+                current_frame->compute_stereo_matches_rectified(ScanlineStereoParams(), reuse_from);
+            } else {
+                current_frame->compute_stereo_matches(reuse_from);
+            }
+            if (stereo.is_valid()) {
+                current_frame->estimate_depth_from_stereo(stereo);
+            } else {
+                current_frame->estimate_depth_from_stereo(EUROC_BASELINE, EUROC_FOCAL_LENGTH);
+            }
+            if (options.dense && options.rectified &&
+                current_frame->compute_disparity_map(*options.dense, disparity)) {
+                current_frame->estimate_depth_from_disparity(disparity, stereo);
+            }
+            previous_keyframe = current_frame;
+        }
+        auto stereo_end = std::chrono::steady_clock::now();
+        result.add_allocations(allocs_track_end - allocs_start, external_track_end - external_start,
+                               g_allocations.load() + g_external_allocations.load() -
+                                   allocs_track_end - external_track_end);
+        if (options.pose) {
+            options.pose->process(*current_frame);
+        }
+        auto pose_end = std::chrono::steady_clock::now();
+
+        result.timings.add("load_wait", elapsed_ms(load_start, load_end));
+        result.timings.add("frame_images", elapsed_ms(frame_start, track_start));
+        result.timings.add("track_features", elapsed_ms(track_start, track_end));
+        result.timings.add("stereo_matching", elapsed_ms(track_end, stereo_end));
+        if (options.pose) {
+            result.timings.add("pose", elapsed_ms(stereo_end, pose_end));
+        }
+        result.timings.add("frame_total", elapsed_ms(track_start, pose_end));
+        result.timings.add(current_frame->is_keyframe() ? "keyframe_total" : "non_keyframe_total",
+                           elapsed_ms(track_start, pose_end));
+        result.processing_ms += elapsed_ms(track_start, pose_end);
+        result.add_frame(*current_frame);
+        insert_into_map(options, *current_frame, result);
+
+        previous_frame = current_frame;
+        Profiler::instance().collect();
+    }
+}
+
+// Each stage on its own worker; per-stage latencies come from the profiler
+void run_pipelined(DatasetReader& reader, FeatureTracker& tracker, const StereoCamera& stereo,
+                   const RunOptions& options, BenchResult& result) {
+    FrontendPipeline pipeline(reader, tracker);
+    pipeline.set_queue_capacity(options.queue_capacity);
+    pipeline.set_stereo_camera(stereo);
+    pipeline.set_stereo_parameters(EUROC_BASELINE, EUROC_FOCAL_LENGTH);  // Used while the camera is invalid
+    pipeline.set_rectified_stereo(options.rectified);
+    pipeline.set_stereo_reuse(options.stereo_reuse);
+    pipeline.set_disparity_estimator(options.dense);
+    pipeline.set_pose_estimator(options.pose);
+    pipeline.start();
+
+    FrontendResult output;
+    auto last_output = std::chrono::steady_clock::now();
+    while (pipeline.pop(output)) {
+        auto now = std::chrono::steady_clock::now();
+        result.timings.add("frame_latency", (output.end_ns - output.start_ns) * 1e-6);
+        result.timings.add("frame_interval", elapsed_ms(last_output, now));
+        last_output = now;
+
+        result.add_frame(*output.frame);
+        insert_into_map(options, *output.frame, result);
+        Profiler::instance().collect();
+    }
+
+    result.frames_skipped = pipeline.get_skipped_frames();
+}
+
+// Estimated trajectory against EuRoC ground truth. The estimate lives in the
+// first frame's camera; it is anchored at that camera's ground-truth pose with
+// no further alignment (stereo depth gives metric scale).
+struct TrajectoryError {
+    size_t frames = 0;            // Frames with ground truth
+    double ate_rmse_m = 0.0;      // Absolute position error
+    double final_error_m = 0.0;
+    double path_length_m = 0.0;   // Ground-truth distance travelled
+    double rpe_mean_m = 0.0;      // Frame-to-frame translation error
+    double rpe_rot_mean_deg = 0.0;
+};
+
+bool evaluate_trajectory(const std::vector<BenchResult::TrajectorySample>& trajectory,
+                         const std::vector<GroundTruthPose>& groundtruth, const Eigen::Matrix4d& body_T_camera,
+                         TrajectoryError& error) {
+    error = TrajectoryError();
+    Eigen::Matrix4d anchor, previous_gt, previous_est;
+    double ate_sum = 0.0, rpe_sum = 0.0, rpe_rot_sum = 0.0;
+    for (const BenchResult::TrajectorySample& sample : trajectory) {
+        Eigen::Matrix4d world_T_body;
+        if (!interpolate_groundtruth(groundtruth, sample.timestamp, world_T_body)) continue;
+        const Eigen::Matrix4d gt = world_T_body * body_T_camera;
+        if (error.frames == 0) {
+            anchor = gt * sample.pose.inverse();
+        }
+        const Eigen::Matrix4d est = anchor * sample.pose;
+        const double position_error = (gt.topRightCorner<3, 1>() - est.topRightCorner<3, 1>()).norm();
+        ate_sum += position_error * position_error;
+        error.final_error_m = position_error;
+
+        if (error.frames > 0) {
+            const Eigen::Matrix4d gt_step = previous_gt.inverse() * gt;
+            const Eigen::Matrix4d est_step = previous_est.inverse() * est;
+            error.path_length_m += gt_step.topRightCorner<3, 1>().norm();
+            rpe_sum += (gt_step.topRightCorner<3, 1>() - est_step.topRightCorner<3, 1>()).norm();
+            const Eigen::Matrix3d rotation_error =
+                gt_step.topLeftCorner<3, 3>().transpose() * est_step.topLeftCorner<3, 3>();
+            rpe_rot_sum += Eigen::AngleAxisd(rotation_error).angle() * 180.0 / M_PI;
+        }
+        previous_gt = gt;
+        previous_est = est;
+        error.frames++;
+    }
+    if (error.frames < 2) {
+        return false;
+    }
+    error.ate_rmse_m = std::sqrt(ate_sum / error.frames);
+    error.rpe_mean_m = rpe_sum / (error.frames - 1);
+    error.rpe_rot_mean_deg = rpe_rot_sum / (error.frames - 1);
+    return true;
+}
+
+// TUM format: timestamp[s] tx ty tz qx qy qz qw
+bool write_trajectory(const std::string& path, const std::vector<BenchResult::TrajectorySample>& trajectory) {
+    std::ofstream file(path);
+    if (!file.is_open()) return false;
+    file.precision(9);
+    for (const BenchResult::TrajectorySample& sample : trajectory) {
+        const Eigen::Quaterniond q(Eigen::Matrix3d(sample.pose.topLeftCorner<3, 3>()));
+        file << std::fixed << sample.timestamp * 1e-9 << " " << sample.pose(0, 3) << " " << sample.pose(1, 3)
+             << " " << sample.pose(2, 3) << " " << q.x() << " " << q.y() << " " << q.z() << " " << q.w() << "\n";
+    }
+    return true;
+}
+
+void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <euroc_dataset_path> [--max-frames N] [--output result.json]"
+              << " [--trace trace.json] [--log-level debug|info|warn|error|off]"
+              << " [--decode-threads N] [--queue-capacity N] [--pipeline] [--legacy-detector]"
+              << " [--detect-threads N] [--fb-check PX] [--no-motion-prediction]"
+              << " [--sparse-lk] [--opencv-ransac] [--uncalibrated] [--exact-undistort] [--rectify]"
+              << " [--no-stereo-reuse] [--dense-disparity bm|sgm] [--dense-half] [--copy-images] [--no-image-pool]"
+              << " [--fused-preprocess] [--map-window N] [--all-keyframes] [--no-pose] [--trajectory poses.txt]"
+              << " [--backend N] [--check-allocations]"
+              << std::endl;
+    std::cerr << "Example: " << program << " /path/to/MH_01_easy --output bench.json" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return -1;
+    }
+
+    std::string dataset_path = argv[1];
+    std::string output_path;
+    std::string trace_path;
+    size_t max_frames = 0; // 0 = whole sequence
+    int decode_threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+    size_t queue_capacity = 8;
+    bool pipelined = false;
+    bool check_allocations = false;
+    bool legacy_detector = false;
+    size_t detect_threads = 0;
+    bool detect_threads_given = false;
+    float fb_threshold = 0.0f;  // 0 = forward-backward check off
+    bool motion_prediction = true;
+    bool sparse_lk = false;
+    bool opencv_ransac = false;
+    bool calibrated = true;
+    bool undistort_grid = true;
+    bool rectify = false;
+    bool stereo_reuse = true;
+    std::string dense_mode;  // Empty = no dense disparity
+    bool dense_half = false;
+    bool copy_images = false;
+    bool image_pool = true;
+    bool fused_preprocess = false;
+    size_t map_window = 10;  // 0 = no sliding-window map
+    bool keyframe_selection = true;
+    bool estimate_pose = true;
+    std::string trajectory_path;
+    int backend_window = 0;  // 0 = no bundle adjustment
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--max-frames" && i + 1 < argc) {
+            max_frames = std::stoul(argv[++i]);
+        } else if (arg == "--output" && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (arg == "--decode-threads" && i + 1 < argc) {
+            decode_threads = std::stoi(argv[++i]);
+        } else if (arg == "--queue-capacity" && i + 1 < argc) {
+            queue_capacity = std::max<size_t>(1, std::stoul(argv[++i]));  // As the queues clamp it
+        } else if (arg == "--pipeline") {
+            pipelined = true;
+        } else if (arg == "--check-allocations") {
+            check_allocations = true;
+        } else if (arg == "--legacy-detector") {
+            legacy_detector = true;
+        } else if (arg == "--detect-threads" && i + 1 < argc) {
+            detect_threads = std::stoul(argv[++i]);
+            detect_threads_given = true;
+        } else if (arg == "--fb-check" && i + 1 < argc) {
+            fb_threshold = std::stof(argv[++i]);
+        } else if (arg == "--opencv-ransac") {
+            opencv_ransac = true;
+        } else if (arg == "--uncalibrated") {
+            calibrated = false;
+        } else if (arg == "--exact-undistort") {
+            undistort_grid = false;
+        } else if (arg == "--rectify") {
+            rectify = true;
+        } else if (arg == "--no-stereo-reuse") {
+            stereo_reuse = false;
+        } else if (arg == "--dense-disparity" && i + 1 < argc) {
+            dense_mode = argv[++i];
+            if (dense_mode != "bm" && dense_mode != "sgm") {
+                print_usage(argv[0]);
+                return -1;
+            }
+        } else if (arg == "--dense-half") {
+            dense_half = true;
+        } else if (arg == "--copy-images") {
+            copy_images = true;
+        } else if (arg == "--no-image-pool") {
+            image_pool = false;
+        } else if (arg == "--fused-preprocess") {
+            fused_preprocess = true;
+        } else if (arg == "--map-window" && i + 1 < argc) {
+            map_window = std::stoul(argv[++i]);
+        } else if (arg == "--all-keyframes") {
+            keyframe_selection = false;
+        } else if (arg == "--no-pose") {
+            estimate_pose = false;
+        } else if (arg == "--trajectory" && i + 1 < argc) {
+            trajectory_path = argv[++i];
+        } else if (arg == "--backend" && i + 1 < argc) {
+            backend_window = std::stoi(argv[++i]);
+        } else if (arg == "--sparse-lk") {
+            sparse_lk = true;
+        } else if (arg == "--no-motion-prediction") {
+            motion_prediction = false;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc) {
+            LogLevel level;
+            if (!Logger::parse_level(argv[++i], level)) {
+                print_usage(argv[0]);
+                return -1;
+            }
+            Logger::set_level(level);
+        } else {
+            print_usage(argv[0]);
+            return -1;
+        }
+    }
+
+    // Allocation check: serial, with every frame decoded up front (so the
+    // default length is capped) and OpenCV's internal parallelism off, so
+    // its work stays on the thread that marked the call as OpenCV's
+    if (check_allocations) {
+        if (pipelined) {
+            std::cerr << "--check-allocations runs in serial mode only" << std::endl;
+            return -1;
+        }
+        if (max_frames == 0) {
+            max_frames = CHECK_ALLOCATIONS_FRAMES;
+        }
+        cv::setNumThreads(0);
+    }
+    static CountingMatAllocator mat_allocator;
+    cv::Mat::setDefaultAllocator(&mat_allocator);
+
+    // Pose estimation needs the normalized coordinates of a calibrated tracker
+    if (!calibrated) {
+        estimate_pose = false;
+    }
+
+    // cam0/cam1 sensor.yaml: intrinsics, distortion and the stereo extrinsics.
+    // Only loaded when something uses it; otherwise tracking stays on raw
+    // pixels with a fundamental-matrix RANSAC and depth uses the nominal rig.
+    StereoCamera stereo;
+    const bool needs_calibration = calibrated || rectify || estimate_pose || backend_window > 0;
+    if (needs_calibration && !load_euroc_stereo(dataset_path, stereo)) {
+        std::cerr << "Cannot load camera calibration from " << dataset_path << "/mav0/cam{0,1}/sensor.yaml" << std::endl;
+        return -1;
+    }
+    // Rectified: the reader remaps both images and everything downstream
+    // sees the distortion-free rectified pinhole rig
+    std::shared_ptr<StereoRectifier> rectifier;
+    if (rectify) {
+        rectifier = std::make_shared<StereoRectifier>(stereo);
+        if (!rectifier->is_valid()) {
+            std::cerr << "Cannot build stereo rectification" << std::endl;
+            return -1;
+        }
+        stereo = rectifier->get_rectified_camera();
+    } else if (undistort_grid && needs_calibration) {
+        stereo.left.build_undistortion_grid();
+        stereo.right.build_undistortion_grid();
+    }
+
+    DatasetReader reader(dataset_path);
+    if (reader.get_image_data().empty()) {
+        std::cerr << "No images found in dataset" << std::endl;
+        return -1;
+    }
+    reader.set_max_frames(max_frames);
+    reader.set_num_workers(decode_threads);
+    reader.set_queue_capacity(queue_capacity);
+    reader.set_clahe(true, 2.0, cv::Size(8, 8));
+    reader.set_rectifier(rectifier);
+    // The fused output carries the border of the frames' default 21x21 pyramid window
+    reader.set_fused_preprocessing(fused_preprocess, cv::Size(21, 21));
+    // Enough buffers for every frame alive at once, two images each. Frames
+    // holding images, by where they sit:
+    //   reader                    queue_capacity decoded or in flight  (both modes)
+    //   4 stage queues            4 * queue_capacity                   (pipelined)
+    //   load/track/stereo/depth   1 each, plus 1 at the consumer: 5   (pipelined)
+    //   track / stereo stage      the previous frame and keyframe: 2  (pipelined)
+    //   serial loop               current, previous frame, keyframe: 3 (serial)
+    // --check-allocations preloads every frame; those beyond the pool get
+    // unpooled images.
+    std::shared_ptr<ImagePool> pool;
+    if (image_pool) {
+        const size_t frames_alive = pipelined ? queue_capacity + 4 * queue_capacity + 5 + 2
+                                              : queue_capacity + 3;
+        pool = std::make_shared<ImagePool>(2 * frames_alive);
+        reader.set_image_pool(pool);
+    }
+
+    // The forward and backward LK passes are split into batches over the
+    // tracker's pool; without workers they would run one after the other
+    if (fb_threshold > 0.0f && !detect_threads_given) {
+        detect_threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    }
+
+    FeatureTracker tracker;
+    tracker.set_max_features(150);
+    tracker.set_min_distance(30.0);
+    tracker.set_grid_detection(!legacy_detector);
+    tracker.set_num_threads(detect_threads);
+    tracker.set_forward_backward_check(fb_threshold > 0.0f, fb_threshold);
+    tracker.set_motion_prediction(motion_prediction);
+    tracker.set_sparse_lk(sparse_lk);
+    tracker.set_opencv_ransac(opencv_ransac);
+    tracker.set_keyframe_selection(keyframe_selection);
+    if (calibrated) {
+        tracker.set_camera_model(stereo.left);
+    }
+
+    // Dense disparity on the rectified pair; strips run on their own pool
+    std::unique_ptr<ThreadPool> dense_pool;
+    std::unique_ptr<DisparityEstimator> dense;
+    if (!dense_mode.empty()) {
+        if (!rectify) {
+            std::cerr << "--dense-disparity needs --rectify" << std::endl;
+            return -1;
+        }
+        DisparityParams params;
+        params.mode = dense_mode == "bm" ? DisparityMode::BlockMatching : DisparityMode::SemiGlobal;
+        params.half_resolution = dense_half;
+        dense = std::make_unique<DisparityEstimator>(params);
+        dense_pool = std::make_unique<ThreadPool>(params.num_strips - 1);
+        dense->set_thread_pool(dense_pool.get());
+    }
+
+    std::unique_ptr<PoseEstimator> pose;
+    if (estimate_pose) {
+        pose = std::make_unique<PoseEstimator>();
+        pose->set_focal_length(stereo.left.get_focal_length());
+    }
+
+    // Bundle adjustment refines the frontend's keyframe poses; it marginalizes
+    // a keyframe while the map still holds it, so the map keeps one more
+    std::unique_ptr<SlidingWindowOptimizer> backend;
+    if (backend_window > 0) {
+        if (!pose) {
+            std::cerr << "--backend needs pose estimation (calibrated, without --no-pose)" << std::endl;
+            return -1;
+        }
+        WindowOptimizerParams params;
+        params.window_size = backend_window;
+        backend = std::make_unique<SlidingWindowOptimizer>(stereo, params);
+        map_window = std::max(map_window, static_cast<size_t>(backend->get_params().window_size) + 1);
+    }
+
+    std::unique_ptr<SlidingWindowMap> map;
+    if (map_window > 0) {
+        map = std::make_unique<SlidingWindowMap>(map_window);
+    }
+
+    RunOptions options;
+    options.rectified = rectify;
+    options.stereo_reuse = stereo_reuse;
+    options.dense = dense.get();
+    options.copy_images = copy_images;
+    options.map = map.get();
+    options.pose = pose.get();
+    options.backend = backend.get();
+    options.preload = check_allocations;
+    options.queue_capacity = queue_capacity;
+
+    BenchResult result;
+    auto run_start = std::chrono::steady_clock::now();
+    if (pipelined) {
+        run_pipelined(reader, tracker, stereo, options, result);
+    } else {
+        run_serial(reader, tracker, stereo, options, result);
+    }
+    auto run_end = std::chrono::steady_clock::now();
+
+    size_t frames_processed = result.frames_processed;
+    double wall_ms = elapsed_ms(run_start, run_end);
+    double frames = std::max<double>(frames_processed, 1.0);
+    double end_to_end_fps = wall_ms > 0.0 ? frames_processed * 1000.0 / wall_ms : 0.0;
+
+    std::ostringstream json;
+    json << "{\n"
+         << "  \"dataset\": ";
+    write_json_string(json, dataset_path);
+    json << ",\n"
+         << "  \"frames_processed\": " << frames_processed << ",\n"
+         << "  \"mode\": \"" << (pipelined ? "pipelined" : "serial") << "\",\n"
+         << "  \"detector\": \"" << (legacy_detector ? "global" : "grid") << "\",\n"
+         << "  \"detect_threads\": " << tracker.get_num_threads() << ",\n"
+         << "  \"fb_check_px\": " << fb_threshold << ",\n"
+         << "  \"lk\": \"" << (tracker.is_sparse_lk() ? "sparse" : "opencv") << "\",\n"
+         << "  \"ransac\": \"" << (opencv_ransac ? "opencv" : calibrated ? "essential" : "fundamental") << "\",\n"
+         << "  \"undistortion\": \"" << (!calibrated ? "none" : rectify ? "rectified" : undistort_grid ? "grid" : "exact")
+         << "\",\n"
+         << "  \"stereo\": \"" << (rectify ? "scanline" : "lk") << "\",\n"
+         << "  \"stereo_reuse\": " << (stereo_reuse ? "true" : "false") << ",\n"
+         << "  \"dense_disparity\": \"" << (dense ? dense_mode + (dense_half ? "_half" : "") : "off") << "\",\n"
+         << "  \"preprocess\": \"" << (fused_preprocess ? "fused" : "standard") << "\",\n"
+         << "  \"image_handoff\": \"" << (copy_images && !pipelined ? "copy" : "move") << "\",\n"
+         << "  \"motion_prediction\": " << (motion_prediction ? "true" : "false") << ",\n"
+         << "  \"frames_skipped\": " << result.frames_skipped << ",\n"
+         << "  \"keyframe_selection\": " << (keyframe_selection ? "true" : "false") << ",\n"
+         << "  \"keyframes\": " << tracker.get_keyframe_count() << ",\n"
+         << "  \"keyframe_ratio\": " << tracker.get_keyframe_count() / frames << ",\n"
+         << "  \"decode_threads\": " << reader.get_num_workers() << ",\n"
+         << "  \"wall_time_s\": " << wall_ms / 1000.0 << ",\n"
+         << "  \"fps\": " << (pipelined || result.processing_ms <= 0.0
+                                ? end_to_end_fps : frames_processed * 1000.0 / result.processing_ms) << ",\n"
+         << "  \"end_to_end_fps\": " << end_to_end_fps << ",\n"
+         << "  \"features\": {"
+         << "\"mean_per_frame\": " << result.total_features / frames
+         << ", \"mean_tracked_per_frame\": " << result.total_tracked / frames
+         << ", \"mean_stereo_matched_per_frame\": " << result.total_stereo_matches / frames
+         << ", \"mean_with_depth_per_frame\": " << result.total_depth / frames
+         << ", \"mean_stereo_matched_per_keyframe\": "
+         << result.total_stereo_matches / std::max<double>(tracker.get_keyframe_count(), 1.0)
+         << ", \"mean_occupied_cell_fraction\": " << result.total_occupied_cells / frames
+         << ", \"mean_track_length\": "
+         << (result.total_features > 0 ? static_cast<double>(result.total_track_length) / result.total_features : 0.0)
+         << "},\n";
+    // Tracker outlier rejection per frame; compare runs with and without --fb-check
+    const Profiler& profiler = Profiler::instance();
+    json << "  \"outlier_rejection\": {"
+         << "\"fb_rejected_per_frame\": " << profiler.get_counter(ProfileCounter::ForwardBackwardRejected) / frames
+         << ", \"ransac_rejected_per_frame\": " << profiler.get_counter(ProfileCounter::FeaturesRejected) / frames
+         << ", \"ransac_iterations_per_frame\": " << profiler.get_counter(ProfileCounter::RansacIterations) / frames
+         << "},\n";
+    json << "  \"images\": {\"copied_mb_per_frame\": " << result.image_bytes_copied / frames / (1024.0 * 1024.0);
+    if (pool) {
+        json << ", \"pool_buffers\": " << pool->get_buffer_count()
+             << ", \"pool_allocations\": " << pool->get_allocation_count()
+             << ", \"pool_reuses\": " << pool->get_reuse_count();
+    }
+    json << "},\n";
+    if (map) {
+        // Footprint stays flat once the window is full, whatever the sequence length
+        json << "  \"map\": {\"window\": " << map->get_capacity()
+             << ", \"keyframes\": " << map->size()
+             << ", \"evicted_keyframes\": " << map->get_evicted_count()
+             << ", \"tracks\": " << map->get_tracks().get_track_count()
+             << ", \"observations\": " << map->get_tracks().get_observation_count()
+             << ", \"memory_kb\": " << map->get_memory_bytes() / 1024.0
+             << ", \"peak_memory_kb\": " << result.map_peak_bytes / 1024.0 << "},\n";
+    }
+    if (!pipelined) {
+        // operator new and cv::Mat buffers on every thread. track_features is
+        // the project's own code, track_features_opencv what OpenCV allocates
+        // inside the calls the tracker makes. Unless isolated
+        // (--check-allocations), the reader's decode workers run meanwhile
+        // and are counted too.
+        json << "  \"allocations\": {\"warmup_frames\": " << BenchResult::ALLOC_WARMUP_FRAMES
+             << ", \"isolated\": " << (check_allocations ? "true" : "false")
+             << ", \"track_features\": ";
+        BenchResult::write_allocations_json(json, result.track_allocations);
+        json << ", \"track_features_opencv\": ";
+        BenchResult::write_allocations_json(json, result.track_opencv_allocations);
+        json << ", \"stereo_matching\": ";
+        BenchResult::write_allocations_json(json, result.stereo_allocations);
+        if (const auto& buffer_pool = tracker.get_frame_buffer_pool()) {
+            json << ", \"frame_buffer_reuses\": " << buffer_pool->get_reuse_count();
+        }
+        json << "},\n";
+    }
+    if (pose) {
+        std::vector<GroundTruthPose> groundtruth;
+        TrajectoryError error;
+        json << "  \"trajectory\": {";
+        if (load_euroc_groundtruth(dataset_path, groundtruth) &&
+            evaluate_trajectory(result.trajectory, groundtruth, stereo.left.get_body_from_camera(), error)) {
+            json << "\"frames_with_groundtruth\": " << error.frames
+                 << ", \"ate_rmse_m\": " << error.ate_rmse_m
+                 << ", \"final_error_m\": " << error.final_error_m
+                 << ", \"path_length_m\": " << error.path_length_m
+                 << ", \"drift_percent\": "
+                 << (error.path_length_m > 0.0 ? 100.0 * error.final_error_m / error.path_length_m : 0.0)
+                 << ", \"rpe_mean_m\": " << error.rpe_mean_m
+                 << ", \"rpe_rot_mean_deg\": " << error.rpe_rot_mean_deg;
+        } else {
+            json << "\"frames_with_groundtruth\": 0";
+        }
+        json << "},\n";
+        if (!trajectory_path.empty() && !write_trajectory(trajectory_path, result.trajectory)) {
+            std::cerr << "Cannot write trajectory: " << trajectory_path << std::endl;
+        }
+
+        if (backend) {
+            // Keyframes only, frontend pose against bundle-adjusted pose
+            std::vector<BenchResult::TrajectorySample> frontend_keyframes;
+            std::vector<BenchResult::TrajectorySample> backend_keyframes;
+            for (const BenchResult::TrajectorySample& sample : result.trajectory) {
+                auto refined = result.backend_poses.find(sample.timestamp);
+                if (refined == result.backend_poses.end()) continue;
+                frontend_keyframes.push_back(sample);
+                backend_keyframes.push_back({sample.timestamp, refined->second});
+            }
+            const double solves = std::max<double>(result.backend_solves, 1.0);
+            json << "  \"backend\": {\"window\": " << backend->get_params().window_size
+                 << ", \"solves\": " << result.backend_solves
+                 << ", \"mean_iterations\": " << result.backend_iterations / solves
+                 << ", \"mean_landmarks\": " << result.backend_landmarks / solves;
+            TrajectoryError frontend_error, backend_error;
+            if (!groundtruth.empty() &&
+                evaluate_trajectory(frontend_keyframes, groundtruth, stereo.left.get_body_from_camera(), frontend_error) &&
+                evaluate_trajectory(backend_keyframes, groundtruth, stereo.left.get_body_from_camera(), backend_error)) {
+                json << ", \"keyframes_with_groundtruth\": " << backend_error.frames
+                     << ", \"frontend_ate_rmse_m\": " << frontend_error.ate_rmse_m
+                     << ", \"ate_rmse_m\": " << backend_error.ate_rmse_m
+                     << ", \"frontend_final_error_m\": " << frontend_error.final_error_m
+                     << ", \"final_error_m\": " << backend_error.final_error_m;
+            }
+            json << "},\n";
+        }
+    }
+    json << "  \"stages\": ";
+    result.timings.write_json(json);
+    json << ",\n  \"profile\": ";
+    Profiler::instance().write_stats_json(json);
+    json << "\n}\n";
+
+    if (!trace_path.empty()) {
+        if (Profiler::instance().write_chrome_trace(trace_path)) {
+            std::cerr << "Chrome trace written to " << trace_path << std::endl;
+        } else {
+            std::cerr << "Cannot open trace file: " << trace_path << std::endl;
+        }
+    }
+
+    if (output_path.empty()) {
+        std::cout << json.str();
+    } else {
+        std::ofstream out(output_path);
+        if (!out.is_open()) {
+            std::cerr << "Cannot open output file: " << output_path << std::endl;
+            return -1;
+        }
+        out << json.str();
+        std::cerr << "Benchmark results written to " << output_path << std::endl;
+    }
+
+    // Steady-state tracking must not allocate: one project allocation in
+    // track_features after warm-up fails the run
+    if (check_allocations) {
+        const std::vector<size_t>& samples = result.track_allocations;
+        const size_t failing = std::count_if(samples.begin(), samples.end(), [](size_t n) { return n > 0; });
+        const size_t max_count = samples.empty() ? 0 : *std::max_element(samples.begin(), samples.end());
+        if (samples.empty()) {
+            std::cerr << "Allocation check FAILED: no frames after the " << BenchResult::ALLOC_WARMUP_FRAMES
+                      << " warm-up frames" << std::endl;
+            return 1;
+        }
+        if (failing > 0) {
+            std::cerr << "Allocation check FAILED: track_features allocated in " << failing << "/" << samples.size()
+                      << " frames after warm-up (max " << max_count << " per frame)" << std::endl;
+            return 1;
+        }
+        size_t opencv_total = 0;
+        for (size_t count : result.track_opencv_allocations) opencv_total += count;
+        std::cerr << "Allocation check passed: no allocations in track_features over " << samples.size()
+                  << " frames after warm-up (" << opencv_total << " inside OpenCV calls, excluded)" << std::endl;
+    }
+
+    return 0;
+}
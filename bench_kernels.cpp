@@ -0,0 +1,781 @@
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+
+#include "src/database/Frame.h"
+#include "src/database/SlidingWindowMap.h"
+#include "src/module/DisparityEstimator.h"
+#include "src/module/GridFeatureDetector.h"
+#include "src/module/PoseEstimator.h"
+#include "src/module/SlidingWindowOptimizer.h"
+#include "src/util/CameraModel.h"
+#include "src/util/EpipolarKernel.h"
+#include "src/util/ParallaxKernel.h"
+#include "src/util/ImagePreprocessor.h"
+#include "src/util/ScanlineStereo.h"
+#include "src/util/SparseLK.h"
+#include "src/util/ThreadPool.h"
+
+using namespace lightweight_vio;
+
+// Microbenchmarks and consistency checks for the batched numeric kernels, the
+// tiled corner detector, the in-project sparse LK, scanline stereo, dense
+// disparity, image preprocessing, stereo PnP pose estimation and sliding-window
+// bundle adjustment.
+// Exits non-zero if a kernel disagrees with its reference.
+
+namespace {
+
+struct Correspondences {
+    std::vector<cv::Point2f> left;
+    std::vector<cv::Point2f> right;
+};
+
+// Roughly EuRoC-like stereo pairs: small rotation, horizontal baseline, pixel noise
+Correspondences make_correspondences(size_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> u(0.0f, 752.0f);
+    std::uniform_real_distribution<float> v(0.0f, 480.0f);
+    std::uniform_real_distribution<float> disparity(1.0f, 60.0f);
+    std::normal_distribution<float> noise(0.0f, 1.5f);
+
+    Correspondences c;
+    c.left.reserve(count);
+    c.right.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        cv::Point2f left(u(rng), v(rng));
+        c.left.push_back(left);
+        c.right.emplace_back(left.x - disparity(rng) + noise(rng), left.y + 0.01f * left.x + noise(rng));
+    }
+    return c;
+}
+
+// Fundamental matrix of a near-rectified pair, normalized so F(2,2) = 1
+cv::Matx33f make_fundamental() {
+    cv::Matx33f F;
+    const float values[9] = {1.2e-7f, -3.1e-5f, 4.0e-3f,
+                             3.3e-5f, 2.0e-7f, -2.4e-2f,
+                             -4.8e-3f, 2.3e-2f, 1.0f};
+    std::copy(values, values + 9, F.val);
+    return F;
+}
+
+// The original per-feature path: homogeneous cv::Mat_<double> vectors and a Mat product
+void legacy_epipolar_errors(const cv::Mat& F, const Correspondences& c, std::vector<float>& errors) {
+    errors.resize(c.left.size());
+    for (size_t i = 0; i < c.left.size(); ++i) {
+        cv::Mat left_homo = (cv::Mat_<double>(3, 1) << c.left[i].x, c.left[i].y, 1.0);
+        cv::Mat right_homo = (cv::Mat_<double>(3, 1) << c.right[i].x, c.right[i].y, 1.0);
+        cv::Mat F_double;
+        F.convertTo(F_double, CV_64F);
+        cv::Mat epipolar_error = right_homo.t() * F_double * left_homo;
+        errors[i] = static_cast<float>(std::abs(epipolar_error.at<double>(0, 0)));
+    }
+}
+
+// Runs fn until min_time_ms has elapsed; returns nanoseconds per call
+template<typename Fn>
+double time_ns_per_call(Fn&& fn, double min_time_ms = 200.0) {
+    size_t iterations = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed_ms = 0.0;
+    do {
+        fn();
+        iterations++;
+        elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed_ms < min_time_ms);
+    return elapsed_ms * 1e6 / iterations;
+}
+
+bool bench_epipolar(size_t count, std::mt19937& rng) {
+    Correspondences c = make_correspondences(count, rng);
+    cv::Matx33f F = make_fundamental();
+    cv::Mat F_mat(F);
+    const float* left = reinterpret_cast<const float*>(c.left.data());
+    const float* right = reinterpret_cast<const float*>(c.right.data());
+
+    std::vector<float> legacy, scalar(count), batched(count);
+    std::vector<float> scalar_sampson(count), batched_sampson(count);
+
+    double legacy_ns = time_ns_per_call([&] { legacy_epipolar_errors(F_mat, c, legacy); });
+    double scalar_ns = time_ns_per_call([&] {
+        compute_epipolar_errors_scalar(F.val, left, right, count, scalar.data(), scalar_sampson.data());
+    });
+    double batched_ns = time_ns_per_call([&] {
+        compute_epipolar_errors(F.val, left, right, count, batched.data(), batched_sampson.data());
+    });
+
+    // Same accept/reject decisions as the legacy check, values within float rounding
+    const float threshold = 5.0f;
+    size_t decision_mismatches = 0;
+    double max_relative_error = 0.0;
+    double max_sampson_error = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        bool legacy_reject = legacy[i] > threshold;
+        bool batched_reject = batched[i] > threshold;
+        if (legacy_reject != batched_reject && std::abs(legacy[i] - threshold) > 1e-3f) {
+            decision_mismatches++;
+        }
+        max_relative_error = std::max(max_relative_error,
+                                      std::abs(batched[i] - legacy[i]) / (1.0 + legacy[i]));
+        max_sampson_error = std::max(max_sampson_error,
+                                     std::abs(batched_sampson[i] - scalar_sampson[i]) / (1.0 + scalar_sampson[i]));
+    }
+    bool ok = decision_mismatches == 0 && max_relative_error < 1e-4 && max_sampson_error < 1e-4;
+
+    std::cout << "epipolar n=" << count
+              << "  legacy " << legacy_ns / count << " ns/pt"
+              << "  scalar " << scalar_ns / count << " ns/pt"
+              << "  " << epipolar_kernel_backend() << " " << batched_ns / count << " ns/pt"
+              << "  speedup x" << legacy_ns / batched_ns
+              << "  max_rel_err " << max_relative_error
+              << "  decision_mismatches " << decision_mismatches
+              << (ok ? "  OK" : "  FAIL") << std::endl;
+    return ok;
+}
+
+// Keyframe parallax sum: both backends against a double-precision reference
+bool bench_parallax(size_t count, std::mt19937& rng) {
+    Correspondences c = make_correspondences(count, rng);
+    const float* left = reinterpret_cast<const float*>(c.left.data());
+    const float* right = reinterpret_cast<const float*>(c.right.data());
+
+    double reference = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        const double dx = c.left[i].x - c.right[i].x;
+        const double dy = c.left[i].y - c.right[i].y;
+        reference += std::sqrt(dx * dx + dy * dy);
+    }
+
+    float scalar = 0.0f, batched = 0.0f;
+    double scalar_ns = time_ns_per_call([&] { scalar = sum_point_distances_scalar(left, right, count); });
+    double batched_ns = time_ns_per_call([&] { batched = sum_point_distances(left, right, count); });
+
+    // Only the summation order differs
+    const double scalar_error = std::abs(scalar - reference) / (1.0 + reference);
+    const double batched_error = std::abs(batched - reference) / (1.0 + reference);
+    bool ok = scalar_error < 1e-5 && batched_error < 1e-5;
+
+    std::cout << "parallax n=" << count
+              << "  scalar " << scalar_ns / count << " ns/pt"
+              << "  " << parallax_kernel_backend() << " " << batched_ns / count << " ns/pt"
+              << "  speedup x" << scalar_ns / batched_ns
+              << "  rel_err " << batched_error
+              << (ok ? "  OK" : "  FAIL") << std::endl;
+    return ok;
+}
+
+// EuRoC-sized synthetic texture: random-intensity 6x6 blocks plus pixel noise
+cv::Mat make_texture_image(std::mt19937& rng) {
+    cv::Mat image(480, 752, CV_8UC1);
+    std::uniform_int_distribution<int> block(0, 255);
+    std::uniform_int_distribution<int> noise(-4, 4);
+    std::vector<int> block_values((image.cols / 6 + 1) * (image.rows / 6 + 1));
+    for (int& value : block_values) value = block(rng);
+    for (int y = 0; y < image.rows; ++y) {
+        uchar* row = image.ptr<uchar>(y);
+        for (int x = 0; x < image.cols; ++x) {
+            int value = block_values[(y / 6) * (image.cols / 6 + 1) + x / 6] + noise(rng);
+            row[x] = static_cast<uchar>(std::min(std::max(value, 0), 255));
+        }
+    }
+    return image;
+}
+
+// Tiled detection at 1/2/4/8 threads; every run must select the same corners
+bool bench_detection_scaling(const cv::Mat& image) {
+    const int max_features = 1000;
+    std::vector<cv::Point2f> reference;
+    double single_thread_ms = 0.0;
+    bool ok = true;
+
+    for (size_t threads : {1, 2, 4, 8}) {
+        // The caller takes tiles too, so N threads = pool of N - 1 workers
+        std::unique_ptr<ThreadPool> pool = threads > 1 ? std::make_unique<ThreadPool>(threads - 1) : nullptr;
+        GridFeatureDetector detector;
+        detector.set_cell_quota(false);
+        detector.set_min_distance(10.0);
+        detector.set_thread_pool(pool.get());
+
+        std::vector<cv::Point2f> corners;
+        double ms = time_ns_per_call([&] {
+            corners.clear();
+            detector.set_occupancy({}, {}, image.size());
+            detector.detect(image, max_features, max_features, corners);
+        }) * 1e-6;
+
+        bool identical = true;
+        if (threads == 1) {
+            reference = corners;
+            single_thread_ms = ms;
+        } else {
+            identical = corners.size() == reference.size() &&
+                        std::equal(corners.begin(), corners.end(), reference.begin());
+            ok = ok && identical;
+        }
+
+        std::cout << "detect threads=" << threads
+                  << "  " << ms << " ms"
+                  << "  speedup x" << single_thread_ms / ms
+                  << "  corners " << corners.size()
+                  << (identical ? "  OK" : "  FAIL (differs from 1 thread)") << std::endl;
+    }
+    return ok;
+}
+
+// Sparse LK (scalar and SIMD) against cv::calcOpticalFlowPyrLK on the same
+// pyramids and corners. SIMD must match scalar bit for bit; both must agree
+// with OpenCV on status and land within a few hundredths of a pixel of it.
+// With a known shift, also reports each implementation's error against it.
+bool bench_lk(const cv::Mat& image0, const cv::Mat& image1, const cv::Point2f* true_shift) {
+    const cv::Size win_size(21, 21);
+    const int max_level = 3;
+    const cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
+
+    std::vector<cv::Mat> pyramid0, pyramid1;
+    cv::buildOpticalFlowPyramid(image0, pyramid0, win_size, max_level);
+    cv::buildOpticalFlowPyramid(image1, pyramid1, win_size, max_level);
+
+    GridFeatureDetector detector;
+    std::vector<cv::Point2f> corners;
+    detector.set_min_distance(15.0);
+    detector.set_occupancy({}, {}, image0.size());
+    detector.detect(image0, 300, 300, corners);
+    const size_t n = corners.size();
+    if (n == 0) {
+        std::cout << "lk: no corners" << std::endl;
+        return false;
+    }
+
+    std::vector<cv::Point2f> cv_pts, scalar_pts(n), simd_pts(n);
+    std::vector<uchar> cv_status, scalar_status(n), simd_status(n);
+    std::vector<float> cv_err, scalar_err(n), simd_err(n);
+    SparseLKParams params;
+    params.max_level = max_level;
+    params.max_iterations = criteria.maxCount;
+    params.epsilon = static_cast<float>(criteria.epsilon);
+
+    double cv_ns = time_ns_per_call([&] {
+        cv::calcOpticalFlowPyrLK(pyramid0, pyramid1, corners, cv_pts, cv_status, cv_err, win_size, max_level, criteria);
+    });
+    double scalar_ns = time_ns_per_call([&] {
+        sparse_lk_track_scalar(pyramid0, pyramid1, win_size.width, corners.data(), scalar_pts.data(),
+                               scalar_status.data(), scalar_err.data(), n, params);
+    });
+    double simd_ns = time_ns_per_call([&] {
+        sparse_lk_track(pyramid0, pyramid1, win_size.width, corners.data(), simd_pts.data(),
+                        simd_status.data(), simd_err.data(), n, params);
+    });
+
+    size_t backend_mismatches = 0;
+    size_t status_agreement = 0;
+    std::vector<float> distances;
+    double cv_shift_error = 0.0, simd_shift_error = 0.0;
+    size_t shift_samples = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!(simd_pts[i] == scalar_pts[i]) || simd_status[i] != scalar_status[i] || simd_err[i] != scalar_err[i]) {
+            backend_mismatches++;
+        }
+        if (simd_status[i] == cv_status[i]) status_agreement++;
+        if (simd_status[i] && cv_status[i]) {
+            distances.push_back(static_cast<float>(cv::norm(simd_pts[i] - cv_pts[i])));
+            if (true_shift) {
+                cv_shift_error += cv::norm(cv_pts[i] - corners[i] - *true_shift);
+                simd_shift_error += cv::norm(simd_pts[i] - corners[i] - *true_shift);
+                shift_samples++;
+            }
+        }
+    }
+    std::sort(distances.begin(), distances.end());
+    double mean_distance = 0.0;
+    for (float d : distances) mean_distance += d;
+    mean_distance = distances.empty() ? 0.0 : mean_distance / distances.size();
+    float p95_distance = distances.empty() ? 0.0f : distances[distances.size() * 95 / 100];
+    double agreement = static_cast<double>(status_agreement) / n;
+
+    bool ok = backend_mismatches == 0 && agreement >= 0.98 && mean_distance < 0.05;
+    std::cout << "lk n=" << n
+              << "  opencv " << cv_ns / n << " ns/pt"
+              << "  scalar " << scalar_ns / n << " ns/pt"
+              << "  " << sparse_lk_backend() << " " << simd_ns / n << " ns/pt"
+              << "  speedup x" << cv_ns / simd_ns
+              << "  status_agreement " << agreement
+              << "  vs_opencv mean " << mean_distance << " px p95 " << p95_distance << " px";
+    if (shift_samples > 0) {
+        std::cout << "  shift_err opencv " << cv_shift_error / shift_samples
+                  << " px sparse " << simd_shift_error / shift_samples << " px";
+    }
+    std::cout << "  backend_mismatches " << backend_mismatches << (ok ? "  OK" : "  FAIL") << std::endl;
+    return ok;
+}
+
+// Scanline SAD stereo on a rectified pair synthesized by shifting the image
+// left by a known sub-pixel disparity, timed against what unrectified
+// matching costs (right pyramid + 2D pyramidal LK). SIMD must match scalar
+// exactly; matches must recover the disparity to about a tenth of a pixel.
+bool bench_scanline(const cv::Mat& image) {
+    const float true_disparity = 6.4f;
+    cv::Mat right;
+    cv::Mat M = (cv::Mat_<double>(2, 3) << 1, 0, -true_disparity, 0, 1, 0);
+    cv::warpAffine(image, right, M, image.size(), cv::INTER_LINEAR, cv::BORDER_REFLECT_101);
+
+    GridFeatureDetector detector;
+    std::vector<cv::Point2f> corners;
+    detector.set_min_distance(15.0);
+    detector.set_occupancy({}, {}, image.size());
+    detector.detect(image, 300, 300, corners);
+    const size_t n = corners.size();
+    if (n == 0) {
+        std::cout << "scanline: no corners" << std::endl;
+        return false;
+    }
+
+    const cv::Size win_size(21, 21);
+    std::vector<cv::Mat> left_pyramid, right_pyramid;
+    cv::buildOpticalFlowPyramid(image, left_pyramid, win_size, 3);
+    std::vector<cv::Point2f> lk_pts;
+    std::vector<uchar> lk_status;
+    std::vector<float> lk_err;
+    double lk_ns = time_ns_per_call([&] {
+        cv::buildOpticalFlowPyramid(right, right_pyramid, win_size, 3);
+        cv::calcOpticalFlowPyrLK(left_pyramid, right_pyramid, corners, lk_pts, lk_status, lk_err, win_size, 3);
+    });
+
+    ScanlineStereoParams params;
+    std::vector<cv::Point2f> scalar_pts(n), simd_pts(n);
+    std::vector<float> scalar_disparity(n), simd_disparity(n);
+    std::vector<uchar> scalar_status(n), simd_status(n);
+    double scalar_ns = time_ns_per_call([&] {
+        scanline_stereo_match_scalar(image, right, corners.data(), n, params, scalar_pts.data(),
+                                     scalar_disparity.data(), scalar_status.data());
+    });
+    double simd_ns = time_ns_per_call([&] {
+        scanline_stereo_match(image, right, corners.data(), n, params, simd_pts.data(),
+                              simd_disparity.data(), simd_status.data());
+    });
+
+    size_t backend_mismatches = 0, matched = 0;
+    double disparity_error = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        if (!(simd_pts[i] == scalar_pts[i]) || simd_status[i] != scalar_status[i] ||
+            simd_disparity[i] != scalar_disparity[i]) {
+            backend_mismatches++;
+        }
+        if (simd_status[i]) {
+            matched++;
+            disparity_error += std::abs(simd_disparity[i] - true_disparity);
+        }
+    }
+    double matched_fraction = static_cast<double>(matched) / n;
+    double mean_error = matched > 0 ? disparity_error / matched : 0.0;
+
+    bool ok = backend_mismatches == 0 && matched_fraction >= 0.9 && mean_error < 0.15;
+    std::cout << "scanline n=" << n
+              << "  lk_2d " << lk_ns / n << " ns/pt"
+              << "  scalar " << scalar_ns / n << " ns/pt"
+              << "  " << scanline_stereo_backend() << " " << simd_ns / n << " ns/pt"
+              << "  speedup_vs_lk x" << lk_ns / simd_ns
+              << "  matched " << matched_fraction
+              << "  disparity_err " << mean_error << " px"
+              << "  backend_mismatches " << backend_mismatches << (ok ? "  OK" : "  FAIL") << std::endl;
+    return ok;
+}
+
+// Dense disparity throughput at EuRoC (the input image) and KITTI (1241x376)
+// resolution on a rectified pair shifted by a known disparity, against the
+// old path (a new 16-disparity StereoBM per call plus 8-bit normalization).
+// Each mode runs as one strip on the calling thread and as 4 strips on a
+// pool; strips must agree with the single-strip map, and full-resolution
+// maps must recover the disparity.
+bool bench_disparity(const cv::Mat& euroc_image) {
+    const float true_disparity = 6.4f;
+    cv::Mat kitti_image;
+    cv::resize(euroc_image, kitti_image, cv::Size(1241, 376), 0.0, 0.0, cv::INTER_LINEAR);
+    ThreadPool pool(3);
+    bool ok = true;
+
+    const cv::Mat* images[] = {&euroc_image, &kitti_image};
+    for (const cv::Mat* image : images) {
+        cv::Mat right;
+        cv::Mat M = (cv::Mat_<double>(2, 3) << 1, 0, -true_disparity, 0, 1, 0);
+        cv::warpAffine(*image, right, M, image->size(), cv::INTER_LINEAR, cv::BORDER_REFLECT_101);
+        const std::string size = std::to_string(image->cols) + "x" + std::to_string(image->rows);
+
+        cv::Mat legacy;
+        double legacy_ms = time_ns_per_call([&] {
+            cv::Ptr<cv::StereoBM> bm = cv::StereoBM::create(16, 9);
+            cv::Mat fixed;
+            bm->compute(*image, right, fixed);
+            cv::normalize(fixed, legacy, 0, 255, cv::NORM_MINMAX, CV_8U);
+        }) * 1e-6;
+        std::cout << "disparity " << size << " legacy_bm16 " << legacy_ms << " ms" << std::endl;
+
+        for (DisparityMode mode : {DisparityMode::BlockMatching, DisparityMode::SemiGlobal}) {
+            for (bool half : {false, true}) {
+                DisparityParams params;
+                params.mode = mode;
+                params.half_resolution = half;
+                params.num_strips = 1;
+                DisparityEstimator single(params);
+                params.num_strips = 4;
+                DisparityEstimator strips(params);
+                strips.set_thread_pool(&pool);
+
+                cv::Mat single_map, strip_map;
+                double single_ms = time_ns_per_call([&] { single.compute(*image, right, single_map); }) * 1e-6;
+                double strip_ms = time_ns_per_call([&] { strips.compute(*image, right, strip_map); }) * 1e-6;
+
+                // Density and error of the strip map; disagreement with the single-strip map
+                size_t valid = 0, disagree = 0;
+                double error = 0.0;
+                for (int y = 0; y < strip_map.rows; ++y) {
+                    const float* a = strip_map.ptr<float>(y);
+                    const float* b = single_map.ptr<float>(y);
+                    for (int x = 0; x < strip_map.cols; ++x) {
+                        if ((a[x] < 0.0f) != (b[x] < 0.0f) || std::abs(a[x] - b[x]) > 1.0f) disagree++;
+                        if (a[x] < 0.0f) continue;
+                        valid++;
+                        error += std::abs(a[x] - true_disparity);
+                    }
+                }
+                const double density = static_cast<double>(valid) / strip_map.total();
+                const double mean_error = valid > 0 ? error / valid : 0.0;
+                const double disagreement = static_cast<double>(disagree) / strip_map.total();
+                // SGM paths are cut at the strip overlap; BM strips should match exactly
+                const double max_disagreement = mode == DisparityMode::BlockMatching ? 0.001 : 0.05;
+                const bool mode_ok = disagreement <= max_disagreement && density >= 0.3 &&
+                                     mean_error < (half ? 1.0 : 0.5);
+                ok = ok && mode_ok;
+
+                std::cout << "disparity " << size << " "
+                          << (mode == DisparityMode::BlockMatching ? "bm" : "sgm") << (half ? "_half" : "")
+                          << "  1 strip " << single_ms << " ms"
+                          << "  4 strips " << strip_ms << " ms (" << 1000.0 / strip_ms << " fps)"
+                          << "  density " << density
+                          << "  disparity_err " << mean_error << " px"
+                          << "  strip_disagreement " << disagreement << (mode_ok ? "  OK" : "  FAIL") << std::endl;
+            }
+        }
+    }
+    return ok;
+}
+
+// Largest absolute difference between two 8-bit images, and how many pixels differ
+std::pair<int, size_t> image_difference(const cv::Mat& a, const cv::Mat& b) {
+    int max_diff = 0;
+    size_t differing = 0;
+    for (int y = 0; y < a.rows; ++y) {
+        const uchar* pa = a.ptr<uchar>(y);
+        const uchar* pb = b.ptr<uchar>(y);
+        for (int x = 0; x < a.cols; ++x) {
+            const int d = std::abs(static_cast<int>(pa[x]) - static_cast<int>(pb[x]));
+            max_diff = std::max(max_diff, d);
+            differing += d != 0;
+        }
+    }
+    return {max_diff, differing};
+}
+
+// Rectify + CLAHE + LK pyramid for one image: cv::remap, cv::CLAHE and a
+// pyramid that copies level 0 into a bordered buffer, against the fused
+// row-block pass whose output already is that bordered level 0. The rig is
+// EuRoC-like (radtan distortion, slightly rotated right camera). The fused
+// output must match cv::CLAHE to one grey level, carry an exact reflect-101
+// border and be taken over by cv::buildOpticalFlowPyramid without a copy.
+bool bench_preprocess(const cv::Mat& image) {
+    const cv::Size win_size(21, 21);
+    const int levels = 3;
+    StereoCamera rig;
+    rig.left = CameraModel(image.size(), 458.7, 457.3, image.cols * 0.49, image.rows * 0.52,
+                           DistortionModel::RadialTangential, {-0.283, 0.074, 0.0002, 1.8e-05});
+    rig.right = CameraModel(image.size(), 457.6, 456.1, image.cols * 0.51, image.rows * 0.51,
+                            DistortionModel::RadialTangential, {-0.284, 0.074, -0.0001, -3.6e-05});
+    rig.right_R_left = Eigen::AngleAxisd(0.01, Eigen::Vector3d(0.2, 1.0, 0.1).normalized()).toRotationMatrix();
+    rig.right_t_left = Eigen::Vector3d(-0.11, 0.0004, -0.0009);
+    auto rectifier = std::make_shared<StereoRectifier>(rig);
+    if (!rectifier->is_valid()) {
+        std::cout << "preprocess: cannot build the rectifier" << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (bool rectify : {false, true}) {
+        ImagePreprocessor standard, fused;
+        for (ImagePreprocessor* preprocessor : {&standard, &fused}) {
+            preprocessor->set_clahe(true, 2.0, cv::Size(8, 8));
+            if (rectify) preprocessor->set_rectifier(rectifier);
+        }
+        fused.set_fused(true, win_size);
+
+        cv::Mat standard_out, fused_out;
+        std::vector<cv::Mat> standard_pyramid, fused_pyramid;
+        double standard_ms = time_ns_per_call([&] { standard.process(0, image, standard_out); }) * 1e-6;
+        double fused_ms = time_ns_per_call([&] { fused.process(0, image, fused_out); }) * 1e-6;
+        double standard_total_ms = time_ns_per_call([&] {
+            standard.process(0, image, standard_out);
+            cv::buildOpticalFlowPyramid(standard_out, standard_pyramid, win_size, levels);
+        }) * 1e-6;
+        double fused_total_ms = time_ns_per_call([&] {
+            fused.process(0, image, fused_out);
+            cv::buildOpticalFlowPyramid(fused_out, fused_pyramid, win_size, levels);
+        }) * 1e-6;
+
+        // Same equalization; the border around the fused image must be the one
+        // the pyramid would have built, and level 0 must be the fused buffer itself
+        const std::pair<int, size_t> diff = image_difference(standard_out, fused_out);
+        cv::Mat bordered_reference;
+        cv::copyMakeBorder(fused_out.clone(), bordered_reference, win_size.height, win_size.height,
+                           win_size.width, win_size.width, cv::BORDER_REFLECT_101);
+        cv::Mat fused_whole = fused_out;
+        fused_whole.adjustROI(win_size.height, win_size.height, win_size.width, win_size.width);
+        const int border_diff = image_difference(bordered_reference, fused_whole).first;
+        const bool level0_shared = !fused_pyramid.empty() && fused_pyramid[0].data == fused_out.data;
+
+        const double differing = static_cast<double>(diff.second) / fused_out.total();
+        const bool mode_ok = diff.first <= 1 && differing < 0.05 && border_diff == 0 && level0_shared;
+        ok = ok && mode_ok;
+        std::cout << "preprocess " << (rectify ? "rectify+clahe" : "clahe")
+                  << "  standard " << standard_ms << " ms"
+                  << "  fused " << fused_ms << " ms"
+                  << "  +pyramid: standard " << standard_total_ms << " ms, fused " << fused_total_ms << " ms"
+                  << "  speedup x" << standard_total_ms / fused_total_ms
+                  << "  max_diff " << diff.first << " (" << differing << " of pixels)"
+                  << "  border_diff " << border_diff
+                  << "  level0_shared " << (level0_shared ? "yes" : "no") << (mode_ok ? "  OK" : "  FAIL") << std::endl;
+    }
+
+    // Left and right on two threads
+    cv::Mat right_image;
+    cv::flip(image, right_image, 1);
+    for (bool concurrent : {false, true}) {
+        ImagePreprocessor preprocessor;
+        preprocessor.set_clahe(true, 2.0, cv::Size(8, 8));
+        preprocessor.set_rectifier(rectifier);
+        preprocessor.set_fused(true, win_size);
+        preprocessor.set_concurrent_stereo(concurrent);
+        cv::Mat left_out, right_out;
+        double ms = time_ns_per_call([&] { preprocessor.process_stereo(image, right_image, left_out, right_out); }) * 1e-6;
+        std::cout << "preprocess stereo fused " << (concurrent ? "concurrent" : "sequential") << "  " << ms << " ms"
+                  << std::endl;
+    }
+    return ok;
+}
+
+// Stereo keyframe at the origin, then a frame moved by 5 cm and 1 degree;
+// 0.5 px noise, 2% depth noise and 20% gross outliers. Times one frame from a
+// fresh estimator (reference setup, RANSAC with a zero-motion prediction,
+// refinement).
+bool bench_pose(size_t count, std::mt19937& rng) {
+    const double focal = 458.0;
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    std::normal_distribution<double> pixel_noise(0.0, 0.5 / focal);
+    std::normal_distribution<double> depth_noise(0.0, 0.02);
+
+    const Eigen::Matrix3d R_wc = Eigen::AngleAxisd(M_PI / 180.0, Eigen::Vector3d(0.3, 1.0, 0.1).normalized())
+                                     .toRotationMatrix();
+    const Eigen::Vector3d t_wc(0.04, -0.01, 0.03);
+
+    Frame keyframe(0, 0);
+    Frame frame(50000000, 1);
+    keyframe.set_keyframe(true);
+    for (size_t i = 0; i < count; ++i) {
+        const Eigen::Vector3d point(u(rng) * 4.0, u(rng) * 3.0, 5.0 + 4.0 * u(rng));
+        const Eigen::Vector3d in_frame = R_wc.transpose() * (point - t_wc);
+
+        FeatureStore& key_store = keyframe.get_feature_store();
+        const size_t k = keyframe.add_feature(static_cast<int>(i), cv::Point2f(0.0f, 0.0f));
+        key_store.get_normalized_coords()[k] = cv::Point2f(point.x() / point.z(), point.y() / point.z());
+        key_store.get_depths()[k] = static_cast<float>(point.z() * (1.0 + depth_noise(rng)));
+
+        cv::Point2f observed(in_frame.x() / in_frame.z() + pixel_noise(rng),
+                             in_frame.y() / in_frame.z() + pixel_noise(rng));
+        if (i % 5 == 0) {
+            observed += cv::Point2f(static_cast<float>(20.0 * u(rng) / focal), static_cast<float>(20.0 / focal));
+        }
+        const size_t f = frame.add_feature(static_cast<int>(i), cv::Point2f(0.0f, 0.0f));
+        frame.get_feature_store().get_normalized_coords()[f] = observed;
+    }
+
+    PoseEstimator::Result result;
+    const double ns = time_ns_per_call([&] {
+        PoseEstimator estimator;
+        estimator.set_focal_length(focal);
+        estimator.process(keyframe);
+        result = estimator.estimate(frame);
+    });
+
+    const double translation_error = (frame.get_translation().cast<double>() - t_wc).norm();
+    const double rotation_error_deg =
+        Eigen::AngleAxisd(R_wc.transpose() * frame.get_rotation().cast<double>()).angle() * 180.0 / M_PI;
+    const bool ok = result.success && translation_error < 0.01 && rotation_error_deg < 0.1 &&
+                    result.inlier_count >= static_cast<int>(count * 3 / 4);
+
+    std::cout << "pose n=" << count << "  " << ns * 1e-6 << " ms/frame"
+              << "  samples " << result.iterations
+              << "  inliers " << result.inlier_count << "/" << result.correspondences
+              << "  rms " << result.rms_error_px << " px"
+              << "  t_err " << translation_error * 100.0 << " cm"
+              << "  r_err " << rotation_error_deg << " deg"
+              << (ok ? "  OK" : "  FAIL") << std::endl;
+    return ok;
+}
+
+// Sliding-window bundle adjustment on a synthetic stereo sequence: 40
+// keyframes 10 cm apart with a slow yaw, 0.5 px noise on both images, and
+// frontend poses off by 3 cm / 0.5 degree. Each keyframe's pose is taken when
+// it leaves the window (or at the end), so the error includes what
+// marginalization kept.
+bool bench_window(int window_size, std::mt19937& rng) {
+    const double focal = 458.0;
+    const double baseline = 0.11;
+    const int keyframe_count = 40;
+    std::uniform_real_distribution<double> u(-1.0, 1.0);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+
+    StereoCamera stereo;
+    stereo.left = CameraModel(cv::Size(752, 480), focal, focal, 376.0, 240.0);
+    stereo.right = stereo.left;
+    stereo.right_t_left = Eigen::Vector3d(-baseline, 0.0, 0.0);
+
+    std::vector<Eigen::Vector3d> points(400);
+    for (Eigen::Vector3d& point : points) {
+        point = Eigen::Vector3d(6.0 * u(rng), 3.0 * u(rng), 9.0 + 8.0 * u(rng) + 0.05 * keyframe_count * (u(rng) + 1.0));
+    }
+
+    WindowOptimizerParams params;
+    params.window_size = window_size;
+    SlidingWindowOptimizer optimizer(stereo, params);
+    SlidingWindowMap map(window_size + 1);
+
+    std::vector<Eigen::Matrix4d> truth(keyframe_count);
+    std::vector<Eigen::Matrix4d> estimate(keyframe_count);
+    double initial_error_sq = 0.0;
+    double solve_ms = 0.0;
+    double max_solve_ms = 0.0;
+    int solves = 0;
+    SlidingWindowOptimizer::Result last;
+    for (int k = 0; k < keyframe_count; ++k) {
+        const Eigen::Matrix3d R_wc = Eigen::AngleAxisd(0.01 * k, Eigen::Vector3d(0.1, 1.0, 0.05).normalized())
+                                         .toRotationMatrix();
+        const Eigen::Vector3d t_wc(0.2 * std::sin(0.1 * k), 0.02 * std::cos(0.2 * k), 0.1 * k);
+        truth[k].setIdentity();
+        truth[k].topLeftCorner<3, 3>() = R_wc;
+        truth[k].topRightCorner<3, 1>() = t_wc;
+
+        Frame frame(k * 100000000LL, 3 * k);
+        FeatureStore& store = frame.get_feature_store();
+        for (size_t i = 0; i < points.size(); ++i) {
+            const Eigen::Vector3d p = R_wc.transpose() * (points[i] - t_wc);
+            if (p.z() < 0.5 || std::abs(p.x()) > 0.8 * p.z() || std::abs(p.y()) > 0.5 * p.z()) continue;
+            const size_t f = frame.add_feature(static_cast<int>(i), cv::Point2f(0.0f, 0.0f));
+            store.get_normalized_coords()[f] = cv::Point2f(static_cast<float>(p.x() / p.z() + 0.5 * gaussian(rng) / focal),
+                                                           static_cast<float>(p.y() / p.z() + 0.5 * gaussian(rng) / focal));
+            const double disparity = focal * baseline / p.z() + 0.5 * gaussian(rng);
+            store.get_depths()[f] = disparity > 1.0 ? static_cast<float>(focal * baseline / disparity) : -1.0f;
+        }
+
+        // The first keyframe fixes the world frame, as in the frontend
+        Eigen::Matrix3d R_initial = R_wc;
+        Eigen::Vector3d t_initial = t_wc;
+        if (k > 0) {
+            const Eigen::Vector3d axis = Eigen::Vector3d(u(rng), u(rng), u(rng)).normalized();
+            R_initial = R_wc * Eigen::AngleAxisd(0.5 * M_PI / 180.0, axis).toRotationMatrix();
+            t_initial += 0.03 * Eigen::Vector3d(gaussian(rng), gaussian(rng), gaussian(rng)).normalized();
+        }
+        initial_error_sq += (t_initial - t_wc).squaredNorm();
+        frame.set_pose(R_initial.cast<float>(), t_initial.cast<float>());
+
+        map.insert_keyframe(frame);
+        last = optimizer.optimize(map);
+        solve_ms += last.solve_ms;
+        max_solve_ms = std::max(max_solve_ms, last.solve_ms);
+        solves++;
+        for (size_t i = 0; i < optimizer.get_keyframe_count(); ++i) {
+            estimate[optimizer.get_keyframe_id(i) / 3] = optimizer.get_keyframe_pose(i);
+        }
+    }
+
+    double error_sq = 0.0;
+    double rotation_error_deg = 0.0;
+    for (int k = 0; k < keyframe_count; ++k) {
+        error_sq += (estimate[k].topRightCorner<3, 1>() - truth[k].topRightCorner<3, 1>()).squaredNorm();
+        const Eigen::Matrix3d dR = estimate[k].topLeftCorner<3, 3>().transpose() * truth[k].topLeftCorner<3, 3>();
+        rotation_error_deg = std::max(rotation_error_deg, Eigen::AngleAxisd(dR).angle() * 180.0 / M_PI);
+    }
+    const double initial_rms = std::sqrt(initial_error_sq / keyframe_count);
+    const double rms = std::sqrt(error_sq / keyframe_count);
+    const bool ok = rms < 0.02 && rms < 0.5 * initial_rms && rotation_error_deg < 0.5;
+
+    std::cout << "window BA n=" << window_size << "  " << solve_ms / solves << " ms/keyframe (max "
+              << max_solve_ms << ")"
+              << "  landmarks " << last.landmarks << "  obs " << last.observations
+              << "  iterations " << last.iterations
+              << "  t_rms " << initial_rms * 100.0 << " -> " << rms * 100.0 << " cm"
+              << "  r_max " << rotation_error_deg << " deg"
+              << (ok ? "  OK" : "  FAIL") << std::endl;
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::mt19937 rng(42);
+    bool ok = true;
+
+    std::cout << "Epipolar kernel backend: " << epipolar_kernel_backend() << std::endl;
+    for (size_t count : {1, 7, 150, 1000, 10000}) {
+        ok = bench_epipolar(count, rng) && ok;
+    }
+    for (size_t count : {1, 7, 150, 1000, 10000}) {
+        ok = bench_parallax(count, rng) && ok;
+    }
+
+    // Optional real images: bench_kernels frame.png [next_frame.png]
+    cv::Mat image;
+    if (argc > 1) {
+        image = cv::imread(argv[1], cv::IMREAD_GRAYSCALE);
+        if (image.empty()) {
+            std::cerr << "Cannot read image: " << argv[1] << std::endl;
+            return -1;
+        }
+    } else {
+        image = make_texture_image(rng);
+    }
+    ok = bench_detection_scaling(image) && ok;
+
+    // LK on two consecutive frames, or the image against a sub-pixel shifted copy
+    cv::Mat next_image;
+    const cv::Point2f shift(1.7f, -0.9f);
+    if (argc > 2) {
+        next_image = cv::imread(argv[2], cv::IMREAD_GRAYSCALE);
+        if (next_image.empty() || next_image.size() != image.size()) {
+            std::cerr << "Cannot read image (or size differs): " << argv[2] << std::endl;
+            return -1;
+        }
+    } else {
+        cv::Mat M = (cv::Mat_<double>(2, 3) << 1, 0, shift.x, 0, 1, shift.y);
+        cv::warpAffine(image, next_image, M, image.size(), cv::INTER_LINEAR, cv::BORDER_REFLECT_101);
+    }
+    ok = bench_lk(image, next_image, argc > 2 ? nullptr : &shift) && ok;
+    ok = bench_scanline(image) && ok;
+    ok = bench_disparity(image) && ok;
+    ok = bench_preprocess(image) && ok;
+    for (size_t count : {150, 300}) {
+        ok = bench_pose(count, rng) && ok;
+    }
+    for (int window_size : {5, 10, 20}) {
+        ok = bench_window(window_size, rng) && ok;
+    }
+
+    if (!ok) {
+        std::cerr << "Kernel verification FAILED" << std::endl;
+        return 1;
+    }
+    return 0;
+}
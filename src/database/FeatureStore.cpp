@@ -0,0 +1,119 @@
+#include "FeatureStore.h"
+
+namespace lightweight_vio {
+
+namespace {
+
+template<typename T>
+void compact_column(std::vector<T>& column, const std::vector<uchar>& keep_mask) {
+    size_t write = 0;
+    for (size_t read = 0; read < column.size(); ++read) {
+        if (read < keep_mask.size() && !keep_mask[read]) continue;
+        if (write != read) column[write] = column[read];
+        write++;
+    }
+    column.resize(write);
+}
+
+template<typename T>
+size_t column_bytes(const std::vector<T>& column) {
+    return column.capacity() * sizeof(T);
+}
+
+} // namespace
+
+void FeatureStore::reserve(size_t capacity) {
+    m_ids.reserve(capacity);
+    m_pixel_coords.reserve(capacity);
+    m_normalized_coords.reserve(capacity);
+    m_velocities.reserve(capacity);
+    m_track_counts.reserve(capacity);
+    m_depths.reserve(capacity);
+    m_valid.reserve(capacity);
+    m_right_coords.reserve(capacity);
+    m_disparities.reserve(capacity);
+    m_has_stereo_match.reserve(capacity);
+}
+
+void FeatureStore::clear() {
+    m_ids.clear();
+    m_pixel_coords.clear();
+    m_normalized_coords.clear();
+    m_velocities.clear();
+    m_track_counts.clear();
+    m_depths.clear();
+    m_valid.clear();
+    m_right_coords.clear();
+    m_disparities.clear();
+    m_has_stereo_match.clear();
+}
+
+size_t FeatureStore::get_memory_bytes() const {
+    return column_bytes(m_ids) + column_bytes(m_pixel_coords) + column_bytes(m_normalized_coords) +
+           column_bytes(m_velocities) + column_bytes(m_track_counts) + column_bytes(m_depths) +
+           column_bytes(m_valid) + column_bytes(m_right_coords) + column_bytes(m_disparities) +
+           column_bytes(m_has_stereo_match);
+}
+
+size_t FeatureStore::add(int feature_id, const cv::Point2f& pixel_coord) {
+    m_ids.push_back(feature_id);
+    m_pixel_coords.push_back(pixel_coord);
+    m_normalized_coords.emplace_back(0.0f, 0.0f);
+    m_velocities.emplace_back(0.0f, 0.0f);
+    m_track_counts.push_back(1);
+    m_depths.push_back(-1.0f);                 // Invalid depth initially
+    m_valid.push_back(1);
+    m_right_coords.emplace_back(-1.0f, -1.0f); // Invalid stereo coordinate initially
+    m_disparities.push_back(-1.0f);            // Invalid disparity initially
+    m_has_stereo_match.push_back(0);
+    return m_ids.size() - 1;
+}
+
+size_t FeatureStore::add(const Feature& feature) {
+    size_t index = add(feature.get_feature_id(), feature.get_pixel_coord());
+    FeatureRef ref(this, index);
+    ref.set_normalized_coord(feature.get_normalized_coord());
+    ref.set_velocity(feature.get_velocity());
+    ref.set_track_count(feature.get_track_count());
+    ref.set_depth(feature.get_depth());
+    ref.set_valid(feature.is_valid());
+    if (feature.has_stereo_match()) {
+        ref.set_stereo_match(feature.get_right_coord(), feature.get_stereo_disparity());
+    }
+    return index;
+}
+
+void FeatureStore::compact(const std::vector<uchar>& keep_mask) {
+    compact_column(m_ids, keep_mask);
+    compact_column(m_pixel_coords, keep_mask);
+    compact_column(m_normalized_coords, keep_mask);
+    compact_column(m_velocities, keep_mask);
+    compact_column(m_track_counts, keep_mask);
+    compact_column(m_depths, keep_mask);
+    compact_column(m_valid, keep_mask);
+    compact_column(m_right_coords, keep_mask);
+    compact_column(m_disparities, keep_mask);
+    compact_column(m_has_stereo_match, keep_mask);
+}
+
+void FeatureStore::erase(size_t index) {
+    std::vector<uchar> keep_mask(size(), 1);
+    keep_mask[index] = 0;
+    compact(keep_mask);
+}
+
+Feature FeatureStore::get_feature(size_t index) const {
+    ConstFeatureRef ref(this, index);
+    Feature feature(ref.get_feature_id(), ref.get_pixel_coord());
+    feature.set_normalized_coord(ref.get_normalized_coord());
+    feature.set_velocity(ref.get_velocity());
+    feature.set_track_count(ref.get_track_count());
+    feature.set_depth(ref.get_depth());
+    feature.set_valid(ref.is_valid());
+    if (ref.has_stereo_match()) {
+        feature.set_stereo_match(ref.get_right_coord(), ref.get_stereo_disparity());
+    }
+    return feature;
+}
+
+} // namespace lightweight_vio
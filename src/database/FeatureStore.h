@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Feature.h"
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Structure-of-arrays storage for the features of one frame. Every column is a
+// contiguous std::vector indexed by feature slot, so point columns can be handed
+// to cv::calcOpticalFlowPyrLK / cv::findFundamentalMat without copying.
+class FeatureStore {
+public:
+    size_t size() const { return m_ids.size(); }
+    bool empty() const { return m_ids.empty(); }
+    void reserve(size_t capacity);
+    void clear();
+    // Bytes held by the columns, including spare capacity
+    size_t get_memory_bytes() const;
+
+    // Append a feature with default state (same defaults as Feature); returns its slot
+    size_t add(int feature_id, const cv::Point2f& pixel_coord);
+    size_t add(const Feature& feature);
+
+    // Stable in-place compaction; slots with keep_mask == 0 are dropped
+    void compact(const std::vector<uchar>& keep_mask);
+    void erase(size_t index);
+
+    // Value copy of one slot
+    Feature get_feature(size_t index) const;
+
+    // Columns
+    const std::vector<int>& get_ids() const { return m_ids; }
+    const std::vector<cv::Point2f>& get_pixel_coords() const { return m_pixel_coords; }
+    const std::vector<cv::Point2f>& get_normalized_coords() const { return m_normalized_coords; }
+    const std::vector<cv::Point2f>& get_velocities() const { return m_velocities; }
+    const std::vector<int>& get_track_counts() const { return m_track_counts; }
+    const std::vector<float>& get_depths() const { return m_depths; }
+    const std::vector<uchar>& get_valid_flags() const { return m_valid; }
+    const std::vector<cv::Point2f>& get_right_coords() const { return m_right_coords; }
+    const std::vector<float>& get_disparities() const { return m_disparities; }
+    const std::vector<uchar>& get_stereo_flags() const { return m_has_stereo_match; }
+
+    // Mutable columns: element access only, the store owns the length
+    std::vector<cv::Point2f>& get_pixel_coords() { return m_pixel_coords; }
+    std::vector<cv::Point2f>& get_normalized_coords() { return m_normalized_coords; }
+    std::vector<cv::Point2f>& get_velocities() { return m_velocities; }
+    std::vector<int>& get_track_counts() { return m_track_counts; }
+    std::vector<float>& get_depths() { return m_depths; }
+    std::vector<uchar>& get_valid_flags() { return m_valid; }
+    std::vector<cv::Point2f>& get_right_coords() { return m_right_coords; }
+    std::vector<float>& get_disparities() { return m_disparities; }
+    std::vector<uchar>& get_stereo_flags() { return m_has_stereo_match; }
+
+private:
+    std::vector<int> m_ids;                       // Unique feature IDs
+    std::vector<cv::Point2f> m_pixel_coords;      // Pixel coordinates in left image
+    std::vector<cv::Point2f> m_normalized_coords; // Normalized camera coordinates
+    std::vector<cv::Point2f> m_velocities;        // Optical flow velocity (px/s)
+    std::vector<int> m_track_counts;              // Number of times tracked
+    std::vector<float> m_depths;                  // Estimated depth (-1 = invalid)
+    std::vector<uchar> m_valid;                   // Whether each feature is valid
+
+    // Stereo matching data
+    std::vector<cv::Point2f> m_right_coords;      // Pixel coordinates in right image
+    std::vector<float> m_disparities;             // Stereo disparity
+    std::vector<uchar> m_has_stereo_match;
+};
+
+// Lightweight handle to one feature slot. It mirrors the Feature API so code
+// written against std::shared_ptr<Feature> keeps working (including feature->x()).
+// Like a pointer, a const handle still allows mutation; use ConstFeatureRef for
+// read-only access. A default-constructed handle is null.
+template<typename StoreT>
+class FeatureRefT {
+public:
+    FeatureRefT() : m_store(nullptr), m_index(0) {}
+    FeatureRefT(StoreT* store, size_t index) : m_store(store), m_index(index) {}
+
+    // Mutable -> const conversion
+    template<typename OtherT, typename = std::enable_if_t<std::is_convertible<OtherT*, StoreT*>::value>>
+    FeatureRefT(const FeatureRefT<OtherT>& other) : m_store(other.get_store()), m_index(other.get_index()) {}
+
+    explicit operator bool() const { return m_store != nullptr; }
+    const FeatureRefT* operator->() const { return this; }
+
+    StoreT* get_store() const { return m_store; }
+    size_t get_index() const { return m_index; }
+
+    // Getters
+    int get_feature_id() const { return m_store->get_ids()[m_index]; }
+    cv::Point2f get_pixel_coord() const { return m_store->get_pixel_coords()[m_index]; }
+    Eigen::Vector2f get_normalized_coord() const {
+        const cv::Point2f& p = m_store->get_normalized_coords()[m_index];
+        return Eigen::Vector2f(p.x, p.y);
+    }
+    Eigen::Vector2f get_velocity() const {
+        const cv::Point2f& v = m_store->get_velocities()[m_index];
+        return Eigen::Vector2f(v.x, v.y);
+    }
+    float get_depth() const { return m_store->get_depths()[m_index]; }
+    int get_track_count() const { return m_store->get_track_counts()[m_index]; }
+    bool is_valid() const { return m_store->get_valid_flags()[m_index] != 0; }
+    bool has_stereo_match() const { return m_store->get_stereo_flags()[m_index] != 0; }
+    const cv::Point2f& get_right_coord() const { return m_store->get_right_coords()[m_index]; }
+    float get_stereo_disparity() const { return m_store->get_disparities()[m_index]; }
+
+    // Setters (mutable handles only)
+    void set_pixel_coord(const cv::Point2f& coord) const { m_store->get_pixel_coords()[m_index] = coord; }
+    void set_normalized_coord(const Eigen::Vector2f& coord) const {
+        m_store->get_normalized_coords()[m_index] = cv::Point2f(coord.x(), coord.y());
+    }
+    void set_velocity(const Eigen::Vector2f& velocity) const {
+        m_store->get_velocities()[m_index] = cv::Point2f(velocity.x(), velocity.y());
+    }
+    void set_depth(float depth) const { m_store->get_depths()[m_index] = depth; }
+    void set_track_count(int count) const { m_store->get_track_counts()[m_index] = count; }
+    void set_valid(bool valid) const { m_store->get_valid_flags()[m_index] = valid ? 1 : 0; }
+    void increment_track_count() const { m_store->get_track_counts()[m_index]++; }
+    void reset_track_count() const { m_store->get_track_counts()[m_index] = 1; }
+    void set_stereo_match(const cv::Point2f& right_coord, float disparity) const {
+        m_store->get_right_coords()[m_index] = right_coord;
+        m_store->get_disparities()[m_index] = disparity;
+        m_store->get_stereo_flags()[m_index] = 1;
+    }
+
+    // Calculate parallax between two observations
+    template<typename OtherT>
+    float calculate_parallax(const FeatureRefT<OtherT>& other) const {
+        return (get_normalized_coord() - other.get_normalized_coord()).norm();
+    }
+
+    Feature to_feature() const { return m_store->get_feature(m_index); }
+
+private:
+    StoreT* m_store;
+    size_t m_index;
+};
+
+using FeatureRef = FeatureRefT<FeatureStore>;
+using ConstFeatureRef = FeatureRefT<const FeatureStore>;
+
+// Iterable view over all slots of a store, yielding handles
+template<typename StoreT>
+class FeatureRangeT {
+public:
+    using Ref = FeatureRefT<StoreT>;
+
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Ref;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Ref*;
+        using reference = const Ref&;
+
+        iterator(StoreT* store, size_t index) : m_ref(store, index) {}
+        reference operator*() const { return m_ref; }
+        pointer operator->() const { return &m_ref; }
+        iterator& operator++() { m_ref = Ref(m_ref.get_store(), m_ref.get_index() + 1); return *this; }
+        bool operator==(const iterator& other) const { return m_ref.get_index() == other.m_ref.get_index(); }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+
+    private:
+        Ref m_ref;
+    };
+
+    explicit FeatureRangeT(StoreT* store) : m_store(store) {}
+
+    iterator begin() const { return iterator(m_store, 0); }
+    iterator end() const { return iterator(m_store, m_store->size()); }
+    size_t size() const { return m_store->size(); }
+    bool empty() const { return m_store->empty(); }
+    Ref operator[](size_t index) const { return Ref(m_store, index); }
+
+private:
+    StoreT* m_store;
+};
+
+using FeatureRange = FeatureRangeT<FeatureStore>;
+using ConstFeatureRange = FeatureRangeT<const FeatureStore>;
+
+} // namespace lightweight_vio
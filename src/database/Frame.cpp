@@ -1,9 +1,19 @@
 #include "Frame.h"
+#include "../util/ExternalAllocationScope.h"
+#include "../util/Logger.h"
+#include "../module/DisparityEstimator.h"
+#include "../module/GridFeatureDetector.h"
+#include "../util/EpipolarKernel.h"
+#include "../util/Profiler.h"
+#include "../util/ScratchBuffers.h"
 #include <algorithm>
-#include <iostream>
+#include <cmath>
 
 namespace lightweight_vio {
 
+// Point columns are handed to the float kernels as interleaved x,y arrays
+static_assert(sizeof(cv::Point2f) == 2 * sizeof(float), "cv::Point2f must be two packed floats");
+
 Frame::Frame(long long timestamp, int frame_id)
     : m_timestamp(timestamp)
     , m_frame_id(frame_id)
@@ -13,70 +23,168 @@ Frame::Frame(long long timestamp, int frame_id)
 {
 }
 
+Frame::~Frame() {
+    if (!m_buffer_pool) {
+        return;
+    }
+    FrameBufferPool::Buffers buffers;
+    buffers.features = std::move(m_features);
+    buffers.left_pyramid = std::move(m_left_pyramid.empty() ? m_spare_left_pyramid : m_left_pyramid);
+    buffers.right_pyramid = std::move(m_right_pyramid.empty() ? m_spare_right_pyramid : m_right_pyramid);
+    m_buffer_pool->release(std::move(buffers));
+}
+
+void Frame::set_buffer_pool(std::shared_ptr<FrameBufferPool> pool) {
+    m_buffer_pool = std::move(pool);
+    if (!m_buffer_pool || !m_features.empty()) {
+        return;
+    }
+    FrameBufferPool::Buffers buffers;
+    if (!m_buffer_pool->acquire(buffers)) {
+        return;
+    }
+    m_features = std::move(buffers.features);
+    {
+        std::lock_guard<std::mutex> lock(m_left_pyramid_mutex);
+        m_spare_left_pyramid = std::move(buffers.left_pyramid);
+    }
+    std::lock_guard<std::mutex> lock(m_right_pyramid_mutex);
+    m_spare_right_pyramid = std::move(buffers.right_pyramid);
+}
+
 void Frame::set_pose(const Eigen::Matrix3f& rotation, const Eigen::Vector3f& translation) {
     m_rotation = rotation;
     m_translation = translation;
 }
 
+const std::vector<cv::Mat>& Frame::get_left_pyramid() const {
+    return build_pyramid(m_left_image, m_left_pyramid, m_spare_left_pyramid, m_left_pyramid_mutex);
+}
+
+const std::vector<cv::Mat>& Frame::get_right_pyramid() const {
+    return build_pyramid(m_right_image, m_right_pyramid, m_spare_right_pyramid, m_right_pyramid_mutex);
+}
+
+const std::vector<cv::Mat>& Frame::build_pyramid(const cv::Mat& image, std::vector<cv::Mat>& pyramid,
+                                                 std::vector<cv::Mat>& spare, std::mutex& mutex) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pyramid.empty() && !image.empty()) {
+        VIO_PROFILE_SCOPE("build_pyramid");
+        // Recycled levels of the same size are written in place; OpenCV's own
+        // pyrDown/derivative temporaries remain
+        pyramid.swap(spare);
+        ExternalAllocationScope external;
+        cv::buildOpticalFlowPyramid(image, pyramid, m_pyramid_win_size, m_pyramid_levels);
+    }
+    return pyramid;
+}
+
+size_t Frame::add_feature(int feature_id, const cv::Point2f& pixel_coord) {
+    note_feature_id(feature_id);
+    return m_features.add(feature_id, pixel_coord);
+}
+
 void Frame::add_feature(std::shared_ptr<Feature> feature) {
-    m_features.push_back(feature);
-    m_feature_id_to_index[feature->get_feature_id()] = m_features.size() - 1;
+    note_feature_id(feature->get_feature_id());
+    m_features.add(*feature);
+}
+
+void Frame::note_feature_id(int feature_id) {
+    const std::vector<int>& ids = m_features.get_ids();
+    if (!ids.empty() && feature_id <= ids.back()) {
+        m_ids_sorted = false;
+    }
 }
 
 void Frame::remove_feature(int feature_id) {
-    auto it = m_feature_id_to_index.find(feature_id);
-    if (it != m_feature_id_to_index.end()) {
-        size_t index = it->second;
-        m_features.erase(m_features.begin() + index);
-        m_feature_id_to_index.erase(it);
-        update_feature_index();
+    size_t index = find_feature_index(feature_id);
+    if (index < m_features.size()) {
+        m_features.erase(index);
     }
 }
 
-std::shared_ptr<Feature> Frame::get_feature(int feature_id) {
-    auto it = m_feature_id_to_index.find(feature_id);
-    if (it != m_feature_id_to_index.end()) {
-        return m_features[it->second];
+void Frame::remove_features(const std::vector<uchar>& keep_mask) {
+    // Compaction is stable, so a sorted id column stays sorted
+    m_features.compact(keep_mask);
+}
+
+void Frame::remove_features(const std::unordered_set<int>& feature_ids) {
+    if (feature_ids.empty()) {
+        return;
     }
-    return nullptr;
+
+    const std::vector<int>& ids = m_features.get_ids();
+    std::vector<uchar> keep_mask(ids.size(), 1);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (feature_ids.count(ids[i])) {
+            keep_mask[i] = 0;
+        }
+    }
+    remove_features(keep_mask);
 }
 
-std::shared_ptr<const Feature> Frame::get_feature(int feature_id) const {
-    auto it = m_feature_id_to_index.find(feature_id);
-    if (it != m_feature_id_to_index.end()) {
-        return m_features[it->second];
+FeatureRef Frame::get_feature(int feature_id) {
+    size_t index = find_feature_index(feature_id);
+    if (index < m_features.size()) {
+        return FeatureRef(&m_features, index);
     }
-    return nullptr;
+    return FeatureRef();
 }
 
-void Frame::extract_features(int max_features) {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+ConstFeatureRef Frame::get_feature(int feature_id) const {
+    size_t index = find_feature_index(feature_id);
+    if (index < m_features.size()) {
+        return ConstFeatureRef(&m_features, index);
+    }
+    return ConstFeatureRef();
+}
+
+size_t Frame::find_feature_index(int feature_id) const {
+    const std::vector<int>& ids = m_features.get_ids();
+    if (m_ids_sorted) {
+        auto it = std::lower_bound(ids.begin(), ids.end(), feature_id);
+        if (it != ids.end() && *it == feature_id) {
+            return static_cast<size_t>(it - ids.begin());
+        }
+        return ids.size();
+    }
+    return static_cast<size_t>(std::find(ids.begin(), ids.end(), feature_id) - ids.begin());
+}
+
+void Frame::extract_features(int max_features, ThreadPool* thread_pool) {
+    VIO_PROFILE_SCOPE("extract_features");
+
     if (m_left_image.empty()) {
-        std::cerr << "Cannot extract features: left image is empty" << std::endl;
+        VIO_LOG_ERROR("Cannot extract features: left image is empty");
         return;
     }
 
+    // Tiled detector without per-cell quotas: same selection rule as
+    // goodFeaturesToTrack, with the tiles optionally spread over a pool
+    thread_local GridFeatureDetector detector;
+    detector.set_cell_quota(false);
+    detector.set_quality_level(m_quality_level);
+    detector.set_min_distance(m_min_distance);
+    detector.set_thread_pool(thread_pool);
+    detector.set_occupancy(m_features.get_pixel_coords(), m_features.get_valid_flags(), m_left_image.size());
+
     std::vector<cv::Point2f> corners;
-    cv::goodFeaturesToTrack(m_left_image, corners, max_features, m_quality_level, m_min_distance);
+    detector.detect(m_left_image, max_features, max_features, corners);
 
     static int global_feature_id = 0;
+    m_features.reserve(m_features.size() + corners.size());
     for (const auto& corner : corners) {
-        auto feature = std::make_shared<Feature>(global_feature_id++, corner);
-        add_feature(feature);
+        add_feature(global_feature_id++, corner);
     }
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    
-    std::cout << "[TIMING] Feature extraction: " << duration.count() / 1000.0 << " ms | "
-              << "Extracted " << corners.size() << " features" << std::endl;
+    VIO_PROFILE_COUNTER(FeaturesExtracted, corners.size());
+    VIO_LOG_DEBUG("Extracted " << corners.size() << " features");
 }
 
 void Frame::reject_outliers_with_fundamental_matrix() {
     // This function would implement fundamental matrix RANSAC
     // For now, it's a placeholder
-    std::cout << "Rejecting outliers with fundamental matrix (placeholder)" << std::endl;
+    VIO_LOG_DEBUG("Rejecting outliers with fundamental matrix (placeholder)");
 }
 
 cv::Mat Frame::draw_features() const {
@@ -87,7 +195,7 @@ cv::Mat Frame::draw_features() const {
         display_image = m_left_image.clone();
     }
 
-    for (const auto& feature : m_features) {
+    for (const auto& feature : get_features()) {
         if (feature->is_valid()) {
             const cv::Point2f& pt = feature->get_pixel_coord();
             int track_count = feature->get_track_count();
@@ -102,7 +210,7 @@ cv::Mat Frame::draw_features() const {
 
 cv::Mat Frame::draw_stereo_matches() const {
     if (!is_stereo()) {
-        std::cout << "Cannot draw stereo matches: not a stereo frame" << std::endl;
+        VIO_LOG_WARN("Cannot draw stereo matches: not a stereo frame");
         return cv::Mat();
     }
 
@@ -123,7 +231,7 @@ cv::Mat Frame::draw_stereo_matches() const {
     int right_offset = m_left_image.cols;
 
     // Draw features and matches
-    for (const auto& feature : m_features) {
+    for (const auto& feature : get_features()) {
         if (feature->is_valid()) {
             const cv::Point2f& left_pt = feature->get_pixel_coord();
             
@@ -163,7 +271,7 @@ cv::Mat Frame::draw_stereo_matches() const {
 cv::Mat Frame::draw_tracks(const Frame& previous_frame) const {
     cv::Mat display_image = draw_features();
 
-    for (const auto& feature : m_features) {
+    for (const auto& feature : get_features()) {
         if (!feature->is_valid()) continue;
 
         auto prev_feature = previous_frame.get_feature(feature->get_feature_id());
@@ -178,13 +286,6 @@ cv::Mat Frame::draw_tracks(const Frame& previous_frame) const {
     return display_image;
 }
 
-void Frame::update_feature_index() {
-    m_feature_id_to_index.clear();
-    for (size_t i = 0; i < m_features.size(); ++i) {
-        m_feature_id_to_index[m_features[i]->get_feature_id()] = i;
-    }
-}
-
 bool Frame::is_in_border(const cv::Point2f& point, int border_size) const {
     int img_x = cvRound(point.x);
     int img_y = cvRound(point.y);
@@ -192,100 +293,131 @@ bool Frame::is_in_border(const cv::Point2f& point, int border_size) const {
            border_size <= img_y && img_y < m_left_image.rows - border_size;
 }
 
-void Frame::compute_stereo_matches() {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+void Frame::compute_stereo_matches(const Frame* previous_frame) {
+    VIO_PROFILE_SCOPE("compute_stereo_matches");
+
     if (!is_stereo()) {
-        std::cout << "Cannot compute stereo matches: right image not available" << std::endl;
+        VIO_LOG_WARN("Cannot compute stereo matches: right image not available");
         return;
     }
 
-    std::vector<cv::Point2f> left_pts, right_pts;
-    std::vector<uchar> status;
-    std::vector<float> err;
-
-    // Extract feature points from left image
-    for (const auto& feature : m_features) {
-        if (feature->is_valid()) {
-            left_pts.push_back(feature->get_pixel_coord());
-        }
-    }
+    const std::vector<cv::Point2f>& left_pts = m_features.get_pixel_coords();
+    const std::vector<uchar>& valid = m_features.get_valid_flags();
+    const std::vector<uchar>& has_match = m_features.get_stereo_flags();
 
     if (left_pts.empty()) {
-        std::cout << "No features to match in stereo" << std::endl;
+        VIO_LOG_DEBUG("No features to match in stereo");
         return;
     }
 
-    // Perform optical flow tracking from left to right image with improved parameters
-    cv::calcOpticalFlowPyrLK(m_left_image, m_right_image, left_pts, right_pts, 
-                            status, err, cv::Size(21, 21), 3,
-                            cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01),
-                            0, 1e-4); // Lower eigenvalue threshold for better tracking
+    // Per-thread scratch: the serial loop and the pipeline's stereo stage each
+    // reuse their own buffers from frame to frame
+    thread_local ScratchBuffers scratch;
+    scratch.clear();
 
-    int matches_found = 0;
+    int reused = 0;
+    if (previous_frame && previous_frame->is_stereo()) {
+        reused = reuse_stereo_matches(*previous_frame, scratch);
+    }
+
+    // Left -> right LK for the slots still without a match. Without reuse that
+    // is every slot, and the store's pixel column is used as-is (no copy);
+    // invalid slots are skipped below
+    std::vector<size_t>& query_slots = scratch.indices;
+    query_slots.clear();
+    const std::vector<cv::Point2f>* query_pts = &left_pts;
+    if (reused > 0) {
+        scratch.query_points.clear();
+        for (size_t i = 0; i < left_pts.size(); ++i) {
+            if (valid[i] && !has_match[i]) {
+                query_slots.push_back(i);
+                scratch.query_points.push_back(left_pts[i]);
+            }
+        }
+        query_pts = &scratch.query_points;
+    }
+    const size_t query_count = query_pts->size();
+    auto slot_of = [&](size_t k) { return reused > 0 ? query_slots[k] : k; };
+
+    std::vector<cv::Point2f>& right_pts = scratch.tracked_points;
+    std::vector<uchar>& status = scratch.status;
+    std::vector<float>& err = scratch.err;
+    if (query_count > 0) {
+        // Perform optical flow tracking from left to right image with improved parameters.
+        // The left pyramid is the same one temporal tracking used for this frame.
+        cv::calcOpticalFlowPyrLK(get_left_pyramid(), get_right_pyramid(), *query_pts, right_pts,
+                                status, err, cv::Size(21, 21), 3,
+                                cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01),
+                                0, 1e-4); // Lower eigenvalue threshold for better tracking
+    }
+
+    int matches_found = reused;
     
     // For unrectified stereo, we need more sophisticated matching
     // First, try to estimate fundamental matrix from initial matches
-    std::vector<cv::Point2f> good_left_pts, good_right_pts;
+    std::vector<cv::Point2f>& good_left_pts = scratch.points_a;
+    std::vector<cv::Point2f>& good_right_pts = scratch.points_b;
     
     // Collect initial matches with very loose criteria
-    size_t feature_idx = 0;
-    for (auto& feature : m_features) {
-        if (feature->is_valid() && feature_idx < status.size()) {
-            if (status[feature_idx] && err[feature_idx] < 50.0f) { // Very loose error threshold
-                good_left_pts.push_back(left_pts[feature_idx]);
-                good_right_pts.push_back(right_pts[feature_idx]);
+    for (size_t k = 0; k < query_count; ++k) {
+        if (valid[slot_of(k)] && status[k] && err[k] < 50.0f) { // Very loose error threshold
+            good_left_pts.push_back((*query_pts)[k]);
+            good_right_pts.push_back(right_pts[k]);
+        }
+    }
+    // Carried-over matches are reliable, and keep F well conditioned when
+    // only a few features are new
+    if (reused > 0) {
+        const std::vector<cv::Point2f>& right_coords = m_features.get_right_coords();
+        for (size_t i = 0; i < left_pts.size(); ++i) {
+            if (valid[i] && has_match[i]) {
+                good_left_pts.push_back(left_pts[i]);
+                good_right_pts.push_back(right_coords[i]);
             }
-            feature_idx++;
         }
     }
     
-    cv::Mat fundamental_matrix;
-    std::vector<uchar> inlier_mask;
+    // Epipolar errors |x2^T F x1| for every queried slot in one batched pass
+    std::vector<float>& epipolar_errors = scratch.residuals;
+    bool has_fundamental = false;
     
-    if (good_left_pts.size() >= 8) {
+    if (query_count > 0 && good_left_pts.size() >= 8) {
         // Estimate fundamental matrix with RANSAC
-        fundamental_matrix = cv::findFundamentalMat(
+        cv::Mat fundamental_matrix = cv::findFundamentalMat(
             good_left_pts, good_right_pts, cv::FM_RANSAC, 
-            3.0, 0.99, inlier_mask
+            3.0, 0.99, scratch.inlier_mask
         );
         
-        std::cout << "Fundamental matrix estimated from " << cv::countNonZero(inlier_mask) 
-                  << "/" << good_left_pts.size() << " initial matches" << std::endl;
+        // findFundamentalMat may return several stacked solutions; use the first
+        if (fundamental_matrix.rows >= 3 && fundamental_matrix.cols == 3) {
+            cv::Matx33f F;
+            fundamental_matrix.rowRange(0, 3).convertTo(F, CV_32F);
+            epipolar_errors.resize(query_count);
+            compute_epipolar_errors(F.val, reinterpret_cast<const float*>(query_pts->data()),
+                                    reinterpret_cast<const float*>(right_pts.data()), query_count,
+                                    epipolar_errors.data(), nullptr);
+            has_fundamental = true;
+        }
+
+        VIO_LOG_DEBUG("Fundamental matrix estimated from " << cv::countNonZero(scratch.inlier_mask)
+                      << "/" << good_left_pts.size() << " initial matches");
     }
     
     // Now apply matches with epipolar constraint
-    feature_idx = 0;
-    for (auto& feature : m_features) {
-        if (feature->is_valid() && feature_idx < status.size()) {
-            if (status[feature_idx] && err[feature_idx] < 50.0f) {
-                cv::Point2f left_pt = left_pts[feature_idx];
-                cv::Point2f right_pt = right_pts[feature_idx];
+    FeatureRange features = get_features();
+    for (size_t k = 0; k < query_count; ++k) {
+        const size_t i = slot_of(k);
+        if (valid[i]) {
+            if (status[k] && err[k] < 50.0f) {
+                cv::Point2f left_pt = (*query_pts)[k];
+                cv::Point2f right_pt = right_pts[k];
                 
                 bool is_valid_match = true;
                 
                 // Check epipolar constraint if fundamental matrix is available
-                if (!fundamental_matrix.empty()) {
-                    // Convert points to homogeneous coordinates with correct type
-                    cv::Mat left_homo = (cv::Mat_<double>(3, 1) << left_pt.x, left_pt.y, 1.0);
-                    cv::Mat right_homo = (cv::Mat_<double>(3, 1) << right_pt.x, right_pt.y, 1.0);
-                    
-                    // Ensure fundamental matrix is double type
-                    cv::Mat F_double;
-                    if (fundamental_matrix.type() != CV_64F) {
-                        fundamental_matrix.convertTo(F_double, CV_64F);
-                    } else {
-                        F_double = fundamental_matrix;
-                    }
-                    
-                    // Compute epipolar error: x2^T * F * x1
-                    cv::Mat epipolar_error = right_homo.t() * F_double * left_homo;
-                    double error = std::abs(epipolar_error.at<double>(0, 0));
-                    
-                    // Reject if epipolar error is too large
-                    if (error > 5.0) {
-                        is_valid_match = false;
-                    }
+                // Reject if epipolar error is too large
+                if (has_fundamental && epipolar_errors[k] > 5.0f) {
+                    is_valid_match = false;
                 }
                 
                 // Additional basic checks
@@ -302,60 +434,245 @@ void Frame::compute_stereo_matches() {
                 }
                 
                 if (is_valid_match) {
-                    feature->set_stereo_match(right_pt, disparity);
+                    features[i]->set_stereo_match(right_pt, disparity);
                     matches_found++;
                 }
             }
-            feature_idx++;
         }
     }
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    
-    std::cout << "[TIMING] Stereo matching: " << duration.count() / 1000.0 << " ms | "
-              << "Matched " << matches_found << "/" << left_pts.size() << " features"
-              << " (using epipolar constraint for unrectified stereo)" << std::endl;
+    VIO_PROFILE_COUNTER(StereoMatches, matches_found);
+    VIO_PROFILE_COUNTER(StereoReused, reused);
+    VIO_LOG_DEBUG("Matched " << matches_found << "/" << left_pts.size() << " stereo features ("
+                  << reused << " carried over; using epipolar constraint for unrectified stereo)");
+}
+
+int Frame::reuse_stereo_matches(const Frame& previous_frame, ScratchBuffers& scratch) {
+    VIO_PROFILE_SCOPE("reuse_stereo_matches");
+
+    // Features that had a stereo match in the previous frame. Their right point
+    // is tracked prev-right -> cur-right, seeded with the left track's motion
+    const FeatureStore& prev = previous_frame.m_features;
+    const std::vector<int>& ids = m_features.get_ids();
+    const std::vector<uchar>& valid = m_features.get_valid_flags();
+    const std::vector<cv::Point2f>& left_pts = m_features.get_pixel_coords();
+    std::vector<size_t>& slots = scratch.indices;
+    std::vector<size_t>& prev_slots = scratch.match_indices;
+    std::vector<cv::Point2f>& prev_right = scratch.back_points;
+    std::vector<cv::Point2f>& cur_right = scratch.predicted_points;
+    slots.clear();
+    prev_slots.clear();
+    prev_right.clear();
+    cur_right.clear();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (!valid[i]) continue;
+        size_t j = previous_frame.find_feature_index(ids[i]);
+        if (j >= prev.size() || !prev.get_valid_flags()[j] || !prev.get_stereo_flags()[j]) continue;
+        slots.push_back(i);
+        prev_slots.push_back(j);
+        prev_right.push_back(prev.get_right_coords()[j]);
+        cur_right.push_back(prev.get_right_coords()[j] + (left_pts[i] - prev.get_pixel_coords()[j]));
+    }
+    if (slots.empty()) {
+        return 0;
+    }
+
+    // The seed is close, so a shallow search suffices
+    std::vector<uchar>& status = scratch.back_status;
+    std::vector<float>& err = scratch.back_err;
+    cv::calcOpticalFlowPyrLK(previous_frame.get_right_pyramid(), get_right_pyramid(), prev_right, cur_right,
+                             status, err, cv::Size(21, 21), 1,
+                             cv::TermCriteria(cv::TermCriteria::COUNT + cv::TermCriteria::EPS, 30, 0.01),
+                             cv::OPTFLOW_USE_INITIAL_FLOW, 1e-4);
+
+    // Keep a match when the right point moved with the left one, i.e. the
+    // disparity vector changed by at most MAX_STEREO_REUSE_DRIFT
+    constexpr float MAX_STEREO_REUSE_DRIFT = 1.0f;
+    FeatureRange features = get_features();
+    int reused = 0;
+    for (size_t k = 0; k < slots.size(); ++k) {
+        if (!status[k] || err[k] >= 50.0f) continue;
+        const size_t i = slots[k];
+        const cv::Point2f right_pt = cur_right[k];
+        const cv::Point2f drift = (right_pt - prev_right[k]) - (left_pts[i] - prev.get_pixel_coords()[prev_slots[k]]);
+        const float disparity = left_pts[i].x - right_pt.x;
+        if (drift.dot(drift) > MAX_STEREO_REUSE_DRIFT * MAX_STEREO_REUSE_DRIFT ||
+            disparity < 0.1f || disparity > 300.0f || std::abs(left_pts[i].y - right_pt.y) > 20.0f) {
+            continue;
+        }
+        features[i]->set_stereo_match(right_pt, disparity);
+        reused++;
+    }
+
+    VIO_LOG_DEBUG("Carried over " << reused << "/" << slots.size() << " stereo matches");
+    return reused;
+}
+
+void Frame::compute_stereo_matches_rectified(const ScanlineStereoParams& params, const Frame* previous_frame) {
+    VIO_PROFILE_SCOPE("compute_stereo_matches");
+
+    if (!is_stereo()) {
+        VIO_LOG_WARN("Cannot compute stereo matches: right image not available");
+        return;
+    }
+
+    const std::vector<cv::Point2f>& left_pts = m_features.get_pixel_coords();
+    const std::vector<uchar>& valid = m_features.get_valid_flags();
+    if (left_pts.empty()) {
+        VIO_LOG_DEBUG("No features to match in stereo");
+        return;
+    }
+
+    thread_local ScratchBuffers scratch;
+    std::vector<cv::Point2f>& right_pts = scratch.tracked_points;
+    std::vector<uchar>& status = scratch.status;
+    std::vector<float>& disparities = scratch.err;
+    right_pts.resize(left_pts.size());
+    status.resize(left_pts.size());
+    disparities.resize(left_pts.size());
+
+    // Features matched in the previous frame only search around their old disparity
+    std::vector<float>& priors = scratch.residuals;
+    priors.assign(left_pts.size(), -1.0f);
+    if (previous_frame && previous_frame->is_stereo()) {
+        const FeatureStore& prev = previous_frame->m_features;
+        const std::vector<int>& ids = m_features.get_ids();
+        for (size_t i = 0; i < ids.size(); ++i) {
+            size_t j = previous_frame->find_feature_index(ids[i]);
+            if (j < prev.size() && prev.get_valid_flags()[j] && prev.get_stereo_flags()[j]) {
+                priors[i] = prev.get_disparities()[j];
+            }
+        }
+    }
+
+    scanline_stereo_match(m_left_image, m_right_image, left_pts.data(), left_pts.size(), params,
+                          right_pts.data(), disparities.data(), status.data(), priors.data());
+
+    int matches_found = 0;
+    int reused = 0;
+    FeatureRange features = get_features();
+    for (size_t i = 0; i < left_pts.size(); ++i) {
+        if (valid[i] && status[i]) {
+            features[i]->set_stereo_match(right_pts[i], disparities[i]);
+            matches_found++;
+            reused += priors[i] >= 0.0f;
+        }
+    }
+
+    VIO_PROFILE_COUNTER(StereoMatches, matches_found);
+    VIO_PROFILE_COUNTER(StereoReused, reused);
+    VIO_LOG_DEBUG("Matched " << matches_found << "/" << left_pts.size() << " stereo features along scanlines ("
+                  << reused << " seeded by the previous frame)");
 }
 
 void Frame::estimate_depth_from_stereo(float baseline, float focal_length) {
     if (!is_stereo()) {
-        std::cout << "Cannot estimate depth: not a stereo frame" << std::endl;
+        VIO_LOG_WARN("Cannot estimate depth: not a stereo frame");
         return;
     }
 
+    // Straight pass over the disparity/depth columns
+    const std::vector<uchar>& valid = m_features.get_valid_flags();
+    const std::vector<uchar>& has_match = m_features.get_stereo_flags();
+    const std::vector<float>& disparities = m_features.get_disparities();
+    std::vector<float>& depths = m_features.get_depths();
+
     int depth_computed = 0;
-    for (auto& feature : m_features) {
-        if (feature->is_valid() && feature->has_stereo_match()) {
-            float disparity = feature->get_stereo_disparity();
+    for (size_t i = 0; i < depths.size(); ++i) {
+        if (valid[i] && has_match[i]) {
+            float disparity = disparities[i];
             if (disparity > 0.5f) {
                 float depth = (baseline * focal_length) / disparity;
                 if (depth > 0.1f && depth < 100.0f) { // Reasonable depth range
-                    feature->set_depth(depth);
+                    depths[i] = depth;
                     depth_computed++;
                 }
             }
         }
     }
 
-    std::cout << "Computed depth for " << depth_computed << " features" << std::endl;
+    VIO_LOG_DEBUG("Computed depth for " << depth_computed << " features");
 }
 
-cv::Mat Frame::compute_disparity_map() const {
+void Frame::estimate_depth_from_stereo(const StereoCamera& stereo) {
     if (!is_stereo()) {
-        std::cout << "Cannot compute disparity map: not a stereo frame" << std::endl;
-        return cv::Mat();
+        VIO_LOG_WARN("Cannot estimate depth: not a stereo frame");
+        return;
     }
 
-    cv::Ptr<cv::StereoBM> stereo = cv::StereoBM::create(16, 9);
-    cv::Mat disparity;
-    stereo->compute(m_left_image, m_right_image, disparity);
-    
-    // Normalize disparity for visualization
-    cv::Mat disparity_vis;
-    cv::normalize(disparity, disparity_vis, 0, 255, cv::NORM_MINMAX, CV_8U);
-    
-    return disparity_vis;
+    // Undistort both point columns in one batch each (slots without a match
+    // are converted too and ignored below)
+    thread_local ScratchBuffers scratch;
+    std::vector<cv::Point2f>& left_normalized = scratch.points_a;
+    std::vector<cv::Point2f>& right_normalized = scratch.points_b;
+    const size_t count = m_features.size();
+    left_normalized.resize(count);
+    right_normalized.resize(count);
+    stereo.left.undistort_points(m_features.get_pixel_coords().data(), left_normalized.data(), count);
+    stereo.right.undistort_points(m_features.get_right_coords().data(), right_normalized.data(), count);
+
+    const std::vector<uchar>& valid = m_features.get_valid_flags();
+    const std::vector<uchar>& has_match = m_features.get_stereo_flags();
+    std::vector<float>& depths = m_features.get_depths();
+    const Eigen::Matrix3d& R = stereo.right_R_left;
+    const Eigen::Vector3d& t = stereo.right_t_left;
+
+    int depth_computed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!valid[i] || !has_match[i]) continue;
+
+        // Left ray d * f_left must map onto the right ray: f_right x (d R f_left + t) = 0
+        const Eigen::Vector3d f_left(left_normalized[i].x, left_normalized[i].y, 1.0);
+        const Eigen::Vector3d f_right(right_normalized[i].x, right_normalized[i].y, 1.0);
+        const Eigen::Vector3d a = f_right.cross(R * f_left);
+        const Eigen::Vector3d b = f_right.cross(t);
+        const double aa = a.squaredNorm();
+        if (aa < 1e-12) continue;  // Parallel rays
+
+        const double depth = -a.dot(b) / aa;
+        if (depth > 0.1 && depth < 100.0) { // Reasonable depth range
+            depths[i] = static_cast<float>(depth);
+            depth_computed++;
+        }
+    }
+
+    VIO_LOG_DEBUG("Triangulated depth for " << depth_computed << " features");
+}
+
+bool Frame::compute_disparity_map(DisparityEstimator& estimator, cv::Mat& disparity) const {
+    if (!is_stereo()) {
+        VIO_LOG_WARN("Cannot compute disparity map: not a stereo frame");
+        return false;
+    }
+    return estimator.compute(m_left_image, m_right_image, disparity);
+}
+
+int Frame::estimate_depth_from_disparity(const cv::Mat& disparity, const StereoCamera& stereo) {
+    if (disparity.empty() || disparity.type() != CV_32F || !stereo.is_valid()) {
+        return 0;
+    }
+
+    const double scale = stereo.left.get_fx() * stereo.get_baseline();
+    const std::vector<cv::Point2f>& pixels = m_features.get_pixel_coords();
+    const std::vector<uchar>& valid = m_features.get_valid_flags();
+    std::vector<float>& depths = m_features.get_depths();
+
+    int depth_filled = 0;
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        if (!valid[i] || depths[i] > 0.0f) continue;
+        const float d = DisparityEstimator::sample(disparity, pixels[i]);
+        if (d <= 0.0f) continue;
+
+        const double depth = scale / d;
+        if (depth > 0.1 && depth < 100.0) { // Same range as the sparse triangulation
+            depths[i] = static_cast<float>(depth);
+            depth_filled++;
+        }
+    }
+
+    VIO_PROFILE_COUNTER(DenseDepths, depth_filled);
+    VIO_LOG_DEBUG("Looked up dense depth for " << depth_filled << " features");
+    return depth_filled;
 }
 
 } // namespace lightweight_vio
\ No newline at end of file
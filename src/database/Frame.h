@@ -1,20 +1,30 @@
 #pragma once
 
 #include "Feature.h"
+#include "FeatureStore.h"
+#include "FrameBufferPool.h"
+#include "../util/CameraModel.h"
+#include "../util/ScanlineStereo.h"
 #include <opencv2/opencv.hpp>
 #include <Eigen/Dense>
 #include <vector>
 #include <map>
 #include <memory>
 #include <chrono>
-#include <unordered_map>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
 
 namespace lightweight_vio {
 
+class ThreadPool;
+class DisparityEstimator;
+struct ScratchBuffers;
+
 class Frame {
 public:
     Frame(long long timestamp, int frame_id);
-    ~Frame() = default;
+    ~Frame();  // Returns the buffers to the pool, if attached
 
     // Getters
     long long get_timestamp() const { return m_timestamp; }
@@ -22,38 +32,90 @@ public:
     const cv::Mat& get_left_image() const { return m_left_image; }
     const cv::Mat& get_right_image() const { return m_right_image; }
     const cv::Mat& get_image() const { return m_left_image; } // For backward compatibility
-    const std::vector<std::shared_ptr<Feature>>& get_features() const { return m_features; }
+    // Feature handles over the SoA store (feature->get_pixel_coord() etc. as with Feature)
+    FeatureRange get_features() { return FeatureRange(&m_features); }
+    ConstFeatureRange get_features() const { return ConstFeatureRange(&m_features); }
+    // Direct column access for batched kernels
+    FeatureStore& get_feature_store() { return m_features; }
+    const FeatureStore& get_feature_store() const { return m_features; }
     const Eigen::Matrix3f& get_rotation() const { return m_rotation; }
     const Eigen::Vector3f& get_translation() const { return m_translation; }
     bool is_keyframe() const { return m_is_keyframe; }
     bool is_stereo() const { return !m_right_image.empty(); }
 
-    // Setters
-    void set_left_image(const cv::Mat& image) { m_left_image = image.clone(); }
-    void set_right_image(const cv::Mat& image) { m_right_image = image.clone(); }
-    void set_image(const cv::Mat& image) { m_left_image = image.clone(); } // For backward compatibility
+    // Optical-flow pyramids (cv::buildOpticalFlowPyramid), built once on first use
+    // and shared by every LK call on this frame. Safe to call from several threads.
+    const std::vector<cv::Mat>& get_left_pyramid() const;
+    const std::vector<cv::Mat>& get_right_pyramid() const;
+    int get_pyramid_levels() const { return m_pyramid_levels; }
+
+    // Setters. The const& overloads copy the pixels, for callers that keep
+    // writing to their buffer. The && overloads take the buffer over without a
+    // copy (a moved cv::Mat, or a header copy of one nobody writes any more,
+    // e.g. a pooled image); the frame keeps it alive.
+    void set_left_image(const cv::Mat& image) { m_left_image = image.clone(); m_left_pyramid.clear(); }
+    void set_right_image(const cv::Mat& image) { m_right_image = image.clone(); m_right_pyramid.clear(); }
+    void set_left_image(cv::Mat&& image) { m_left_image = std::move(image); m_left_pyramid.clear(); }
+    void set_right_image(cv::Mat&& image) { m_right_image = std::move(image); m_right_pyramid.clear(); }
+    void set_image(const cv::Mat& image) { set_left_image(image); } // For backward compatibility
     void set_stereo_images(const cv::Mat& left_image, const cv::Mat& right_image) {
-        m_left_image = left_image.clone();
-        m_right_image = right_image.clone();
+        set_left_image(left_image);
+        set_right_image(right_image);
+    }
+    void set_stereo_images(cv::Mat&& left_image, cv::Mat&& right_image) {
+        set_left_image(std::move(left_image));
+        set_right_image(std::move(right_image));
     }
+    // Must match or exceed the LK window/levels used on this frame; call before the first pyramid access
+    void set_pyramid_parameters(const cv::Size& win_size, int max_level) {
+        m_pyramid_win_size = win_size;
+        m_pyramid_levels = max_level;
+        m_left_pyramid.clear();
+        m_right_pyramid.clear();
+    }
+    // Recycled feature columns and pyramid levels (optional). A frame with no
+    // features yet takes over a spare set; an attached frame returns its own
+    // buffers to the pool when destroyed.
+    void set_buffer_pool(std::shared_ptr<FrameBufferPool> pool);
     void set_pose(const Eigen::Matrix3f& rotation, const Eigen::Vector3f& translation);
     void set_keyframe(bool is_keyframe) { m_is_keyframe = is_keyframe; }
 
     // Feature management
-    void add_feature(std::shared_ptr<Feature> feature);
+    size_t add_feature(int feature_id, const cv::Point2f& pixel_coord);  // Returns the new slot
+    void add_feature(std::shared_ptr<Feature> feature);                  // Copies into the store
     void remove_feature(int feature_id);
-    std::shared_ptr<Feature> get_feature(int feature_id);
-    std::shared_ptr<const Feature> get_feature(int feature_id) const;
+    // Batch removal in a single compaction pass; keep_mask is aligned with get_features()
+    void remove_features(const std::vector<uchar>& keep_mask);
+    void remove_features(const std::unordered_set<int>& feature_ids);
+    FeatureRef get_feature(int feature_id);              // Null handle if not present
+    ConstFeatureRef get_feature(int feature_id) const;
     size_t get_feature_count() const { return m_features.size(); }
 
     // Feature operations
-    void extract_features(int max_features = 150);
+    // Strongest corners over the whole image with min-distance suppression;
+    // tiles run on thread_pool when given
+    void extract_features(int max_features = 150, ThreadPool* thread_pool = nullptr);
     void reject_outliers_with_fundamental_matrix();
     
     // Stereo operations
-    void compute_stereo_matches();
+    // With previous_frame, features matched there are carried over first
+    // (right point tracked prev-right -> cur-right and checked against the
+    // left track); only the rest are matched left -> right
+    void compute_stereo_matches(const Frame* previous_frame = nullptr);
+    // Rectified images only: 1D SAD search along each feature's row
+    // (ScanlineStereo); no pyramids and no per-frame epipolar estimation.
+    // With previous_frame, features matched there search around their old disparity.
+    void compute_stereo_matches_rectified(const ScanlineStereoParams& params = ScanlineStereoParams(),
+                                          const Frame* previous_frame = nullptr);
     void estimate_depth_from_stereo(float baseline, float focal_length);
-    cv::Mat compute_disparity_map() const;
+    // Depth by two-ray triangulation of undistorted normalized coordinates
+    // (no rectification assumed)
+    void estimate_depth_from_stereo(const StereoCamera& stereo);
+    // Dense metric disparity (px, CV_32F, -1 = invalid); rectified pairs only
+    bool compute_disparity_map(DisparityEstimator& estimator, cv::Mat& disparity) const;
+    // Depth = f * b / disparity looked up in a dense map, for valid features
+    // that have no depth yet. Returns how many were filled.
+    int estimate_depth_from_disparity(const cv::Mat& disparity, const StereoCamera& stereo);
     
     // Visualization
     cv::Mat draw_features() const;
@@ -66,10 +128,25 @@ private:
     int m_frame_id;               // Unique frame ID
     cv::Mat m_left_image;          // Left camera grayscale image
     cv::Mat m_right_image;         // Right camera grayscale image (optional for stereo)
+
+    // Lazily built LK pyramids (with derivatives)
+    cv::Size m_pyramid_win_size = cv::Size(21, 21);
+    int m_pyramid_levels = 3;
+    mutable std::vector<cv::Mat> m_left_pyramid;
+    mutable std::vector<cv::Mat> m_right_pyramid;
+    mutable std::mutex m_left_pyramid_mutex;
+    mutable std::mutex m_right_pyramid_mutex;
+    // Recycled levels the next build writes into (guarded by the same mutexes)
+    mutable std::vector<cv::Mat> m_spare_left_pyramid;
+    mutable std::vector<cv::Mat> m_spare_right_pyramid;
+    std::shared_ptr<FrameBufferPool> m_buffer_pool;
     
-    // Features
-    std::vector<std::shared_ptr<Feature>> m_features;
-    std::unordered_map<int, size_t> m_feature_id_to_index;  // Quick lookup
+    // Features (structure of arrays)
+    FeatureStore m_features;
+    // Tracking appends survivors in the previous frame's order and new features
+    // with fresh, larger ids, so ids normally stay ascending and lookups are a
+    // binary search over the id column. Out-of-order adds fall back to a scan.
+    bool m_ids_sorted = true;
 
     // Pose (camera pose in world frame)
     Eigen::Matrix3f m_rotation;    // Rotation matrix
@@ -81,8 +158,12 @@ private:
     double m_min_distance = 30.0;
 
     // Helper functions
-    void update_feature_index();
+    void note_feature_id(int feature_id);
+    size_t find_feature_index(int feature_id) const;  // get_feature_count() if not present
+    const std::vector<cv::Mat>& build_pyramid(const cv::Mat& image, std::vector<cv::Mat>& pyramid,
+                                              std::vector<cv::Mat>& spare, std::mutex& mutex) const;
     bool is_in_border(const cv::Point2f& point, int border_size = 1) const;
+    int reuse_stereo_matches(const Frame& previous_frame, ScratchBuffers& scratch);  // Returns matches set
 };
 
 } // namespace lightweight_vio
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "FrameBufferPool.h"
+
+namespace lightweight_vio {
+
+namespace {
+
+// The level's header is the only reference, so nobody reads it any more
+void drop_shared_levels(std::vector<cv::Mat>& pyramid) {
+    for (cv::Mat& level : pyramid) {
+        if (level.u && CV_XADD(&level.u->refcount, 0) != 1) {
+            level.release();
+        }
+    }
+}
+
+} // namespace
+
+FrameBufferPool::FrameBufferPool(size_t max_spares)
+    : m_max_spares(max_spares)
+    , m_reuses(0)
+{
+    m_spares.reserve(max_spares);  // release() never allocates
+}
+
+bool FrameBufferPool::acquire(Buffers& buffers) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spares.empty()) {
+        return false;
+    }
+    buffers = std::move(m_spares.back());
+    m_spares.pop_back();
+    m_reuses++;
+    return true;
+}
+
+void FrameBufferPool::release(Buffers&& buffers) {
+    buffers.features.clear();
+    drop_shared_levels(buffers.left_pyramid);
+    drop_shared_levels(buffers.right_pyramid);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spares.size() < m_max_spares) {
+        m_spares.push_back(std::move(buffers));
+    }
+}
+
+size_t FrameBufferPool::get_spare_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spares.size();
+}
+
+size_t FrameBufferPool::get_reuse_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_reuses;
+}
+
+} // namespace lightweight_vio
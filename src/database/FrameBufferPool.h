@@ -0,0 +1,47 @@
+#pragma once
+
+#include "FeatureStore.h"
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Recycler for the per-frame heap buffers of a tracked frame: feature store
+// columns and LK pyramid levels. A frame attached to the pool
+// (Frame::set_buffer_pool) takes over a spare set and hands its own back when
+// it is destroyed, so once frames die as fast as new ones arrive a new frame
+// reuses the capacity of an old one; cv::buildOpticalFlowPyramid rebuilds
+// recycled levels in place. Spares beyond max_spares are freed. Thread-safe.
+class FrameBufferPool {
+public:
+    struct Buffers {
+        FeatureStore features;              // Empty, capacity kept
+        std::vector<cv::Mat> left_pyramid;  // Levels of an old pyramid
+        std::vector<cv::Mat> right_pyramid;
+    };
+
+    explicit FrameBufferPool(size_t max_spares = 4);
+
+    FrameBufferPool(const FrameBufferPool&) = delete;
+    FrameBufferPool& operator=(const FrameBufferPool&) = delete;
+
+    // Moves a spare set into buffers; false (buffers untouched) when there is none
+    bool acquire(Buffers& buffers);
+    // Pyramid levels still referenced outside the frame (including level-0
+    // views of its image) are dropped rather than written under a reader
+    void release(Buffers&& buffers);
+
+    // Statistics
+    size_t get_spare_count() const;
+    size_t get_reuse_count() const;  // acquire() calls served by a spare
+
+private:
+    mutable std::mutex m_mutex;
+    size_t m_max_spares;
+    std::vector<Buffers> m_spares;
+    size_t m_reuses;
+};
+
+} // namespace lightweight_vio
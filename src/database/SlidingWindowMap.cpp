@@ -0,0 +1,80 @@
+#include "SlidingWindowMap.h"
+#include "Frame.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+
+namespace lightweight_vio {
+
+SlidingWindowMap::SlidingWindowMap(size_t capacity)
+    : m_slots(std::max<size_t>(1, capacity))
+    , m_head(0)
+    , m_size(0)
+    , m_evicted_count(0)
+{
+    m_slot_by_frame.reserve(m_slots.size());
+}
+
+bool SlidingWindowMap::insert_keyframe(const Frame& frame) {
+    VIO_PROFILE_SCOPE("map_insert");
+
+    if (m_size > 0 && frame.get_frame_id() <= get_latest_keyframe().frame_id) {
+        VIO_LOG_WARN("Keyframe " << frame.get_frame_id() << " is not newer than "
+                     << get_latest_keyframe().frame_id << "; not inserted");
+        return false;
+    }
+
+    // Full: the oldest slot is reused and its observations go with it
+    size_t slot;
+    if (m_size == m_slots.size()) {
+        slot = m_head;
+        m_slot_by_frame.erase(m_slots[slot].frame_id);
+        m_head = (m_head + 1) % m_slots.size();
+        m_evicted_count++;
+        if (m_slots.size() > 1) {
+            m_tracks.evict_before(get_keyframe_at(0).frame_id);
+        } else {
+            m_tracks.clear();
+        }
+    } else {
+        slot = (m_head + m_size) % m_slots.size();
+        m_size++;
+    }
+
+    MapKeyframe& keyframe = m_slots[slot];
+    keyframe.frame_id = frame.get_frame_id();
+    keyframe.timestamp = frame.get_timestamp();
+    keyframe.rotation = frame.get_rotation();
+    keyframe.translation = frame.get_translation();
+    keyframe.features = frame.get_feature_store();  // Copy assignment reuses the slot's columns
+    m_slot_by_frame[keyframe.frame_id] = slot;
+
+    m_tracks.add_frame(frame);
+    return true;
+}
+
+void SlidingWindowMap::clear() {
+    for (MapKeyframe& keyframe : m_slots) {
+        keyframe.frame_id = -1;
+        keyframe.features.clear();
+    }
+    m_head = 0;
+    m_size = 0;
+    m_slot_by_frame.clear();
+    m_tracks.clear();
+}
+
+const MapKeyframe* SlidingWindowMap::get_keyframe(int frame_id) const {
+    auto it = m_slot_by_frame.find(frame_id);
+    return it != m_slot_by_frame.end() ? &m_slots[it->second] : nullptr;
+}
+
+size_t SlidingWindowMap::get_memory_bytes() const {
+    size_t bytes = m_slots.size() * sizeof(MapKeyframe) + m_tracks.get_memory_bytes();
+    for (const MapKeyframe& keyframe : m_slots) {
+        bytes += keyframe.features.get_memory_bytes();
+    }
+    return bytes;
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include "FeatureStore.h"
+#include "TrackStore.h"
+
+namespace lightweight_vio {
+
+class Frame;
+
+// What the map keeps of a keyframe: pose and features, no images
+struct MapKeyframe {
+    int frame_id = -1;
+    long long timestamp = 0;
+    Eigen::Matrix3f rotation = Eigen::Matrix3f::Identity();
+    Eigen::Vector3f translation = Eigen::Vector3f::Zero();
+    FeatureStore features;
+};
+
+// The last `capacity` keyframes in a fixed ring, plus the observation
+// history of every feature seen in them (TrackStore). Inserting into a full
+// window overwrites the oldest slot and evicts its observations, and slots
+// keep their column capacity, so memory stays flat over long runs.
+//
+// Not thread-safe; owned by whoever consumes the frontend's frames.
+class SlidingWindowMap {
+public:
+    explicit SlidingWindowMap(size_t capacity = 10);
+
+    SlidingWindowMap(const SlidingWindowMap&) = delete;
+    SlidingWindowMap& operator=(const SlidingWindowMap&) = delete;
+
+    // Copies the frame's pose and features. Returns false (and inserts
+    // nothing) unless frame_id is newer than the latest keyframe.
+    bool insert_keyframe(const Frame& frame);
+    void clear();
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t get_capacity() const { return m_slots.size(); }
+    // index 0 = oldest
+    const MapKeyframe& get_keyframe_at(size_t index) const { return m_slots[(m_head + index) % m_slots.size()]; }
+    const MapKeyframe& get_latest_keyframe() const { return get_keyframe_at(m_size - 1); }
+    const MapKeyframe* get_keyframe(int frame_id) const;  // Null if not in the window
+
+    const TrackStore& get_tracks() const { return m_tracks; }
+    size_t get_evicted_count() const { return m_evicted_count; }
+    // Keyframe columns and track observations, including spare capacity
+    size_t get_memory_bytes() const;
+
+private:
+    std::vector<MapKeyframe> m_slots;
+    size_t m_head;   // Slot of the oldest keyframe
+    size_t m_size;
+    std::unordered_map<int, size_t> m_slot_by_frame;
+    TrackStore m_tracks;
+    size_t m_evicted_count;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,176 @@
+#include "TrackStore.h"
+#include "Frame.h"
+#include <algorithm>
+
+namespace lightweight_vio {
+
+namespace {
+
+template<typename T>
+void erase_front(std::vector<T>& column, size_t count) {
+    column.erase(column.begin(), column.begin() + count);
+}
+
+template<typename T>
+size_t column_bytes(const std::vector<T>& column) {
+    return column.capacity() * sizeof(T);
+}
+
+} // namespace
+
+int TrackView::find(int frame_id) const {
+    const int* end = frame_ids + size;
+    const int* it = std::lower_bound(frame_ids, end, frame_id);
+    return it != end && *it == frame_id ? static_cast<int>(it - frame_ids) : -1;
+}
+
+void TrackStore::reserve(size_t num_tracks) {
+    m_tracks.reserve(num_tracks);
+    m_free_slots.reserve(num_tracks);
+    m_slot_by_id.reserve(num_tracks);
+}
+
+void TrackStore::clear() {
+    for (size_t slot = 0; slot < m_tracks.size(); ++slot) {
+        if (m_tracks[slot].feature_id >= 0) {
+            release_track(slot);
+        }
+    }
+    m_observation_count = 0;
+}
+
+TrackStore::Track& TrackStore::acquire_track(int feature_id) {
+    size_t slot;
+    if (!m_free_slots.empty()) {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+    } else {
+        slot = m_tracks.size();
+        m_tracks.emplace_back();
+    }
+    m_tracks[slot].feature_id = feature_id;
+    m_slot_by_id.emplace(feature_id, slot);
+    return m_tracks[slot];
+}
+
+void TrackStore::release_track(size_t slot) {
+    Track& track = m_tracks[slot];
+    m_slot_by_id.erase(track.feature_id);
+    // Keep the capacity for the next track
+    track.feature_id = -1;
+    track.begin = 0;
+    track.frame_ids.clear();
+    track.pixel_coords.clear();
+    track.normalized_coords.clear();
+    track.depths.clear();
+    m_free_slots.push_back(slot);
+}
+
+void TrackStore::drop_front(Track& track) {
+    // Shift only once the dead prefix is as long as the live part, so
+    // eviction stays amortized O(1) per observation
+    if (track.begin == 0 || track.begin < track.size()) {
+        return;
+    }
+    erase_front(track.frame_ids, track.begin);
+    erase_front(track.pixel_coords, track.begin);
+    erase_front(track.normalized_coords, track.begin);
+    erase_front(track.depths, track.begin);
+    track.begin = 0;
+}
+
+void TrackStore::add_observation(int feature_id, int frame_id, const cv::Point2f& pixel_coord,
+                                 const cv::Point2f& normalized_coord, float depth) {
+    auto it = m_slot_by_id.find(feature_id);
+    Track& track = it != m_slot_by_id.end() ? m_tracks[it->second] : acquire_track(feature_id);
+    if (track.size() > 0 && track.frame_ids.back() >= frame_id) {
+        return;
+    }
+    track.frame_ids.push_back(frame_id);
+    track.pixel_coords.push_back(pixel_coord);
+    track.normalized_coords.push_back(normalized_coord);
+    track.depths.push_back(depth);
+    m_observation_count++;
+}
+
+void TrackStore::add_frame(const Frame& frame) {
+    const FeatureStore& store = frame.get_feature_store();
+    const std::vector<int>& ids = store.get_ids();
+    const std::vector<cv::Point2f>& pixels = store.get_pixel_coords();
+    const std::vector<cv::Point2f>& normalized = store.get_normalized_coords();
+    const std::vector<float>& depths = store.get_depths();
+    const std::vector<uchar>& valid = store.get_valid_flags();
+    const int frame_id = frame.get_frame_id();
+
+    for (size_t i = 0; i < store.size(); ++i) {
+        if (valid[i]) {
+            add_observation(ids[i], frame_id, pixels[i], normalized[i], depths[i]);
+        }
+    }
+}
+
+size_t TrackStore::evict_before(int frame_id) {
+    size_t dropped = 0;
+    for (size_t slot = 0; slot < m_tracks.size(); ++slot) {
+        Track& track = m_tracks[slot];
+        if (track.feature_id < 0) {
+            continue;
+        }
+        const size_t old_begin = track.begin;
+        while (track.begin < track.frame_ids.size() && track.frame_ids[track.begin] < frame_id) {
+            track.begin++;
+        }
+        dropped += track.begin - old_begin;
+        if (track.size() == 0) {
+            release_track(slot);
+        } else {
+            drop_front(track);
+        }
+    }
+    m_observation_count -= dropped;
+    return dropped;
+}
+
+void TrackStore::remove_track(int feature_id) {
+    auto it = m_slot_by_id.find(feature_id);
+    if (it == m_slot_by_id.end()) {
+        return;
+    }
+    m_observation_count -= m_tracks[it->second].size();
+    release_track(it->second);
+}
+
+TrackView TrackStore::get_track(int feature_id) const {
+    TrackView view;
+    auto it = m_slot_by_id.find(feature_id);
+    if (it == m_slot_by_id.end()) {
+        return view;
+    }
+    const Track& track = m_tracks[it->second];
+    view.feature_id = feature_id;
+    view.size = track.size();
+    view.frame_ids = track.frame_ids.data() + track.begin;
+    view.pixel_coords = track.pixel_coords.data() + track.begin;
+    view.normalized_coords = track.normalized_coords.data() + track.begin;
+    view.depths = track.depths.data() + track.begin;
+    return view;
+}
+
+void TrackStore::get_feature_ids(std::vector<int>& feature_ids) const {
+    feature_ids.clear();
+    feature_ids.reserve(m_slot_by_id.size());
+    for (const auto& entry : m_slot_by_id) {
+        feature_ids.push_back(entry.first);
+    }
+}
+
+size_t TrackStore::get_memory_bytes() const {
+    size_t bytes = m_tracks.capacity() * sizeof(Track) + m_free_slots.capacity() * sizeof(size_t);
+    for (const Track& track : m_tracks) {
+        bytes += column_bytes(track.frame_ids) + column_bytes(track.pixel_coords) +
+                 column_bytes(track.normalized_coords) + column_bytes(track.depths);
+    }
+    return bytes;
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace lightweight_vio {
+
+class Frame;
+
+// Read-only view of one feature's observations, oldest first. Each column is
+// contiguous; frame ids are strictly increasing. Invalidated by the next
+// add/evict/remove on the store.
+struct TrackView {
+    int feature_id = -1;
+    size_t size = 0;
+    const int* frame_ids = nullptr;
+    const cv::Point2f* pixel_coords = nullptr;
+    const cv::Point2f* normalized_coords = nullptr;
+    const float* depths = nullptr;      // -1 = no depth in that frame
+
+    bool empty() const { return size == 0; }
+    // Index of the observation from frame_id, or -1 (binary search)
+    int find(int frame_id) const;
+};
+
+// Observation history per feature id: frame id, pixel, normalized coordinates
+// and depth, one structure-of-arrays track per feature. Appending is O(1)
+// (amortized), finding a track is one hash lookup, and evict_before() drops
+// every observation older than a frame in one pass over the live tracks.
+// Emptied tracks go back to a free list with their capacity, so a bounded
+// window keeps memory flat however long the sequence runs.
+//
+// Not thread-safe.
+class TrackStore {
+public:
+    void reserve(size_t num_tracks);
+    void clear();
+
+    // One observation; ignored unless frame_id is newer than the track's last
+    void add_observation(int feature_id, int frame_id, const cv::Point2f& pixel_coord,
+                         const cv::Point2f& normalized_coord, float depth);
+    // Every valid feature of the frame
+    void add_frame(const Frame& frame);
+
+    // Drop observations from frames before frame_id; tracks left empty are
+    // recycled. Returns the number of observations dropped.
+    size_t evict_before(int frame_id);
+    void remove_track(int feature_id);
+
+    bool has_track(int feature_id) const { return m_slot_by_id.count(feature_id) != 0; }
+    TrackView get_track(int feature_id) const;  // Empty view if not present
+    // Ids of all live tracks (unordered)
+    void get_feature_ids(std::vector<int>& feature_ids) const;
+
+    size_t get_track_count() const { return m_slot_by_id.size(); }
+    size_t get_observation_count() const { return m_observation_count; }
+    // Bytes held by the observation columns, including spare capacity
+    size_t get_memory_bytes() const;
+
+private:
+    struct Track {
+        int feature_id = -1;  // -1 = free slot
+        size_t begin = 0;     // First live observation; older ones await compaction
+        std::vector<int> frame_ids;
+        std::vector<cv::Point2f> pixel_coords;
+        std::vector<cv::Point2f> normalized_coords;
+        std::vector<float> depths;
+
+        size_t size() const { return frame_ids.size() - begin; }
+    };
+
+    Track& acquire_track(int feature_id);
+    void release_track(size_t slot);
+    static void drop_front(Track& track);
+
+    std::vector<Track> m_tracks;
+    std::vector<size_t> m_free_slots;
+    std::unordered_map<int, size_t> m_slot_by_id;
+    size_t m_observation_count = 0;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,196 @@
+#include "Calibration.h"
+#include "../util/Logger.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace lightweight_vio {
+
+namespace {
+
+// Whole file with '#' comments stripped; empty if it cannot be read
+std::string read_without_comments(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) return std::string();
+
+    std::string text, line;
+    while (std::getline(file, line)) {
+        text += line.substr(0, line.find('#'));
+        text += '\n';
+    }
+    return text;
+}
+
+// Position just after "key:" where key starts a line (after indentation), from 'from' on
+size_t find_key(const std::string& text, const std::string& key, size_t from = 0) {
+    const std::string pattern = key + ":";
+    for (size_t pos = text.find(pattern, from); pos != std::string::npos; pos = text.find(pattern, pos + 1)) {
+        size_t line_start = pos;
+        while (line_start > 0 && (text[line_start - 1] == ' ' || text[line_start - 1] == '\t')) line_start--;
+        if (line_start == 0 || text[line_start - 1] == '\n') return pos + pattern.size();
+    }
+    return std::string::npos;
+}
+
+// Numbers of a value: a [..] flow list (may span lines) or the rest of the line
+std::vector<double> parse_numbers(const std::string& text, size_t pos) {
+    std::vector<double> numbers;
+    if (pos == std::string::npos) return numbers;
+
+    size_t start = text.find_first_not_of(" \t", pos);
+    size_t end;
+    if (start != std::string::npos && text[start] == '[') {
+        start++;
+        end = text.find(']', start);
+    } else {
+        end = text.find('\n', pos);
+    }
+    if (start == std::string::npos || end == std::string::npos) return numbers;
+
+    std::string values = text.substr(start, end - start);
+    for (char& c : values) {
+        if (c == ',') c = ' ';
+    }
+    std::istringstream ss(values);
+    double value;
+    while (ss >> value) numbers.push_back(value);
+    return numbers;
+}
+
+std::string parse_word(const std::string& text, size_t pos) {
+    if (pos == std::string::npos) return std::string();
+    std::istringstream ss(text.substr(pos, text.find('\n', pos) - pos));
+    std::string word;
+    ss >> word;
+    return word;
+}
+
+} // namespace
+
+bool load_euroc_camera(const std::string& sensor_yaml, CameraModel& camera) {
+    const std::string text = read_without_comments(sensor_yaml);
+    if (text.empty()) {
+        VIO_LOG_ERROR("Cannot open camera calibration: " << sensor_yaml);
+        return false;
+    }
+
+    const std::string camera_model = parse_word(text, find_key(text, "camera_model"));
+    const std::vector<double> resolution = parse_numbers(text, find_key(text, "resolution"));
+    const std::vector<double> intrinsics = parse_numbers(text, find_key(text, "intrinsics"));
+    const std::string distortion_name = parse_word(text, find_key(text, "distortion_model"));
+    const std::vector<double> coefficients = parse_numbers(text, find_key(text, "distortion_coefficients"));
+    const size_t t_bs = find_key(text, "T_BS");
+    const std::vector<double> body_from_camera =
+        t_bs == std::string::npos ? std::vector<double>() : parse_numbers(text, find_key(text, "data", t_bs));
+
+    if (camera_model != "pinhole" || resolution.size() != 2 || intrinsics.size() != 4) {
+        VIO_LOG_ERROR("Unsupported camera calibration in " << sensor_yaml
+                      << " (need a pinhole model with resolution and 4 intrinsics)");
+        return false;
+    }
+
+    DistortionModel distortion;
+    if (distortion_name == "radial-tangential" || distortion_name == "radtan") {
+        distortion = DistortionModel::RadialTangential;
+    } else if (distortion_name == "equidistant") {
+        distortion = DistortionModel::Equidistant;
+    } else if (distortion_name.empty() || distortion_name == "none") {
+        distortion = DistortionModel::None;
+    } else {
+        VIO_LOG_ERROR("Unsupported distortion model '" << distortion_name << "' in " << sensor_yaml);
+        return false;
+    }
+    std::array<double, 4> k = {{0.0, 0.0, 0.0, 0.0}};
+    if (distortion != DistortionModel::None) {
+        if (coefficients.size() != 4) {
+            VIO_LOG_ERROR("Expected 4 distortion coefficients in " << sensor_yaml);
+            return false;
+        }
+        std::copy(coefficients.begin(), coefficients.end(), k.begin());
+    }
+
+    camera = CameraModel(cv::Size(static_cast<int>(resolution[0]), static_cast<int>(resolution[1])),
+                         intrinsics[0], intrinsics[1], intrinsics[2], intrinsics[3], distortion, k);
+    if (body_from_camera.size() == 16) {
+        camera.set_body_from_camera(Eigen::Map<const Eigen::Matrix<double, 4, 4, Eigen::RowMajor>>(body_from_camera.data()));
+    } else {
+        VIO_LOG_WARN("No T_BS in " << sensor_yaml << "; assuming the camera frame is the body frame");
+    }
+    return true;
+}
+
+bool load_euroc_stereo(const std::string& dataset_path, StereoCamera& stereo) {
+    StereoCamera result;
+    if (!load_euroc_camera(dataset_path + "/mav0/cam0/sensor.yaml", result.left) ||
+        !load_euroc_camera(dataset_path + "/mav0/cam1/sensor.yaml", result.right)) {
+        return false;
+    }
+
+    // right <- body <- left
+    const Eigen::Matrix4d right_from_left =
+        result.right.get_body_from_camera().inverse() * result.left.get_body_from_camera();
+    result.right_R_left = right_from_left.topLeftCorner<3, 3>();
+    result.right_t_left = right_from_left.topRightCorner<3, 1>();
+    if (!result.is_valid()) {
+        VIO_LOG_ERROR("EuRoC cam0/cam1 calibration has no stereo baseline");
+        return false;
+    }
+
+    stereo = result;
+    VIO_LOG_INFO("Loaded EuRoC stereo calibration, baseline " << stereo.get_baseline() << " m");
+    return true;
+}
+
+bool load_kitti_stereo(const std::string& calib_path, const cv::Size& image_size, StereoCamera& stereo) {
+    std::ifstream file(calib_path);
+    if (!file.is_open()) {
+        VIO_LOG_ERROR("Cannot open KITTI calibration: " << calib_path);
+        return false;
+    }
+
+    std::map<std::string, std::vector<double>> matrices;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) continue;
+        std::istringstream ss(line.substr(colon + 1));
+        std::vector<double>& values = matrices[line.substr(0, colon)];
+        double value;
+        while (ss >> value) values.push_back(value);
+    }
+
+    // P = K [I | t] in the rectified frame of camera 0
+    auto camera_from_projection = [&](const std::string& name, CameraModel& camera, Eigen::Vector3d& t) {
+        auto it = matrices.find(name);
+        if (it == matrices.end() || it->second.size() != 12) {
+            VIO_LOG_ERROR("Missing 3x4 projection " << name << " in " << calib_path);
+            return false;
+        }
+        const std::vector<double>& P = it->second;
+        camera = CameraModel(image_size, P[0], P[5], P[2], P[6]);
+        t.z() = P[11];
+        t.y() = (P[7] - P[6] * t.z()) / P[5];
+        t.x() = (P[3] - P[1] * t.y() - P[2] * t.z()) / P[0];
+        return camera.is_valid();
+    };
+
+    StereoCamera result;
+    Eigen::Vector3d t_left, t_right;
+    if (!camera_from_projection("P0", result.left, t_left) || !camera_from_projection("P1", result.right, t_right)) {
+        return false;
+    }
+    result.right_t_left = t_right - t_left;
+    if (!result.is_valid()) {
+        VIO_LOG_ERROR("KITTI P0/P1 in " << calib_path << " have no stereo baseline");
+        return false;
+    }
+
+    stereo = result;
+    VIO_LOG_INFO("Loaded KITTI stereo calibration, baseline " << stereo.get_baseline() << " m");
+    return true;
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <string>
+#include "../util/CameraModel.h"
+
+namespace lightweight_vio {
+
+// One camera from an EuRoC (Kalibr) sensor.yaml: resolution, pinhole intrinsics,
+// radial-tangential or equidistant distortion and T_BS
+bool load_euroc_camera(const std::string& sensor_yaml, CameraModel& camera);
+
+// cam0 (left) and cam1 (right) of an EuRoC sequence; the stereo transform is
+// derived from the two T_BS
+bool load_euroc_stereo(const std::string& dataset_path, StereoCamera& stereo);
+
+// P0 (left) and P1 (right) of a KITTI odometry calib.txt. The images are
+// rectified, so there is no distortion; calib.txt carries no resolution, so
+// the image size is passed in.
+bool load_kitti_stereo(const std::string& calib_path, const cv::Size& image_size, StereoCamera& stereo);
+
+} // namespace lightweight_vio
@@ -0,0 +1,208 @@
+#include "DatasetReader.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace lightweight_vio {
+
+namespace {
+
+// Helper function to trim whitespace
+std::string trim(const std::string& str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return "";
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, (last - first + 1));
+}
+
+} // namespace
+
+DatasetReader::DatasetReader(const std::string& dataset_path)
+    : m_dataset_path(dataset_path)
+    , m_image_data(load_image_timestamps(dataset_path))
+    , m_end_index(m_image_data.size())
+    , m_num_workers(2)
+    , m_queue_capacity(8)
+    , m_apply_clahe(true)
+    , m_clahe_clip_limit(2.0)
+    , m_clahe_tile_grid(cv::Size(8, 8))
+    , m_load_right(true)
+    , m_fused_preprocessing(false)
+    , m_pyramid_border(21, 21)
+    , m_next_to_decode(0)
+    , m_next_to_pop(0)
+    , m_stopping(false)
+{
+}
+
+DatasetReader::~DatasetReader() {
+    stop();
+}
+
+void DatasetReader::set_max_frames(size_t max_frames) {
+    m_end_index = (max_frames > 0) ? std::min(max_frames, m_image_data.size()) : m_image_data.size();
+}
+
+void DatasetReader::start(size_t first_index) {
+    stop();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.clear();
+        m_next_to_decode = std::min(first_index, m_end_index);
+        m_next_to_pop = m_next_to_decode;
+        m_stopping = false;
+    }
+
+    for (int i = 0; i < m_num_workers; ++i) {
+        m_workers.emplace_back(&DatasetReader::worker_loop, this);
+    }
+}
+
+void DatasetReader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_space_cv.notify_all();
+    m_ready_cv.notify_all();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+bool DatasetReader::pop(StereoImageData& data) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_workers.empty() || m_next_to_pop >= m_end_index) {
+        return false;
+    }
+
+    m_ready_cv.wait(lock, [this] { return m_stopping || m_ready.count(m_next_to_pop) > 0; });
+    if (m_stopping) {
+        return false;
+    }
+
+    auto it = m_ready.find(m_next_to_pop);
+    data = std::move(it->second);
+    m_ready.erase(it);
+    m_next_to_pop++;
+    lock.unlock();
+
+    m_space_cv.notify_all();
+    return true;
+}
+
+void DatasetReader::worker_loop() {
+    // The preprocessor keeps per-camera CLAHE state and buffers, so every
+    // worker owns its own instance. A single worker gets a helper thread for
+    // the right image; several workers already overlap whole frames.
+    ImagePreprocessor preprocessor;
+    preprocessor.set_clahe(m_apply_clahe, m_clahe_clip_limit, m_clahe_tile_grid);
+    preprocessor.set_rectifier(m_rectifier);
+    preprocessor.set_fused(m_fused_preprocessing, m_pyramid_border);
+    preprocessor.set_image_pool(m_image_pool);
+    preprocessor.set_concurrent_stereo(m_num_workers == 1);
+
+    while (true) {
+        size_t index;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_space_cv.wait(lock, [this] {
+                return m_stopping || m_next_to_decode >= m_end_index ||
+                       m_next_to_decode < m_next_to_pop + m_queue_capacity;
+            });
+            if (m_stopping || m_next_to_decode >= m_end_index) {
+                return;
+            }
+            index = m_next_to_decode++;
+        }
+
+        StereoImageData data = decode(index, preprocessor);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) {
+                return;
+            }
+            m_ready.emplace(index, std::move(data));
+        }
+        m_ready_cv.notify_all();
+    }
+}
+
+StereoImageData DatasetReader::decode(size_t index, ImagePreprocessor& preprocessor) const {
+    VIO_PROFILE_SCOPE("dataset_decode");
+
+    const ImageData& image = m_image_data[index];
+    StereoImageData data;
+    data.index = index;
+    data.timestamp = image.timestamp;
+    data.filename = image.filename;
+
+    cv::Mat left_image = load_image(m_dataset_path, image.filename, 0);
+    cv::Mat right_image = m_load_right ? load_image(m_dataset_path, image.filename, 1) : cv::Mat();
+    if (left_image.empty()) {
+        return data;
+    }
+
+    // The last preprocessing step writes each output pixel once, into a
+    // buffer the frame can take over (pooled when a pool is set)
+    if (!preprocessor.process_stereo(left_image, right_image, data.left_image, data.right_image)) {
+        data.left_image.release();
+        data.right_image.release();
+    }
+    return data;
+}
+
+std::vector<ImageData> DatasetReader::load_image_timestamps(const std::string& dataset_path) {
+    std::vector<ImageData> image_data;
+    std::string data_file = dataset_path + "/mav0/cam0/data.csv";
+
+    std::ifstream file(data_file);
+    if (!file.is_open()) {
+        VIO_LOG_ERROR("Cannot open data.csv file: " << data_file);
+        return image_data;
+    }
+
+    std::string line;
+    std::getline(file, line); // Skip header
+
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::stringstream ss(line);
+        std::string timestamp_str, filename;
+
+        if (std::getline(ss, timestamp_str, ',') && std::getline(ss, filename)) {
+            ImageData data;
+            data.timestamp = std::stoll(trim(timestamp_str));
+            data.filename = trim(filename);
+            image_data.push_back(data);
+        }
+    }
+
+    // Frames are delivered in timestamp order regardless of the csv order
+    std::stable_sort(image_data.begin(), image_data.end(),
+                     [](const ImageData& a, const ImageData& b) { return a.timestamp < b.timestamp; });
+
+    VIO_LOG_INFO("Loaded " << image_data.size() << " image timestamps");
+    return image_data;
+}
+
+cv::Mat DatasetReader::load_image(const std::string& dataset_path, const std::string& filename, int cam_id) {
+    std::string cam_folder = (cam_id == 0) ? "cam0" : "cam1";
+    std::string full_path = dataset_path + "/mav0/" + cam_folder + "/data/" + filename;
+    cv::Mat image = cv::imread(full_path, cv::IMREAD_GRAYSCALE);
+
+    if (image.empty()) {
+        VIO_LOG_WARN("Cannot load image: " << full_path);
+    }
+
+    return image;
+}
+
+} // namespace lightweight_vio
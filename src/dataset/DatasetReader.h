@@ -0,0 +1,116 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../util/ImagePool.h"
+#include "../util/ImagePreprocessor.h"
+#include "../util/StereoRectifier.h"
+
+namespace lightweight_vio {
+
+struct ImageData {
+    long long timestamp;
+    std::string filename;
+};
+
+// One decoded (and optionally CLAHE-equalized) stereo pair. The images are
+// not referenced by the reader any more, so they can be moved into a Frame.
+struct StereoImageData {
+    size_t index;
+    long long timestamp;
+    std::string filename;
+    cv::Mat left_image;
+    cv::Mat right_image;
+};
+
+// Prefetching EuRoC reader. Worker threads decode cam0/cam1 PNGs and run them
+// through an ImagePreprocessor (rectification, CLAHE) ahead of the consumer
+// into a bounded look-ahead window; pop() hands frames out strictly in
+// timestamp order, so the tracker thread only ever receives ready images.
+class DatasetReader {
+public:
+    explicit DatasetReader(const std::string& dataset_path);
+    ~DatasetReader();
+
+    DatasetReader(const DatasetReader&) = delete;
+    DatasetReader& operator=(const DatasetReader&) = delete;
+
+    // Configuration (takes effect on the next start()/seek())
+    void set_num_workers(int num_workers) { m_num_workers = std::max(1, num_workers); }
+    int get_num_workers() const { return m_num_workers; }
+    void set_queue_capacity(size_t capacity) { m_queue_capacity = std::max<size_t>(1, capacity); }
+    size_t get_queue_capacity() const { return m_queue_capacity; }
+    void set_clahe(bool enabled, double clip_limit = 2.0, const cv::Size& tile_grid = cv::Size(8, 8)) {
+        m_apply_clahe = enabled;
+        m_clahe_clip_limit = clip_limit;
+        m_clahe_tile_grid = tile_grid;
+    }
+    void set_load_right(bool load_right) { m_load_right = load_right; }
+    // Rectify both images on the decode workers, right before CLAHE (null = off)
+    void set_rectifier(std::shared_ptr<const StereoRectifier> rectifier) { m_rectifier = std::move(rectifier); }
+    // Write the final (rectified / CLAHE) images into recycled buffers (null = fresh allocations)
+    void set_image_pool(std::shared_ptr<ImagePool> pool) { m_image_pool = std::move(pool); }
+    // Fused remap + CLAHE + pyramid border pass (ImagePreprocessor); pyramid_border
+    // must be at least the frame's pyramid window
+    void set_fused_preprocessing(bool fused, const cv::Size& pyramid_border = cv::Size(21, 21)) {
+        m_fused_preprocessing = fused;
+        m_pyramid_border = pyramid_border;
+    }
+
+    // Sequence access
+    const std::vector<ImageData>& get_image_data() const { return m_image_data; }
+    size_t size() const { return m_end_index; }
+    void set_max_frames(size_t max_frames);
+
+    // Start decoding at index; restarts the workers if already running
+    void start(size_t first_index = 0);
+    void seek(size_t index) { start(index); }
+    void stop();
+
+    // Block until the next frame is decoded. Returns false at end of sequence.
+    // A frame whose left image failed to load is returned with an empty left_image.
+    bool pop(StereoImageData& data);
+
+    // Dataset helpers
+    static std::vector<ImageData> load_image_timestamps(const std::string& dataset_path);
+    static cv::Mat load_image(const std::string& dataset_path, const std::string& filename, int cam_id = 0);
+
+private:
+    void worker_loop();
+    StereoImageData decode(size_t index, ImagePreprocessor& preprocessor) const;
+
+    std::string m_dataset_path;
+    std::vector<ImageData> m_image_data;
+    size_t m_end_index;
+
+    // Configuration
+    int m_num_workers;
+    size_t m_queue_capacity;
+    bool m_apply_clahe;
+    double m_clahe_clip_limit;
+    cv::Size m_clahe_tile_grid;
+    bool m_load_right;
+    std::shared_ptr<const StereoRectifier> m_rectifier;
+    std::shared_ptr<ImagePool> m_image_pool;
+    bool m_fused_preprocessing;
+    cv::Size m_pyramid_border;
+
+    // Look-ahead window state, guarded by m_mutex
+    std::mutex m_mutex;
+    std::condition_variable m_ready_cv;   // consumer waits for m_next_to_pop
+    std::condition_variable m_space_cv;   // workers wait for window space
+    std::map<size_t, StereoImageData> m_ready;
+    size_t m_next_to_decode;
+    size_t m_next_to_pop;
+    bool m_stopping;
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,67 @@
+#include "GroundTruth.h"
+#include "../util/Logger.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace lightweight_vio {
+
+bool load_euroc_groundtruth(const std::string& dataset_path, std::vector<GroundTruthPose>& poses) {
+    poses.clear();
+    const std::string path = dataset_path + "/mav0/state_groundtruth_estimate0/data.csv";
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        VIO_LOG_WARN("Cannot open ground truth: " << path);
+        return false;
+    }
+
+    // timestamp, p_RS_R xyz, q_RS wxyz, then velocity and biases (ignored)
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        for (char& c : line) {
+            if (c == ',') c = ' ';
+        }
+        std::istringstream ss(line);
+        long long timestamp;
+        double px, py, pz, qw, qx, qy, qz;
+        if (!(ss >> timestamp >> px >> py >> pz >> qw >> qx >> qy >> qz)) continue;
+
+        GroundTruthPose pose;
+        pose.timestamp = timestamp;
+        pose.position = Eigen::Vector3d(px, py, pz);
+        pose.rotation = Eigen::Quaterniond(qw, qx, qy, qz).normalized();
+        poses.push_back(pose);
+    }
+
+    std::sort(poses.begin(), poses.end(),
+              [](const GroundTruthPose& a, const GroundTruthPose& b) { return a.timestamp < b.timestamp; });
+    VIO_LOG_INFO("Loaded " << poses.size() << " ground-truth poses");
+    return !poses.empty();
+}
+
+bool interpolate_groundtruth(const std::vector<GroundTruthPose>& poses, long long timestamp,
+                             Eigen::Matrix4d& world_T_body, long long max_gap_ns) {
+    auto after = std::lower_bound(poses.begin(), poses.end(), timestamp,
+                                  [](const GroundTruthPose& pose, long long t) { return pose.timestamp < t; });
+    if (after == poses.end()) {
+        return false;
+    }
+    auto before = after;
+    if (after->timestamp != timestamp) {
+        if (after == poses.begin()) return false;
+        --before;
+    }
+    if (after->timestamp - before->timestamp > max_gap_ns) {
+        return false;
+    }
+
+    const double span = static_cast<double>(after->timestamp - before->timestamp);
+    const double alpha = span > 0.0 ? (timestamp - before->timestamp) / span : 0.0;
+    world_T_body.setIdentity();
+    world_T_body.topLeftCorner<3, 3>() = before->rotation.slerp(alpha, after->rotation).toRotationMatrix();
+    world_T_body.topRightCorner<3, 1>() = (1.0 - alpha) * before->position + alpha * after->position;
+    return true;
+}
+
+} // namespace lightweight_vio
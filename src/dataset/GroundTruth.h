@@ -0,0 +1,25 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Body (IMU) pose in the ground-truth world frame
+struct GroundTruthPose {
+    long long timestamp;  // ns
+    Eigen::Vector3d position;
+    Eigen::Quaterniond rotation;
+};
+
+// mav0/state_groundtruth_estimate0/data.csv of an EuRoC sequence, sorted by timestamp
+bool load_euroc_groundtruth(const std::string& dataset_path, std::vector<GroundTruthPose>& poses);
+
+// world_T_body at timestamp, interpolated between the two neighbouring samples
+// (linear position, slerp rotation). False outside the recorded range or when
+// the neighbours are more than max_gap_ns apart.
+bool interpolate_groundtruth(const std::vector<GroundTruthPose>& poses, long long timestamp,
+                             Eigen::Matrix4d& world_T_body, long long max_gap_ns = 20000000);
+
+} // namespace lightweight_vio
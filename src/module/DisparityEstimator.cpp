@@ -0,0 +1,165 @@
+#include "DisparityEstimator.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lightweight_vio {
+
+namespace {
+
+// Rows matched above and below each strip. BM only looks at its block (plus
+// the 9x9 prefilter); SGM aggregation reaches further, but P2 lets the
+// influence of distant rows die out well within this margin.
+int strip_overlap(const DisparityParams& params) {
+    return params.mode == DisparityMode::BlockMatching ? params.block_size / 2 + 5 : 32;
+}
+
+int round_up_16(int value) {
+    return std::max(16, (value + 15) / 16 * 16);
+}
+
+} // namespace
+
+DisparityEstimator::DisparityEstimator(const DisparityParams& params)
+    : m_thread_pool(nullptr)
+{
+    set_params(params);
+}
+
+void DisparityEstimator::set_params(const DisparityParams& params) {
+    m_params = params;
+    m_params.num_disparities = round_up_16(params.num_disparities);
+    m_params.block_size = std::max(params.mode == DisparityMode::BlockMatching ? 5 : 1, params.block_size | 1);
+    m_params.num_strips = std::max(1, params.num_strips);
+    // Rebuild the matchers on the next compute()
+    m_configured_size = cv::Size();
+    m_strips.clear();
+}
+
+cv::Ptr<cv::StereoMatcher> DisparityEstimator::create_matcher(int num_disparities) const {
+    const int min_disparity = m_params.half_resolution ? m_params.min_disparity / 2 : m_params.min_disparity;
+    const int block = m_params.block_size;
+    if (m_params.mode == DisparityMode::BlockMatching) {
+        cv::Ptr<cv::StereoBM> bm = cv::StereoBM::create(num_disparities, block);
+        bm->setMinDisparity(min_disparity);
+        bm->setUniquenessRatio(m_params.uniqueness_ratio);
+        return bm;
+    }
+    // Usual smoothness penalties for single-channel images; single-pass 5-path mode
+    return cv::StereoSGBM::create(min_disparity, num_disparities, block, 8 * block * block, 32 * block * block,
+                                  1, 31, m_params.uniqueness_ratio, 0, 0, cv::StereoSGBM::MODE_SGBM);
+}
+
+void DisparityEstimator::configure(const cv::Size& size) {
+    if (size == m_configured_size) {
+        return;
+    }
+
+    const int num_disparities = m_params.half_resolution ? round_up_16(m_params.num_disparities / 2)
+                                                         : m_params.num_disparities;
+    const int overlap = strip_overlap(m_params);
+    // Strips much thinner than their overlap would mostly re-match shared rows
+    const int num_strips = std::max(1, std::min(m_params.num_strips, size.height / (2 * overlap)));
+
+    m_strips.assign(num_strips, Strip());
+    for (int i = 0; i < num_strips; ++i) {
+        Strip& strip = m_strips[i];
+        strip.begin = size.height * i / num_strips;
+        strip.end = size.height * (i + 1) / num_strips;
+        strip.matched_begin = std::max(0, strip.begin - overlap);
+        strip.matched_end = std::min(size.height, strip.end + overlap);
+        strip.matcher = create_matcher(num_disparities);
+    }
+    m_configured_size = size;
+
+    VIO_LOG_DEBUG("Disparity estimator: " << size.width << "x" << size.height << ", " << num_strips
+                  << " strips, " << num_disparities << " disparities");
+}
+
+template<typename Fn>
+void DisparityEstimator::run_strips(const Fn& fn) {
+    if (m_thread_pool) {
+        m_thread_pool->parallel_for(m_strips.size(), fn);
+    } else {
+        for (size_t i = 0; i < m_strips.size(); ++i) {
+            fn(i);
+        }
+    }
+}
+
+void DisparityEstimator::match(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) {
+    configure(left.size());
+    disparity.create(left.size(), CV_32F);
+
+    const int min_fixed = (m_params.half_resolution ? m_params.min_disparity / 2 : m_params.min_disparity) * 16;
+    run_strips([&](size_t i) {
+        Strip& strip = m_strips[i];
+        strip.matcher->compute(left.rowRange(strip.matched_begin, strip.matched_end),
+                               right.rowRange(strip.matched_begin, strip.matched_end), strip.fixed);
+
+        // Keep the strip's own rows; fixed point -> pixels, invalid -> -1
+        for (int y = strip.begin; y < strip.end; ++y) {
+            const short* src = strip.fixed.ptr<short>(y - strip.matched_begin);
+            float* dst = disparity.ptr<float>(y);
+            for (int x = 0; x < disparity.cols; ++x) {
+                dst[x] = src[x] < min_fixed ? -1.0f : src[x] * (1.0f / 16.0f);
+            }
+        }
+    });
+}
+
+bool DisparityEstimator::compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity) {
+    VIO_PROFILE_SCOPE("dense_disparity");
+
+    if (left.empty() || left.size() != right.size() || left.type() != CV_8UC1 || right.type() != CV_8UC1) {
+        VIO_LOG_ERROR("Dense disparity needs two 8-bit grayscale images of the same size");
+        return false;
+    }
+
+    if (!m_params.half_resolution) {
+        match(left, right, disparity);
+        return true;
+    }
+
+    // Match at half size, then nearest-neighbour upsample (no blending across
+    // depth edges or into holes) and scale disparities back to full-size pixels
+    cv::resize(left, m_half_left, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    cv::resize(right, m_half_right, cv::Size(), 0.5, 0.5, cv::INTER_AREA);
+    match(m_half_left, m_half_right, m_half_disparity);
+
+    disparity.create(left.size(), CV_32F);
+    for (int y = 0; y < disparity.rows; ++y) {
+        const float* src = m_half_disparity.ptr<float>(std::min(y / 2, m_half_disparity.rows - 1));
+        float* dst = disparity.ptr<float>(y);
+        for (int x = 0; x < disparity.cols; ++x) {
+            const float d = src[std::min(x / 2, m_half_disparity.cols - 1)];
+            dst[x] = d < 0.0f ? -1.0f : 2.0f * d;
+        }
+    }
+    return true;
+}
+
+void DisparityEstimator::disparity_to_depth(const cv::Mat& disparity, double focal_length, double baseline,
+                                            cv::Mat& depth) {
+    depth.create(disparity.size(), CV_32F);
+    const float scale = static_cast<float>(focal_length * baseline);
+    for (int y = 0; y < disparity.rows; ++y) {
+        const float* src = disparity.ptr<float>(y);
+        float* dst = depth.ptr<float>(y);
+        for (int x = 0; x < disparity.cols; ++x) {
+            dst[x] = src[x] > 0.0f ? scale / src[x] : 0.0f;
+        }
+    }
+}
+
+float DisparityEstimator::sample(const cv::Mat& disparity, const cv::Point2f& point) {
+    const int x = static_cast<int>(std::lround(point.x));
+    const int y = static_cast<int>(std::lround(point.y));
+    if (x < 0 || y < 0 || x >= disparity.cols || y >= disparity.rows) {
+        return -1.0f;
+    }
+    return disparity.at<float>(y, x);
+}
+
+} // namespace lightweight_vio
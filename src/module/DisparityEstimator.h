@@ -0,0 +1,79 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "../util/ThreadPool.h"
+
+namespace lightweight_vio {
+
+enum class DisparityMode {
+    BlockMatching,  // cv::StereoBM: fastest, holes in weak texture
+    SemiGlobal      // cv::StereoSGBM: smoother and denser, several times slower
+};
+
+struct DisparityParams {
+    DisparityMode mode = DisparityMode::SemiGlobal;
+    int min_disparity = 0;
+    int num_disparities = 64;      // Rounded up to a multiple of 16
+    int block_size = 7;            // Odd; BM needs at least 5
+    int uniqueness_ratio = 10;     // Percent margin of the best cost over the second best
+    int num_strips = 4;            // Horizontal bands matched independently (in parallel with a pool)
+    bool half_resolution = false;  // Match 2x downsampled images, upsample the result
+};
+
+// Dense disparity on rectified 8-bit pairs. Matchers and their buffers are
+// created once per image size and reused from frame to frame. The image is cut
+// into horizontal strips, each with its own matcher and enough overlap that
+// the rows it keeps see the same support as a full-image run (exact for BM;
+// for SGM the vertical and diagonal paths are truncated at the overlap, which
+// only matters in textureless areas). With a thread pool the strips run in
+// parallel; without one they run in turn on the calling thread.
+//
+// Output is metric disparity in pixels of the input resolution (CV_32F, -1
+// where no match was found), not a normalized visualization.
+class DisparityEstimator {
+public:
+    explicit DisparityEstimator(const DisparityParams& params = DisparityParams());
+
+    void set_params(const DisparityParams& params);
+    const DisparityParams& get_params() const { return m_params; }
+    // Optional; not owned
+    void set_thread_pool(ThreadPool* thread_pool) { m_thread_pool = thread_pool; }
+
+    // left/right must be the same size; returns false otherwise
+    bool compute(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity);
+
+    // Depth (m, CV_32F) = focal * baseline / disparity; 0 where disparity <= 0
+    static void disparity_to_depth(const cv::Mat& disparity, double focal_length, double baseline, cv::Mat& depth);
+    // Disparity at the nearest pixel; -1 outside the image or where invalid
+    static float sample(const cv::Mat& disparity, const cv::Point2f& point);
+
+private:
+    struct Strip {
+        int begin = 0;          // First row kept
+        int end = 0;            // One past the last row kept
+        int matched_begin = 0;  // Rows matched: [begin, end) plus the overlap
+        int matched_end = 0;
+        cv::Ptr<cv::StereoMatcher> matcher;
+        cv::Mat fixed;          // CV_16S, 4 fractional bits
+    };
+
+    void configure(const cv::Size& size);
+    cv::Ptr<cv::StereoMatcher> create_matcher(int num_disparities) const;
+    void match(const cv::Mat& left, const cv::Mat& right, cv::Mat& disparity);
+    template<typename Fn>
+    void run_strips(const Fn& fn);
+
+    DisparityParams m_params;
+    ThreadPool* m_thread_pool;
+
+    cv::Size m_configured_size;  // Size the strips were built for (the matched resolution)
+    std::vector<Strip> m_strips;
+
+    // Half-resolution buffers
+    cv::Mat m_half_left;
+    cv::Mat m_half_right;
+    cv::Mat m_half_disparity;
+};
+
+} // namespace lightweight_vio
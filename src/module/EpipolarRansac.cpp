@@ -0,0 +1,401 @@
+#include "EpipolarRansac.h"
+#include "../util/EpipolarKernel.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace lightweight_vio {
+
+namespace {
+
+// Polynomials in (x, y, z) up to degree 3. The ten cubic monomials come first
+// and the action-matrix basis {x^2, xy, xz, y^2, yz, z^2, x, y, z, 1} last.
+constexpr int MONOMIALS = 20;
+constexpr int EXPONENTS[MONOMIALS][3] = {
+    {3, 0, 0}, {2, 1, 0}, {2, 0, 1}, {1, 2, 0}, {1, 1, 1}, {1, 0, 2}, {0, 3, 0}, {0, 2, 1}, {0, 1, 2}, {0, 0, 3},
+    {2, 0, 0}, {1, 1, 0}, {1, 0, 1}, {0, 2, 0}, {0, 1, 1}, {0, 0, 2}, {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, {0, 0, 0}};
+
+using Poly = std::array<double, MONOMIALS>;
+
+// product_index[i][j]: monomial i * monomial j, or -1 above degree 3
+struct ProductTable {
+    int index[MONOMIALS][MONOMIALS];
+    ProductTable() {
+        for (int i = 0; i < MONOMIALS; ++i) {
+            for (int j = 0; j < MONOMIALS; ++j) {
+                index[i][j] = -1;
+                for (int k = 0; k < MONOMIALS; ++k) {
+                    if (EXPONENTS[k][0] == EXPONENTS[i][0] + EXPONENTS[j][0] &&
+                        EXPONENTS[k][1] == EXPONENTS[i][1] + EXPONENTS[j][1] &&
+                        EXPONENTS[k][2] == EXPONENTS[i][2] + EXPONENTS[j][2]) {
+                        index[i][j] = k;
+                    }
+                }
+            }
+        }
+    }
+};
+
+const ProductTable& product_table() {
+    static const ProductTable table;
+    return table;
+}
+
+// p (degree <= 2, monomials 10..19) times a linear polynomial (monomials 16..19)
+Poly multiply(const Poly& p, const Poly& linear) {
+    const ProductTable& table = product_table();
+    Poly r{};
+    for (int i = 10; i < MONOMIALS; ++i) {
+        if (p[i] == 0.0) continue;
+        for (int j = 16; j < MONOMIALS; ++j) {
+            r[table.index[i][j]] += p[i] * linear[j];
+        }
+    }
+    return r;
+}
+
+void add_scaled(Poly& r, const Poly& p, double scale) {
+    for (int i = 0; i < MONOMIALS; ++i) r[i] += scale * p[i];
+}
+
+// Essential matrices through 5 correspondences (Stewenius' action-matrix
+// formulation of Nister's solver): E = xX + yY + zZ + W over the null space of
+// the epipolar constraints, with det(E) = 0 and 2 E E^T E - tr(E E^T) E = 0
+// giving ten cubics; their common roots are eigenvectors of the action matrix
+// for multiplication by x.
+int solve_essential_5pt(const Eigen::Vector2d* x1, const Eigen::Vector2d* x2, std::vector<Eigen::Matrix3d>& solutions) {
+    Eigen::Matrix<double, 9, 5> constraints_t;
+    for (int i = 0; i < 5; ++i) {
+        const double u1 = x1[i].x(), v1 = x1[i].y(), u2 = x2[i].x(), v2 = x2[i].y();
+        constraints_t.col(i) << u2 * u1, u2 * v1, u2, v2 * u1, v2 * v1, v2, u1, v1, 1.0;
+    }
+    // Null space: the last 4 columns of Q in the QR of the 9x5 constraint transpose
+    Eigen::Matrix<double, 9, 9> q = Eigen::HouseholderQR<Eigen::Matrix<double, 9, 5>>(constraints_t).householderQ();
+
+    // E entries as linear polynomials in x, y, z (monomials 16, 17, 18, 19)
+    Poly e[3][3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            const int k = 3 * r + c;
+            e[r][c] = Poly{};
+            e[r][c][16] = q(k, 5);
+            e[r][c][17] = q(k, 6);
+            e[r][c][18] = q(k, 7);
+            e[r][c][19] = q(k, 8);
+        }
+    }
+
+    Eigen::Matrix<double, 10, MONOMIALS> M;
+
+    // det(E) = 0
+    auto minor2 = [&](int r0, int c0, int r1, int c1) {
+        Poly t = multiply(e[r0][c0], e[r1][c1]);
+        add_scaled(t, multiply(e[r0][c1], e[r1][c0]), -1.0);
+        return t;
+    };
+    Poly det = multiply(minor2(1, 1, 2, 2), e[0][0]);
+    add_scaled(det, multiply(minor2(1, 0, 2, 2), e[0][1]), -1.0);
+    add_scaled(det, multiply(minor2(1, 0, 2, 1), e[0][2]), 1.0);
+    for (int k = 0; k < MONOMIALS; ++k) M(0, k) = det[k];
+
+    // 2 E E^T E - tr(E E^T) E = 0
+    Poly eet[3][3];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            eet[r][c] = Poly{};
+            for (int k = 0; k < 3; ++k) add_scaled(eet[r][c], multiply(e[r][k], e[c][k]), 1.0);
+        }
+    }
+    Poly trace = eet[0][0];
+    add_scaled(trace, eet[1][1], 1.0);
+    add_scaled(trace, eet[2][2], 1.0);
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            Poly row{};
+            for (int k = 0; k < 3; ++k) add_scaled(row, multiply(eet[r][k], e[k][c]), 2.0);
+            add_scaled(row, multiply(trace, e[r][c]), -1.0);
+            for (int k = 0; k < MONOMIALS; ++k) M(1 + 3 * r + c, k) = row[k];
+        }
+    }
+
+    // Eliminate the cubic monomials: cubic_i = -G.row(i) * basis
+    Eigen::FullPivLU<Eigen::Matrix<double, 10, 10>> lu(M.leftCols<10>());
+    if (!lu.isInvertible()) return 0;
+    Eigen::Matrix<double, 10, 10> G = lu.solve(M.rightCols<10>());
+
+    // Action matrix: row j expresses x * basis_j in the basis
+    Eigen::Matrix<double, 10, 10> action = Eigen::Matrix<double, 10, 10>::Zero();
+    for (int j = 0; j < 6; ++j) action.row(j) = -G.row(j);  // x*{x^2, xy, xz, y^2, yz, z^2} are cubic
+    action(6, 0) = 1.0;  // x * x = x^2
+    action(7, 1) = 1.0;  // x * y = xy
+    action(8, 2) = 1.0;  // x * z = xz
+    action(9, 6) = 1.0;  // x * 1 = x
+
+    Eigen::EigenSolver<Eigen::Matrix<double, 10, 10>> eigen(action);
+    if (eigen.info() != Eigen::Success) return 0;
+
+    const Eigen::Matrix3d X = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(q.col(5).data());
+    const Eigen::Matrix3d Y = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(q.col(6).data());
+    const Eigen::Matrix3d Z = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(q.col(7).data());
+    const Eigen::Matrix3d W = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(q.col(8).data());
+
+    int found = 0;
+    for (int i = 0; i < 10; ++i) {
+        if (std::abs(eigen.eigenvalues()[i].imag()) > 1e-10) continue;
+        Eigen::Matrix<double, 10, 1> v = eigen.eigenvectors().col(i).real();
+        if (std::abs(v(9)) < 1e-12) continue;
+        const double x = v(6) / v(9), y = v(7) / v(9), z = v(8) / v(9);
+        Eigen::Matrix3d E = x * X + y * Y + z * Z + W;
+        solutions.push_back(E / E.norm());
+        found++;
+    }
+    return found;
+}
+
+// Least-squares (Hartley-normalized) 8-point fit over the given indices
+bool solve_fundamental_8pt(const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2,
+                           const int* indices, int count, bool essential, Eigen::Matrix3d& model) {
+    if (count < 8) return false;
+
+    // Translate to the centroid and scale to mean distance sqrt(2)
+    auto normalization = [&](const std::vector<cv::Point2f>& pts) {
+        Eigen::Vector2d centroid = Eigen::Vector2d::Zero();
+        for (int i = 0; i < count; ++i) centroid += Eigen::Vector2d(pts[indices[i]].x, pts[indices[i]].y);
+        centroid /= count;
+        double mean_distance = 0.0;
+        for (int i = 0; i < count; ++i) {
+            mean_distance += (Eigen::Vector2d(pts[indices[i]].x, pts[indices[i]].y) - centroid).norm();
+        }
+        mean_distance /= count;
+        const double s = mean_distance > 0.0 ? std::sqrt(2.0) / mean_distance : 1.0;
+        Eigen::Matrix3d T;
+        T << s, 0, -s * centroid.x(), 0, s, -s * centroid.y(), 0, 0, 1;
+        return T;
+    };
+    const Eigen::Matrix3d T1 = normalization(pts1);
+    const Eigen::Matrix3d T2 = normalization(pts2);
+
+    Eigen::Matrix<double, 9, 9> AtA = Eigen::Matrix<double, 9, 9>::Zero();
+    for (int i = 0; i < count; ++i) {
+        const cv::Point2f& p1 = pts1[indices[i]];
+        const cv::Point2f& p2 = pts2[indices[i]];
+        const double u1 = T1(0, 0) * p1.x + T1(0, 2), v1 = T1(1, 1) * p1.y + T1(1, 2);
+        const double u2 = T2(0, 0) * p2.x + T2(0, 2), v2 = T2(1, 1) * p2.y + T2(1, 2);
+        Eigen::Matrix<double, 9, 1> a;
+        a << u2 * u1, u2 * v1, u2, v2 * u1, v2 * v1, v2, u1, v1, 1.0;
+        AtA.noalias() += a * a.transpose();
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix<double, 9, 9>> eigen(AtA);
+    Eigen::Matrix<double, 9, 1> f = eigen.eigenvectors().col(0);
+    Eigen::Matrix3d F = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(f.data());
+
+    // Rank 2 in the normalized frame, then undo the normalization
+    Eigen::JacobiSVD<Eigen::Matrix3d> svd(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+    Eigen::Vector3d s = svd.singularValues();
+    F = svd.matrixU() * Eigen::Vector3d(s(0), s(1), 0.0).asDiagonal() * svd.matrixV().transpose();
+    F = T2.transpose() * F * T1;
+
+    if (essential) {
+        // Nearest essential matrix: equal non-zero singular values
+        Eigen::JacobiSVD<Eigen::Matrix3d> esvd(F, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        double sigma = 0.5 * (esvd.singularValues()(0) + esvd.singularValues()(1));
+        F = esvd.matrixU() * Eigen::Vector3d(sigma, sigma, 0.0).asDiagonal() * esvd.matrixV().transpose();
+    }
+    if (!F.allFinite() || F.norm() <= 0.0) return false;
+    model = F / F.norm();
+    return true;
+}
+
+} // namespace
+
+EpipolarRansac::EpipolarRansac()
+    : m_threshold(1.0)
+    , m_confidence(0.99)
+    , m_max_iterations(1000)
+    , m_has_previous(false)
+    , m_previous_type(Model::Essential)
+    , m_previous_model(Eigen::Matrix3d::Zero())
+    , m_rng(20240517u)
+{
+    m_sample.reserve(8);
+    m_candidates.reserve(10);  // Most real roots of the 5-point solver
+}
+
+void EpipolarRansac::reserve(size_t max_points) {
+    m_order.reserve(max_points);
+    m_inliers.reserve(max_points);
+    m_errors.reserve(max_points);
+}
+
+int EpipolarRansac::score(const Eigen::Matrix3d& model, const std::vector<cv::Point2f>& pts1,
+                          const std::vector<cv::Point2f>& pts2, std::vector<uchar>* inlier_mask) {
+    float F[9];
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) F[3 * r + c] = static_cast<float>(model(r, c));
+    }
+    const size_t count = pts1.size();
+    m_errors.resize(count);
+    compute_epipolar_errors(F, reinterpret_cast<const float*>(pts1.data()), reinterpret_cast<const float*>(pts2.data()),
+                            count, nullptr, m_errors.data());
+
+    const float threshold_sq = static_cast<float>(m_threshold * m_threshold);
+    int inliers = 0;
+    if (inlier_mask) {
+        inlier_mask->resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            uchar inlier = m_errors[i] <= threshold_sq;
+            (*inlier_mask)[i] = inlier;
+            inliers += inlier;
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) inliers += m_errors[i] <= threshold_sq;
+    }
+    return inliers;
+}
+
+int EpipolarRansac::adaptive_iterations(int inliers, int count, int sample_size) const {
+    const double ratio = static_cast<double>(inliers) / std::max(count, 1);
+    const double all_inlier_sample = std::pow(ratio, sample_size);
+    if (all_inlier_sample >= 1.0) return 0;
+    if (all_inlier_sample <= 0.0) return m_max_iterations;
+    const double iterations = std::log(1.0 - m_confidence) / std::log(1.0 - all_inlier_sample);
+    return static_cast<int>(std::min<double>(std::ceil(iterations), m_max_iterations));
+}
+
+void EpipolarRansac::draw_sample(int sample_size, int n_top, bool include_last) {
+    // Distinct positions in the priority order; PROSAC forces the newest point in
+    m_sample.clear();
+    if (include_last) m_sample.push_back(n_top - 1);
+    const int pool = include_last ? n_top - 1 : n_top;
+    std::uniform_int_distribution<int> pick(0, pool - 1);
+    while (static_cast<int>(m_sample.size()) < sample_size) {
+        int candidate = pick(m_rng);
+        if (std::find(m_sample.begin(), m_sample.end(), candidate) == m_sample.end()) {
+            m_sample.push_back(candidate);
+        }
+    }
+    for (int& position : m_sample) position = m_order[position];
+}
+
+EpipolarRansac::Result EpipolarRansac::estimate(Model model, const std::vector<cv::Point2f>& pts1,
+                                                const std::vector<cv::Point2f>& pts2,
+                                                const std::vector<int>* priorities,
+                                                std::vector<uchar>& inlier_mask) {
+    VIO_PROFILE_SCOPE("epipolar_ransac");
+
+    Result result;
+    const int count = static_cast<int>(pts1.size());
+    const int sample_size = model == Model::Essential ? 5 : 8;
+    inlier_mask.assign(count, 1);
+    if (count < sample_size || pts2.size() != pts1.size()) {
+        return result;
+    }
+
+    // PROSAC order: highest priority first, index as tie-break (an explicit
+    // one: std::stable_sort would allocate a merge buffer on every call)
+    m_order.resize(count);
+    std::iota(m_order.begin(), m_order.end(), 0);
+    if (priorities && static_cast<int>(priorities->size()) == count) {
+        std::sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+            const int pa = (*priorities)[a], pb = (*priorities)[b];
+            return pa != pb ? pa > pb : a < b;
+        });
+    }
+
+    Eigen::Matrix3d best_model = Eigen::Matrix3d::Zero();
+    int best_inliers = 0;
+    bool best_from_previous = false;
+    if (m_has_previous && m_previous_type == model) {
+        best_inliers = score(m_previous_model, pts1, pts2, nullptr);
+        best_model = m_previous_model;
+        best_from_previous = true;
+    }
+    int max_iterations = best_inliers > 0 ? adaptive_iterations(best_inliers, count, sample_size) : m_max_iterations;
+
+    // PROSAC growth schedule (Chum & Matas 2005): the sampling pool grows from
+    // the top sample_size points to all of them over T_N draws
+    const double T_N = m_max_iterations;
+    double T_n = T_N;
+    for (int i = 0; i < sample_size; ++i) {
+        T_n *= static_cast<double>(sample_size - i) / (count - i);
+    }
+    int n_top = sample_size;
+    double T_n_prime = 1.0;
+
+    std::array<Eigen::Vector2d, 5> x1, x2;  // Essential samples
+    int iteration = 0;
+    for (; iteration < max_iterations; ++iteration) {
+        if (iteration + 1 > T_n_prime && n_top < count) {
+            double T_next = T_n * (n_top + 1) / (n_top + 1 - sample_size);
+            T_n_prime += std::ceil(T_next - T_n);
+            T_n = T_next;
+            n_top++;
+        }
+        draw_sample(sample_size, n_top, T_n_prime >= iteration + 1 && n_top > sample_size);
+
+        m_candidates.clear();
+        if (model == Model::Essential) {
+            for (int k = 0; k < sample_size; ++k) {
+                x1[k] = Eigen::Vector2d(pts1[m_sample[k]].x, pts1[m_sample[k]].y);
+                x2[k] = Eigen::Vector2d(pts2[m_sample[k]].x, pts2[m_sample[k]].y);
+            }
+            solve_essential_5pt(x1.data(), x2.data(), m_candidates);
+        } else {
+            Eigen::Matrix3d F;
+            if (solve_fundamental_8pt(pts1, pts2, m_sample.data(), sample_size, false, F)) {
+                m_candidates.push_back(F);
+            }
+        }
+
+        for (const Eigen::Matrix3d& candidate : m_candidates) {
+            int inliers = score(candidate, pts1, pts2, nullptr);
+            if (inliers > best_inliers) {
+                best_inliers = inliers;
+                best_model = candidate;
+                best_from_previous = false;
+                max_iterations = std::min(max_iterations, adaptive_iterations(inliers, count, sample_size));
+            }
+        }
+    }
+
+    if (best_inliers < sample_size) {
+        VIO_LOG_DEBUG("Epipolar RANSAC failed: " << best_inliers << "/" << count << " inliers");
+        m_has_previous = false;
+        result.iterations = iteration;
+        return result;
+    }
+
+    // Least-squares refit on the inliers, kept unless it explains fewer points
+    score(best_model, pts1, pts2, &inlier_mask);
+    m_inliers.clear();
+    for (int i = 0; i < count; ++i) {
+        if (inlier_mask[i]) m_inliers.push_back(i);
+    }
+    Eigen::Matrix3d refined;
+    if (solve_fundamental_8pt(pts1, pts2, m_inliers.data(), static_cast<int>(m_inliers.size()),
+                              model == Model::Essential, refined)) {
+        int refined_inliers = score(refined, pts1, pts2, nullptr);
+        if (refined_inliers >= best_inliers) {
+            best_model = refined;
+            best_inliers = score(best_model, pts1, pts2, &inlier_mask);
+        }
+    }
+
+    m_has_previous = true;
+    m_previous_type = model;
+    m_previous_model = best_model;
+
+    result.success = true;
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) result.model(r, c) = static_cast<float>(best_model(r, c));
+    }
+    result.inlier_count = best_inliers;
+    result.iterations = iteration;
+    result.from_previous = best_from_previous;
+    return result;
+}
+
+} // namespace lightweight_vio
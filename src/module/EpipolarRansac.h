@@ -0,0 +1,74 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include <random>
+#include <vector>
+
+namespace lightweight_vio {
+
+// RANSAC for two-view epipolar geometry between matched point sets.
+//   Essential   : 5-point minimal solver on normalized camera coordinates
+//   Fundamental : normalized 8-point solver on pixel coordinates (uncalibrated)
+// Samples are drawn PROSAC-style, growing from the highest-priority points
+// (e.g. longest tracks). The previous call's model is scored first as a free
+// hypothesis, the iteration bound shrinks with the best inlier ratio seen,
+// and the winner is re-fitted on all of its inliers.
+class EpipolarRansac {
+public:
+    enum class Model { Essential, Fundamental };
+
+    struct Result {
+        bool success = false;
+        cv::Matx33f model;            // x2^T M x1 = 0
+        int inlier_count = 0;
+        int iterations = 0;           // Minimal samples drawn
+        bool from_previous = false;   // The previous model was never beaten by a sample
+    };
+
+    EpipolarRansac();
+
+    // Sampson distance threshold, in the units of the coordinates
+    // (pixels for Fundamental, pixels / focal length for Essential)
+    void set_threshold(double threshold) { m_threshold = threshold; }
+    void set_confidence(double confidence) { m_confidence = confidence; }
+    void set_max_iterations(int max_iterations) { m_max_iterations = max_iterations; }
+
+    // pts1[i] <-> pts2[i]. priorities (optional, higher first) orders the
+    // PROSAC sampling. inlier_mask is resized to the point count.
+    Result estimate(Model model, const std::vector<cv::Point2f>& pts1, const std::vector<cv::Point2f>& pts2,
+                    const std::vector<int>* priorities, std::vector<uchar>& inlier_mask);
+
+    // Size the reused buffers for up to max_points correspondences, so that
+    // later calls do not allocate
+    void reserve(size_t max_points);
+
+    // Forget the previous model (e.g. after the track was lost)
+    void reset() { m_has_previous = false; }
+
+private:
+    int score(const Eigen::Matrix3d& model, const std::vector<cv::Point2f>& pts1,
+              const std::vector<cv::Point2f>& pts2, std::vector<uchar>* inlier_mask);
+    void draw_sample(int sample_size, int n_top, bool include_last);
+    int adaptive_iterations(int inliers, int count, int sample_size) const;
+
+    double m_threshold;
+    double m_confidence;
+    int m_max_iterations;
+
+    // Previous winner (first hypothesis of the next call)
+    bool m_has_previous;
+    Model m_previous_type;
+    Eigen::Matrix3d m_previous_model;
+
+    std::mt19937 m_rng;
+
+    // Reused buffers
+    std::vector<int> m_order;
+    std::vector<int> m_sample;
+    std::vector<int> m_inliers;
+    std::vector<float> m_errors;
+    std::vector<Eigen::Matrix3d> m_candidates;
+};
+
+} // namespace lightweight_vio
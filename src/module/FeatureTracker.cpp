@@ -1,7 +1,13 @@
 #include "FeatureTracker.h"
+#include "../util/ExternalAllocationScope.h"
+#include "../util/Logger.h"
+#include "../util/ParallaxKernel.h"
+#include "../util/Profiler.h"
+#include "../util/SparseLK.h"
 #include <algorithm>
-#include <iostream>
-#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <limits>
 
 namespace lightweight_vio {
 
@@ -13,19 +19,61 @@ FeatureTracker::FeatureTracker()
     , m_win_size(cv::Size(21, 21))
     , m_max_level(3)
     , m_criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01)
+    , m_use_fb_check(false)
+    , m_fb_threshold(0.5f)
+    , m_lk_batch_size(64)
+    , m_use_sparse_lk(false)
+    , m_use_opencv_ransac(false)
+    , m_matched_frame_id(-1)
+    , m_use_motion_prediction(true)
+    , m_prediction_confidence_px(1.0f)
+    , m_predicted_max_level(1)
+    , m_predicted_iterations(10)
+    , m_prediction_confident(false)
+    , m_use_keyframe_selection(true)
+    , m_keyframe_timestamp(0)
+    , m_keyframe_count(0)
+    , m_last_parallax(0.0f)
     , m_global_feature_id(0)
+    , m_use_grid_detection(true)
+    , m_mask_frame_id(-1)
+    , m_buffer_pool(std::make_shared<FrameBufferPool>())
 {
+    m_detector.set_quality_level(m_quality_level);
+    m_detector.set_min_distance(m_min_distance);
+}
+
+void FeatureTracker::set_num_threads(size_t num_threads) {
+    m_thread_pool = num_threads > 0 ? std::make_unique<ThreadPool>(num_threads) : nullptr;
+    m_detector.set_thread_pool(m_thread_pool.get());
 }
 
 void FeatureTracker::track_features(std::shared_ptr<Frame> current_frame, 
                                    std::shared_ptr<Frame> previous_frame) {
-    auto total_start = std::chrono::high_resolution_clock::now();
-    
+    VIO_PROFILE_SCOPE("track_features");
+
     if (!current_frame) {
-        std::cerr << "Current frame is null" << std::endl;
+        VIO_LOG_ERROR("Current frame is null");
         return;
     }
 
+    // Size the frame's columns and every per-feature buffer once: tracking and
+    // extraction together never exceed max(m_max_features, survivors of the
+    // previous frame). A recycled store already has the capacity.
+    size_t capacity = static_cast<size_t>(std::max(m_max_features, 0));
+    if (previous_frame) {
+        capacity = std::max(capacity, previous_frame->get_feature_count());
+    }
+    if (m_buffer_pool) {
+        current_frame->set_buffer_pool(m_buffer_pool);
+    }
+    current_frame->get_feature_store().reserve(capacity);
+    m_scratch.clear();
+    m_scratch.reserve(capacity);
+    m_ransac.reserve(capacity);
+    m_keyframe_ids.reserve(capacity);
+    m_keyframe_points.reserve(capacity);
+
     if (previous_frame) {
         // Track existing features
         optical_flow_tracking(current_frame, previous_frame);
@@ -37,175 +85,571 @@ void FeatureTracker::track_features(std::shared_ptr<Frame> current_frame,
         update_feature_track_count(current_frame);
     }
 
+    // Decided on the tracked features alone; new ones cannot be in the keyframe
+    const bool keyframe = !previous_frame || select_keyframe(*current_frame);
+
     // Extract new features if needed
     if (current_frame->get_feature_count() < m_max_features) {
         set_mask(current_frame);
         extract_new_features(current_frame);
     }
 
-    auto total_end = std::chrono::high_resolution_clock::now();
-    auto total_duration = std::chrono::duration_cast<std::chrono::microseconds>(total_end - total_start);
-    
-    std::cout << "[TIMING] Total feature tracking: " << total_duration.count() / 1000.0 << " ms | "
-              << "Frame " << current_frame->get_frame_id() 
-              << " has " << current_frame->get_feature_count() << " features" << std::endl;
+    current_frame->set_keyframe(keyframe);
+    if (keyframe) {
+        record_keyframe(*current_frame);
+    }
+
+    VIO_LOG_DEBUG("Frame " << current_frame->get_frame_id()
+                  << " has " << current_frame->get_feature_count() << " features");
 }
 
 void FeatureTracker::extract_new_features(std::shared_ptr<Frame> frame) {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+    VIO_PROFILE_SCOPE("extract_new_features");
+
     if (frame->get_image().empty()) {
-        std::cerr << "Cannot extract features: image is empty" << std::endl;
+        VIO_LOG_ERROR("Cannot extract features: image is empty");
         return;
     }
 
-    std::vector<cv::Point2f> corners;
-    cv::Mat mask = cv::Mat::ones(frame->get_image().size(), CV_8UC1);
-    
-    // Set mask to avoid existing features
-    for (const auto& feature : frame->get_features()) {
-        if (feature->is_valid()) {
-            cv::circle(mask, feature->get_pixel_coord(), m_min_distance, 0, -1);
-        }
+    if (m_mask_frame_id != frame->get_frame_id()) {
+        set_mask(frame);
     }
 
-    cv::goodFeaturesToTrack(frame->get_image(), corners, 
-                           m_max_features - frame->get_feature_count(),
-                           m_quality_level, m_min_distance, mask);
+    // Detection buffers are reused across frames
+    std::vector<cv::Point2f>& corners = m_scratch.corners;
+    corners.clear();
+    int max_new = m_max_features - static_cast<int>(frame->get_feature_count());
 
+    if (m_use_grid_detection) {
+        m_detector.detect(frame->get_image(), m_max_features, max_new, corners);
+    } else {
+        ExternalAllocationScope external;
+        cv::goodFeaturesToTrack(frame->get_image(), corners, max_new,
+                               m_quality_level, m_min_distance, m_scratch.mask);
+    }
+
+    FeatureStore& store = frame->get_feature_store();
+    const size_t first_new = store.size();
+    store.reserve(first_new + corners.size());  // No-op when called from track_features
     for (const auto& corner : corners) {
-        auto feature = std::make_shared<Feature>(m_global_feature_id++, corner);
-        frame->add_feature(feature);
+        frame->add_feature(m_global_feature_id++, corner);
     }
+    undistort_features(store, first_new);
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    
-    std::cout << "[TIMING] New feature extraction: " << duration.count() / 1000.0 << " ms | "
-              << "Extracted " << corners.size() << " new features" << std::endl;
+    VIO_PROFILE_COUNTER(FeaturesExtracted, corners.size());
+    VIO_LOG_DEBUG("Extracted " << corners.size() << " new features");
 }
 
 void FeatureTracker::optical_flow_tracking(std::shared_ptr<Frame> current_frame,
                                           std::shared_ptr<Frame> previous_frame) {
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
+    VIO_PROFILE_SCOPE("optical_flow_tracking");
+
     if (previous_frame->get_feature_count() == 0) {
         return;
     }
 
-    // Extract points from previous frame features
-    std::vector<cv::Point2f> prev_pts = extract_points_from_features(previous_frame->get_features());
-    std::vector<cv::Point2f> cur_pts;
-    std::vector<uchar> status;
-    std::vector<float> err;
+    // The previous frame's pixel column is fed to LK as-is; invalid slots are
+    // tracked too but dropped below
+    const FeatureStore& prev_store = previous_frame->get_feature_store();
+    const std::vector<cv::Point2f>& prev_pts = prev_store.get_pixel_coords();
+    const size_t count = prev_pts.size();
+    std::vector<cv::Point2f>& cur_pts = m_scratch.tracked_points;
+    std::vector<uchar>& status = m_scratch.status;
+    std::vector<float>& err = m_scratch.err;
+    cur_pts.resize(count);
+    status.resize(count);
+    err.resize(count);
+
+    // Pyramids are cached on the frames (the previous frame's was built when it
+    // was the current frame)
+    const std::vector<cv::Mat>& prev_pyramid = previous_frame->get_left_pyramid();
+    const std::vector<cv::Mat>& cur_pyramid = current_frame->get_left_pyramid();
+
+    // Seed LK with constant-velocity predictions. After a frame whose
+    // predictions were accurate, a shallower pyramid and fewer iterations suffice.
+    const double dt = (current_frame->get_timestamp() - previous_frame->get_timestamp()) * 1e-9;
+    const bool predict = m_use_motion_prediction && dt > 0.0;
+    const bool reduced = predict && m_prediction_confident;
+    LKParams params{m_max_level, m_criteria, false};
+    if (predict) {
+        predict_positions(prev_store, dt, m_scratch.predicted_points);
+        std::copy(m_scratch.predicted_points.begin(), m_scratch.predicted_points.end(), cur_pts.begin());
+        params.use_initial_flow = true;
+        if (reduced) {
+            params.max_level = std::min(m_max_level, m_predicted_max_level);
+            params.criteria = cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS,
+                                               m_predicted_iterations, m_criteria.epsilon);
+        }
+    }
+
+    // Forward (and optional backward) LK in parallel batches
+    int fb_rejected = track_points_batched(prev_pyramid, cur_pyramid, prev_pts, cur_pts, status, err, params);
+
+    const std::vector<uchar>& prev_valid = prev_store.get_valid_flags();
+    size_t lost_first_pass = 0;
+    size_t valid_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!prev_valid[i]) continue;
+        valid_count++;
+        if (!status[i]) lost_first_pass++;
+    }
+
+    // The reduced search must not shorten tracks: retry what it lost with the
+    // full pyramid and no prior
+    if (reduced && lost_first_pass > 0) {
+        VIO_PROFILE_SCOPE("lk_retry");
+        std::vector<size_t>& retry_indices = m_scratch.indices;
+        std::vector<cv::Point2f>& retry_prev = m_scratch.points_a;
+        std::vector<cv::Point2f>& retry_cur = m_scratch.points_b;
+        retry_indices.clear();
+        retry_prev.clear();
+        for (size_t i = 0; i < count; ++i) {
+            if (prev_valid[i] && !status[i]) {
+                retry_indices.push_back(i);
+                retry_prev.push_back(prev_pts[i]);
+            }
+        }
+        retry_cur.resize(retry_prev.size());
+        m_scratch.retry_status.resize(retry_prev.size());
+        m_scratch.retry_err.resize(retry_prev.size());
+
+        LKParams full_params{m_max_level, m_criteria, false};
+        fb_rejected += track_points_batched(prev_pyramid, cur_pyramid, retry_prev, retry_cur,
+                                            m_scratch.retry_status, m_scratch.retry_err, full_params);
+        for (size_t k = 0; k < retry_indices.size(); ++k) {
+            if (m_scratch.retry_status[k]) {
+                size_t i = retry_indices[k];
+                cur_pts[i] = retry_cur[k];
+                status[i] = 1;
+                err[i] = m_scratch.retry_err[k];
+            }
+        }
+        VIO_LOG_DEBUG("LK retry recovered " << std::count(m_scratch.retry_status.begin(),
+                                                           m_scratch.retry_status.end(), 1)
+                      << "/" << retry_indices.size() << " points");
+    }
+
+    // Append surviving tracks to the current frame's store, with their pixel velocity
+    const std::vector<int>& prev_ids = prev_store.get_ids();
+    const std::vector<int>& prev_track_counts = prev_store.get_track_counts();
+    const cv::Size img_size = current_frame->get_image().size();
 
-    // Perform optical flow tracking
-    cv::calcOpticalFlowPyrLK(previous_frame->get_image(), current_frame->get_image(),
-                            prev_pts, cur_pts, status, err,
-                            m_win_size, m_max_level, m_criteria);
+    FeatureStore& cur_store = current_frame->get_feature_store();
+    std::vector<float>& prediction_errors = m_scratch.residuals;
+    prediction_errors.clear();
+    const float inv_dt = dt > 0.0 ? static_cast<float>(1.0 / dt) : 0.0f;
+    std::vector<size_t>& matches = m_scratch.match_indices;
+    matches.clear();
 
-    // Create features for current frame based on tracking results
+    const size_t first_tracked = cur_store.size();
     int tracked_features = 0;
-    for (size_t i = 0; i < prev_pts.size(); ++i) {
-        if (status[i] && is_in_border(cur_pts[i], current_frame->get_image().size())) {
-            auto prev_feature = previous_frame->get_features()[i];
-            auto new_feature = std::make_shared<Feature>(
-                prev_feature->get_feature_id(),
-                cur_pts[i]
-            );
-            new_feature->set_track_count(prev_feature->get_track_count() + 1);
-            current_frame->add_feature(new_feature);
+    for (size_t i = 0; i < count; ++i) {
+        if (prev_valid[i] && status[i] && is_in_border(cur_pts[i], img_size)) {
+            size_t index = current_frame->add_feature(prev_ids[i], cur_pts[i]);
+            cur_store.get_track_counts()[index] = prev_track_counts[i] + 1;
+            cur_store.get_velocities()[index] = (cur_pts[i] - prev_pts[i]) * inv_dt;
+            matches.push_back(i);
             tracked_features++;
+
+            // Only features with their own velocity measure the motion model
+            if (predict && prev_track_counts[i] > 1) {
+                cv::Point2f miss = cur_pts[i] - m_scratch.predicted_points[i];
+                prediction_errors.push_back(std::sqrt(miss.dot(miss)));
+            }
         }
     }
+    undistort_features(cur_store, first_tracked);
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
-    
-    std::cout << "[TIMING] Optical flow tracking: " << duration.count() / 1000.0 << " ms | "
-              << "Tracked " << tracked_features << "/" << prev_pts.size() << " features" << std::endl;
+    // Confidence for the next frame: accurate predictions and few losses
+    if (predict) {
+        bool enough_samples = prediction_errors.size() >= 10;
+        float median_error = std::numeric_limits<float>::max();
+        if (enough_samples) {
+            auto middle = prediction_errors.begin() + prediction_errors.size() / 2;
+            std::nth_element(prediction_errors.begin(), middle, prediction_errors.end());
+            median_error = *middle;
+        }
+        bool few_losses = valid_count > 0 && lost_first_pass * 5 <= valid_count;
+        m_prediction_confident = enough_samples && few_losses && median_error < m_prediction_confidence_px;
+        VIO_LOG_DEBUG("Motion prediction median error " << median_error << " px, lost "
+                      << lost_first_pass << "/" << valid_count
+                      << (reduced ? " (reduced LK)" : "") << (m_prediction_confident ? ", confident" : ""));
+    } else {
+        m_prediction_confident = false;
+    }
+
+    m_matched_frame_id = current_frame->get_frame_id();
+
+    VIO_PROFILE_COUNTER(ForwardBackwardRejected, fb_rejected);
+    VIO_PROFILE_COUNTER(FeaturesTracked, tracked_features);
+    VIO_LOG_DEBUG("Tracked " << tracked_features << "/" << count << " features");
+}
+
+void FeatureTracker::predict_positions(const FeatureStore& prev_store, double dt,
+                                       std::vector<cv::Point2f>& predicted) {
+    const std::vector<cv::Point2f>& prev_pts = prev_store.get_pixel_coords();
+    const std::vector<cv::Point2f>& velocities = prev_store.get_velocities();
+    const std::vector<int>& track_counts = prev_store.get_track_counts();
+    const std::vector<uchar>& valid = prev_store.get_valid_flags();
+    const float step = static_cast<float>(dt);
+
+    // Features detected in the previous frame have no velocity yet; they move
+    // with the median flow of the established tracks
+    std::vector<float>& components = m_scratch.residuals;
+    cv::Point2f median_velocity(0.0f, 0.0f);
+    for (int axis = 0; axis < 2; ++axis) {
+        components.clear();
+        for (size_t i = 0; i < prev_pts.size(); ++i) {
+            if (valid[i] && track_counts[i] > 1) {
+                components.push_back(axis == 0 ? velocities[i].x : velocities[i].y);
+            }
+        }
+        if (components.empty()) break;
+        auto middle = components.begin() + components.size() / 2;
+        std::nth_element(components.begin(), middle, components.end());
+        (axis == 0 ? median_velocity.x : median_velocity.y) = *middle;
+    }
+
+    predicted.resize(prev_pts.size());
+    for (size_t i = 0; i < prev_pts.size(); ++i) {
+        const cv::Point2f& velocity = track_counts[i] > 1 ? velocities[i] : median_velocity;
+        predicted[i] = prev_pts[i] + velocity * step;
+    }
+}
+
+int FeatureTracker::track_points_batched(const std::vector<cv::Mat>& prev_pyramid,
+                                         const std::vector<cv::Mat>& cur_pyramid,
+                                         const std::vector<cv::Point2f>& prev_pts,
+                                         std::vector<cv::Point2f>& cur_pts,
+                                         std::vector<uchar>& status,
+                                         std::vector<float>& err,
+                                         const LKParams& params) {
+    const size_t count = prev_pts.size();
+    if (m_use_fb_check) {
+        m_scratch.back_points.resize(count);
+        m_scratch.back_status.resize(count);
+        m_scratch.back_err.resize(count);
+    }
+
+    // Each batch runs forward and then (optionally) backward LK on its own slice.
+    // Points are tracked independently, so the result equals one big call.
+    const size_t batch_size = m_lk_batch_size;
+    const size_t num_batches = (count + batch_size - 1) / batch_size;
+    std::atomic<int> fb_rejected(0);
+    auto track_batch = [&](size_t batch) {
+        size_t begin = batch * batch_size;
+        int n = static_cast<int>(std::min(batch_size, count - begin));
+
+        run_lk(prev_pyramid, cur_pyramid, prev_pts.data() + begin, cur_pts.data() + begin,
+               status.data() + begin, err.data() + begin, n, params);
+
+        if (!m_use_fb_check) {
+            return;
+        }
+
+        // Backward pass starts at the forward result (never seeded, which would
+        // bias it towards the start point) and should land on the start point
+        VIO_PROFILE_SCOPE("lk_backward");
+        uchar* back_status = m_scratch.back_status.data() + begin;
+        LKParams back_params{params.max_level, params.criteria, false};
+        run_lk(cur_pyramid, prev_pyramid, cur_pts.data() + begin, m_scratch.back_points.data() + begin,
+               back_status, m_scratch.back_err.data() + begin, n, back_params);
+
+        const float threshold_sq = m_fb_threshold * m_fb_threshold;
+        int rejected = 0;
+        for (int i = 0; i < n; ++i) {
+            size_t k = begin + i;
+            if (!status[k]) continue;
+            cv::Point2f diff = m_scratch.back_points[k] - prev_pts[k];
+            if (!back_status[i] || diff.dot(diff) > threshold_sq) {
+                status[k] = 0;
+                rejected++;
+            }
+        }
+        fb_rejected.fetch_add(rejected, std::memory_order_relaxed);
+    };
+
+    if (m_thread_pool) {
+        m_thread_pool->parallel_for(num_batches, track_batch);
+    } else {
+        for (size_t batch = 0; batch < num_batches; ++batch) {
+            track_batch(batch);
+        }
+    }
+    return fb_rejected.load();
+}
+
+void FeatureTracker::run_lk(const std::vector<cv::Mat>& from_pyramid, const std::vector<cv::Mat>& to_pyramid,
+                            const cv::Point2f* from_pts, cv::Point2f* to_pts, uchar* status, float* err, int count,
+                            const LKParams& params) const {
+    if (m_use_sparse_lk) {
+        SparseLKParams sparse_params;
+        sparse_params.max_level = params.max_level;
+        sparse_params.max_iterations = params.criteria.maxCount;
+        sparse_params.epsilon = static_cast<float>(params.criteria.epsilon);
+        sparse_params.use_initial_flow = params.use_initial_flow;
+        if (sparse_lk_track(from_pyramid, to_pyramid, m_win_size.width, from_pts, to_pts, status, err,
+                            count, sparse_params)) {
+            return;
+        }
+    }
+
+    // Mat headers over the caller's buffers, so LK writes in place
+    cv::Mat from_mat(count, 1, CV_32FC2, const_cast<cv::Point2f*>(from_pts));
+    cv::Mat to_mat(count, 1, CV_32FC2, to_pts);
+    cv::Mat status_mat(count, 1, CV_8UC1, status);
+    cv::Mat err_mat(count, 1, CV_32FC1, err);
+    ExternalAllocationScope external;
+    cv::calcOpticalFlowPyrLK(from_pyramid, to_pyramid, from_mat, to_mat, status_mat, err_mat,
+                             m_win_size, params.max_level, params.criteria,
+                             params.use_initial_flow ? cv::OPTFLOW_USE_INITIAL_FLOW : 0);
+}
+
+void FeatureTracker::set_camera_model(const CameraModel& camera) {
+    m_camera = camera;
+    m_ransac.reset();
+}
+
+void FeatureTracker::undistort_features(FeatureStore& store, size_t first_index) const {
+    if (!m_camera.is_valid() || first_index >= store.size()) {
+        return;
+    }
+    m_camera.undistort_points(store.get_pixel_coords().data() + first_index,
+                              store.get_normalized_coords().data() + first_index, store.size() - first_index);
+}
+
+void FeatureTracker::set_sparse_lk(bool enabled) {
+    if (enabled && (m_win_size.width != m_win_size.height || !sparse_lk_supports_window(m_win_size.width))) {
+        VIO_LOG_WARN("Sparse LK has no kernel for a " << m_win_size.width << "x" << m_win_size.height
+                     << " window; keeping cv::calcOpticalFlowPyrLK");
+        enabled = false;
+    }
+    m_use_sparse_lk = enabled;
 }
 
 void FeatureTracker::reject_outliers_with_fundamental_matrix(std::shared_ptr<Frame> current_frame,
                                                            std::shared_ptr<Frame> previous_frame) {
-    if (current_frame->get_feature_count() < 8) {
+    VIO_PROFILE_SCOPE("reject_outliers");
+
+    const size_t count = current_frame->get_feature_count();
+    if (count < 8) {
         return; // Need at least 8 points for fundamental matrix
     }
 
-    std::vector<cv::Point2f> prev_pts, cur_pts;
-    std::vector<int> feature_ids;
-
-    // Collect corresponding points
-    for (const auto& feature : current_frame->get_features()) {
-        auto prev_feature = previous_frame->get_feature(feature->get_feature_id());
-        if (prev_feature && prev_feature->is_valid()) {
-            prev_pts.push_back(prev_feature->get_pixel_coord());
-            cur_pts.push_back(feature->get_pixel_coord());
-            feature_ids.push_back(feature->get_feature_id());
+    // Previous-frame slot of every current slot: recorded by tracking for this
+    // frame pair, otherwise looked up by id
+    std::vector<size_t>& matches = m_scratch.match_indices;
+    const FeatureStore& cur_store = current_frame->get_feature_store();
+    bool all_matched = m_matched_frame_id == current_frame->get_frame_id() && matches.size() == count;
+    if (!all_matched) {
+        matches.clear();
+        const std::vector<int>& ids = cur_store.get_ids();
+        for (size_t i = 0; i < count; ++i) {
+            auto prev_feature = previous_frame->get_feature(ids[i]);
+            matches.push_back(prev_feature && prev_feature->is_valid() ? prev_feature.get_index() : NO_MATCH);
         }
+        all_matched = std::find(matches.begin(), matches.end(), NO_MATCH) == matches.end();
+    }
+
+    // Calibrated: essential matrix on normalized coordinates, threshold scaled
+    // to match; otherwise fundamental matrix on pixels
+    const bool essential = m_camera.is_valid() && !m_use_opencv_ransac;
+    const std::vector<cv::Point2f>& prev_column = essential ? previous_frame->get_feature_store().get_normalized_coords()
+                                                            : previous_frame->get_feature_store().get_pixel_coords();
+    const std::vector<cv::Point2f>& cur_column = essential ? cur_store.get_normalized_coords()
+                                                           : cur_store.get_pixel_coords();
+    const std::vector<int>& track_counts = cur_store.get_track_counts();
+
+    std::vector<cv::Point2f>& prev_pts = m_scratch.points_a;
+    std::vector<cv::Point2f>& cur_pts = m_scratch.points_b;
+    std::vector<size_t>& feature_indices = m_scratch.indices;
+    std::vector<int>& priorities = m_scratch.priorities;
+    prev_pts.clear();
+    cur_pts.clear();
+    feature_indices.clear();
+    priorities.clear();
+    for (size_t i = 0; i < count; ++i) {
+        if (matches[i] == NO_MATCH) continue;
+        prev_pts.push_back(prev_column[matches[i]]);
+        if (!all_matched) cur_pts.push_back(cur_column[i]);
+        feature_indices.push_back(i);
+        priorities.push_back(track_counts[i]);
     }
 
     if (prev_pts.size() < 8) {
         return;
     }
 
-    // Find fundamental matrix and inliers
-    std::vector<uchar> status;
-    cv::findFundamentalMat(prev_pts, cur_pts, cv::FM_RANSAC, m_f_threshold, 0.99, status);
+    // Right after tracking every current slot has a match, so the current
+    // column is used directly
+    const std::vector<cv::Point2f>& matched_cur = all_matched ? cur_column : cur_pts;
+    std::vector<uchar>& status = m_scratch.inlier_mask;
+    if (m_use_opencv_ransac) {
+        ExternalAllocationScope external;
+        cv::findFundamentalMat(prev_pts, matched_cur, cv::FM_RANSAC, m_f_threshold, 0.99, status);
+    } else {
+        // Longest tracks are sampled first; the previous frame's model is the first hypothesis
+        m_ransac.set_threshold(essential ? m_f_threshold / m_camera.get_focal_length() : m_f_threshold);
+        EpipolarRansac::Result result = m_ransac.estimate(
+            essential ? EpipolarRansac::Model::Essential : EpipolarRansac::Model::Fundamental,
+            prev_pts, matched_cur, &priorities, status);
+        VIO_PROFILE_COUNTER(RansacIterations, result.iterations);
+        if (!result.success) {
+            VIO_LOG_DEBUG("Epipolar RANSAC found no model; keeping all " << prev_pts.size() << " tracks");
+        }
+    }
 
-    // Remove outliers
+    // Remove outliers in one compaction pass
+    std::vector<uchar>& keep_mask = m_scratch.keep_mask;
+    keep_mask.assign(count, 1);
     for (size_t i = 0; i < status.size(); ++i) {
-        if (!status[i]) {
-            current_frame->remove_feature(feature_ids[i]);
-        }
+        keep_mask[feature_indices[i]] = status[i];
     }
+    current_frame->remove_features(keep_mask);
 
     int outliers_removed = std::count(status.begin(), status.end(), 0);
-    std::cout << "Removed " << outliers_removed << " outliers using fundamental matrix" << std::endl;
+    VIO_PROFILE_COUNTER(FeaturesRejected, outliers_removed);
+    VIO_LOG_DEBUG("Removed " << outliers_removed << " outliers using " << (essential ? "essential" : "fundamental")
+                  << " matrix");
 }
 
 void FeatureTracker::set_mask(std::shared_ptr<Frame> frame) {
-    // This is a placeholder for the mask setting function
-    // In VINS-Mono, this ensures uniform distribution of features
-    // For now, we'll just print a message
-    std::cout << "Setting mask for uniform feature distribution (placeholder)" << std::endl;
+    VIO_PROFILE_SCOPE("set_mask");
+
+    const FeatureStore& store = frame->get_feature_store();
+    m_mask_frame_id = frame->get_frame_id();
+
+    if (m_use_grid_detection) {
+        // Per-cell occupancy and distance bins: full cells are skipped by detection
+        m_detector.set_occupancy(store.get_pixel_coords(), store.get_valid_flags(), frame->get_image().size());
+        return;
+    }
+
+    // Legacy global detection: blank a disc around every existing feature
+    // (Mat::create is a no-op once sized)
+    cv::Mat& mask = m_scratch.mask;
+    mask.create(frame->get_image().size(), CV_8UC1);
+    mask.setTo(cv::Scalar(255));
+    ExternalAllocationScope external;
+    for (const auto& feature : frame->get_features()) {
+        if (feature->is_valid()) {
+            cv::circle(mask, feature->get_pixel_coord(), m_min_distance, 0, -1);
+        }
+    }
 }
 
 void FeatureTracker::update_feature_track_count(std::shared_ptr<Frame> frame) {
-    for (auto& feature : frame->get_features()) {
-        if (feature->is_valid()) {
-            feature->set_track_count(feature->get_track_count() + 1);
+    FeatureStore& store = frame->get_feature_store();
+    std::vector<int>& track_counts = store.get_track_counts();
+    const std::vector<uchar>& valid = store.get_valid_flags();
+    for (size_t i = 0; i < track_counts.size(); ++i) {
+        if (valid[i]) {
+            track_counts[i]++;
         }
     }
 }
 
-std::vector<cv::Point2f> FeatureTracker::extract_points_from_features(
-    const std::vector<std::shared_ptr<Feature>>& features) {
-    std::vector<cv::Point2f> points;
-    for (const auto& feature : features) {
-        if (feature->is_valid()) {
-            points.push_back(feature->get_pixel_coord());
+const std::vector<cv::Point2f>& FeatureTracker::parallax_points(const FeatureStore& store,
+                                                                std::vector<cv::Point2f>& buffer) const {
+    if (!m_camera.is_valid()) {
+        return store.get_pixel_coords();
+    }
+    const std::vector<cv::Point2f>& normalized = store.get_normalized_coords();
+    const float focal = static_cast<float>(m_camera.get_focal_length());
+    buffer.resize(normalized.size());
+    for (size_t i = 0; i < normalized.size(); ++i) {
+        buffer[i] = normalized[i] * focal;
+    }
+    return buffer;
+}
+
+bool FeatureTracker::select_keyframe(const Frame& frame) {
+    VIO_PROFILE_SCOPE("select_keyframe");
+
+    if (!m_use_keyframe_selection) {
+        return true;
+    }
+
+    // Both id columns are normally ascending (see Frame), so one merge pass
+    // pairs the frame's features with the keyframe's; out-of-order ids fall
+    // back to a binary search into the sorted keyframe ids. The pass only
+    // gathers the pairs; the distances are summed afterwards by the SIMD
+    // parallax kernel over the two contiguous arrays.
+    const FeatureStore& store = frame.get_feature_store();
+    const std::vector<int>& ids = store.get_ids();
+    const std::vector<uchar>& valid = store.get_valid_flags();
+    const std::vector<cv::Point2f>& points = parallax_points(store, m_scratch.points_a);
+    const size_t keyframe_size = m_keyframe_ids.size();
+
+    std::vector<cv::Point2f>& current = m_scratch.query_points;
+    std::vector<cv::Point2f>& reference = m_scratch.points_b;
+    current.clear();
+    reference.clear();
+    size_t k = 0;
+    int last_id = -1;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const int id = ids[i];
+        if (id < last_id) {
+            k = std::lower_bound(m_keyframe_ids.begin(), m_keyframe_ids.end(), id) - m_keyframe_ids.begin();
         }
+        last_id = id;
+        while (k < keyframe_size && m_keyframe_ids[k] < id) {
+            k++;
+        }
+        if (k == keyframe_size || m_keyframe_ids[k] != id || !valid[i]) {
+            continue;
+        }
+        current.push_back(points[i]);
+        reference.push_back(m_keyframe_points[k]);
     }
-    return points;
+
+    const size_t shared = current.size();
+    const float parallax_sum = sum_point_distances(reinterpret_cast<const float*>(current.data()),
+                                                   reinterpret_cast<const float*>(reference.data()), shared);
+
+    const KeyframeParams& params = m_keyframe_params;
+    m_last_parallax = shared > 0 ? parallax_sum / shared : 0.0f;
+    const double interval_s = (frame.get_timestamp() - m_keyframe_timestamp) * 1e-9;
+    const bool low_track = static_cast<int>(shared) < params.min_tracked ||
+                           shared < params.min_tracked_ratio * keyframe_size;
+    const bool parallax = m_last_parallax >= params.min_parallax_px;
+    const bool timeout = interval_s >= params.max_interval_s;
+
+    VIO_LOG_DEBUG("Frame " << frame.get_frame_id() << ": parallax " << m_last_parallax << " px, "
+                  << shared << "/" << keyframe_size << " keyframe features tracked"
+                  << (low_track || parallax || timeout ? " -> keyframe" : ""));
+    return low_track || parallax || timeout;
 }
 
-void FeatureTracker::update_features_with_points(
-    std::vector<std::shared_ptr<Feature>>& features,
-    const std::vector<cv::Point2f>& points,
-    const std::vector<uchar>& status) {
-    
-    size_t point_idx = 0;
-    for (auto& feature : features) {
-        if (feature->is_valid() && point_idx < points.size()) {
-            if (status[point_idx]) {
-                feature->set_pixel_coord(points[point_idx]);
-            } else {
-                feature->set_valid(false);
-            }
-            point_idx++;
+void FeatureTracker::record_keyframe(const Frame& frame) {
+    const FeatureStore& store = frame.get_feature_store();
+    const std::vector<int>& ids = store.get_ids();
+    const std::vector<uchar>& valid = store.get_valid_flags();
+    const std::vector<cv::Point2f>& points = parallax_points(store, m_scratch.points_a);
+
+    // Only valid slots: invalidated ones would count towards keyframe_size in
+    // select_keyframe without ever being matched
+    std::vector<size_t>& slots = m_scratch.indices;
+    slots.clear();
+    for (size_t i = 0; i < ids.size(); ++i) {
+        if (valid[i]) {
+            slots.push_back(i);
         }
     }
+    auto by_id = [&](size_t a, size_t b) { return ids[a] < ids[b]; };
+    if (!std::is_sorted(slots.begin(), slots.end(), by_id)) {
+        std::sort(slots.begin(), slots.end(), by_id);
+    }
+
+    m_keyframe_ids.clear();
+    m_keyframe_points.clear();
+    for (size_t slot : slots) {
+        m_keyframe_ids.push_back(ids[slot]);
+        m_keyframe_points.push_back(points[slot]);
+    }
+    m_keyframe_timestamp = frame.get_timestamp();
+    m_keyframe_count++;
+    VIO_PROFILE_COUNTER(Keyframes, 1);
 }
 
 bool FeatureTracker::is_in_border(const cv::Point2f& point, const cv::Size& img_size, int border_size) const {
@@ -1,13 +1,28 @@
 #pragma once
 
 #include <opencv2/opencv.hpp>
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include "../database/Frame.h"
 #include "../database/Feature.h"
+#include "../util/CameraModel.h"
+#include "../util/ScratchBuffers.h"
+#include "../util/ThreadPool.h"
+#include "EpipolarRansac.h"
+#include "GridFeatureDetector.h"
 
 namespace lightweight_vio {
 
+// Keyframe policy: a frame becomes a keyframe when any of these hold
+// against the last keyframe
+struct KeyframeParams {
+    float min_parallax_px = 10.0f;    // Mean displacement of the features both frames share
+    float min_tracked_ratio = 0.5f;   // Fraction of the last keyframe's features still tracked
+    int min_tracked = 20;             // Absolute floor on those shared features
+    double max_interval_s = 0.5;      // Time since the last keyframe
+};
+
 class FeatureTracker {
 public:
     FeatureTracker();
@@ -26,16 +41,91 @@ public:
     void reject_outliers_with_fundamental_matrix(std::shared_ptr<Frame> current_frame,
                                                std::shared_ptr<Frame> previous_frame);
 
-    // Feature distribution
+    // Feature distribution: records where the frame's features already are so
+    // detection keeps new corners away from them (grid occupancy, or a disc
+    // mask for the legacy global detector)
     void set_mask(std::shared_ptr<Frame> frame);
 
     // Getters/Setters
     void set_max_features(int max_features) { m_max_features = max_features; }
     int get_max_features() const { return m_max_features; }
     
-    void set_min_distance(double min_distance) { m_min_distance = min_distance; }
+    void set_min_distance(double min_distance) {
+        m_min_distance = min_distance;
+        m_detector.set_min_distance(min_distance);
+    }
     double get_min_distance() const { return m_min_distance; }
 
+    // Recycler for the columns and pyramid levels of the frames this tracker
+    // fills: each tracked frame is attached (Frame::set_buffer_pool). Shared
+    // with the frames; the tracker makes its own, null turns recycling off.
+    void set_frame_buffer_pool(std::shared_ptr<FrameBufferPool> pool) { m_buffer_pool = std::move(pool); }
+    const std::shared_ptr<FrameBufferPool>& get_frame_buffer_pool() const { return m_buffer_pool; }
+
+    // Grid-bucketed detection (default) vs. one global goodFeaturesToTrack
+    void set_grid_detection(bool enabled) { m_use_grid_detection = enabled; }
+    bool is_grid_detection() const { return m_use_grid_detection; }
+    void set_detection_grid(int cols, int rows) { m_detector.set_grid_size(cols, rows); }
+
+    // Forward-backward LK check: track prev->cur->prev and drop points whose
+    // round trip misses the start by more than threshold pixels
+    void set_forward_backward_check(bool enabled, float threshold = 0.5f) {
+        m_use_fb_check = enabled;
+        m_fb_threshold = threshold;
+    }
+    bool is_forward_backward_check() const { return m_use_fb_check; }
+
+    // LK runs in batches of this many points, spread over the thread pool
+    void set_lk_batch_size(size_t batch_size) { m_lk_batch_size = std::max<size_t>(1, batch_size); }
+
+    // Constant-velocity motion prediction: LK starts from predicted positions
+    // (OPTFLOW_USE_INITIAL_FLOW). After a frame whose median prediction error was
+    // below confidence_px, LK runs with max_level/iterations reduced to the
+    // given values; points the reduced search loses are retried at full depth.
+    void set_motion_prediction(bool enabled) { m_use_motion_prediction = enabled; }
+    bool is_motion_prediction() const { return m_use_motion_prediction; }
+    void set_prediction_parameters(float confidence_px, int max_level, int iterations) {
+        m_prediction_confidence_px = confidence_px;
+        m_predicted_max_level = max_level;
+        m_predicted_iterations = iterations;
+    }
+
+    // Calibrated camera. With it, features carry undistorted normalized
+    // coordinates (one batch per frame) and outlier rejection fits an essential
+    // matrix (5-point RANSAC); without, a fundamental matrix on pixels. Build
+    // the camera's undistortion grid first to interpolate instead of iterating.
+    void set_camera_model(const CameraModel& camera);
+    bool has_camera_model() const { return m_camera.is_valid(); }
+    const CameraModel& get_camera_model() const { return m_camera; }
+
+    // cv::findFundamentalMat(FM_RANSAC) instead of the in-project EpipolarRansac
+    void set_opencv_ransac(bool enabled) { m_use_opencv_ransac = enabled; }
+    bool is_opencv_ransac() const { return m_use_opencv_ransac; }
+
+    // In-project fixed-point SIMD LK (SparseLK) instead of cv::calcOpticalFlowPyrLK.
+    // Falls back to OpenCV if the window size has no compiled kernel.
+    void set_sparse_lk(bool enabled);
+    bool is_sparse_lk() const { return m_use_sparse_lk; }
+
+    // Keyframe selection (default on). Each tracked frame is marked with
+    // Frame::set_keyframe; downstream stages run stereo, depth and mapping on
+    // keyframes only. Disabled, every frame is a keyframe. Parallax is
+    // measured on undistorted coordinates (scaled back to pixels by the focal
+    // length) when a camera model is set, on raw pixels otherwise, and is not
+    // rotation-compensated.
+    void set_keyframe_selection(bool enabled, const KeyframeParams& params = KeyframeParams()) {
+        m_use_keyframe_selection = enabled;
+        m_keyframe_params = params;
+    }
+    bool is_keyframe_selection() const { return m_use_keyframe_selection; }
+    size_t get_keyframe_count() const { return m_keyframe_count; }
+    // Mean parallax (px) of the last tracked frame against its keyframe
+    float get_last_parallax() const { return m_last_parallax; }
+
+    // Worker threads for parallel detection and LK batches (0 = run everything on the caller)
+    void set_num_threads(size_t num_threads);
+    size_t get_num_threads() const { return m_thread_pool ? m_thread_pool->get_num_threads() : 0; }
+
 private:
     // Parameters
     int m_max_features;
@@ -47,17 +137,68 @@ private:
     cv::Size m_win_size;
     int m_max_level;
     cv::TermCriteria m_criteria;
+    bool m_use_fb_check;
+    float m_fb_threshold;
+    size_t m_lk_batch_size;
+    bool m_use_sparse_lk;
+
+    // Outlier rejection
+    bool m_use_opencv_ransac;
+    EpipolarRansac m_ransac;
+    CameraModel m_camera;
+    int m_matched_frame_id;          // Frame m_scratch.match_indices was recorded for
+    static constexpr size_t NO_MATCH = static_cast<size_t>(-1);
+
+    // Motion prediction
+    bool m_use_motion_prediction;
+    float m_prediction_confidence_px;
+    int m_predicted_max_level;
+    int m_predicted_iterations;
+    bool m_prediction_confident;   // Last frame's predictions were accurate
     
+    // Keyframe selection; the last keyframe's valid features, sorted by id
+    bool m_use_keyframe_selection;
+    KeyframeParams m_keyframe_params;
+    std::vector<int> m_keyframe_ids;
+    std::vector<cv::Point2f> m_keyframe_points;  // Parallax coordinates (px)
+    long long m_keyframe_timestamp;
+    size_t m_keyframe_count;
+    float m_last_parallax;
+
     // Global feature ID counter
     int m_global_feature_id;
+
+    // Feature detection
+    bool m_use_grid_detection;
+    GridFeatureDetector m_detector;
+    int m_mask_frame_id;           // Frame the current mask/occupancy was built for
+    std::unique_ptr<ThreadPool> m_thread_pool;
+
+    // Per-frame transient buffers, reused so steady-state tracking does not allocate
+    ScratchBuffers m_scratch;
+    std::shared_ptr<FrameBufferPool> m_buffer_pool;
     
     // Helper functions
     bool is_in_border(const cv::Point2f& point, const cv::Size& img_size, int border_size = 1) const;
+    void undistort_features(FeatureStore& store, size_t first_index) const;
+    struct LKParams {
+        int max_level;
+        cv::TermCriteria criteria;
+        bool use_initial_flow;     // cur_pts holds the initial guesses
+    };
+    // cur_pts/status/err must be sized like prev_pts; returns the forward-backward rejects
+    int track_points_batched(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& cur_pyramid,
+                             const std::vector<cv::Point2f>& prev_pts, std::vector<cv::Point2f>& cur_pts,
+                             std::vector<uchar>& status, std::vector<float>& err, const LKParams& params);
+    void run_lk(const std::vector<cv::Mat>& from_pyramid, const std::vector<cv::Mat>& to_pyramid,
+                const cv::Point2f* from_pts, cv::Point2f* to_pts, uchar* status, float* err, int count,
+                const LKParams& params) const;
+    void predict_positions(const FeatureStore& prev_store, double dt, std::vector<cv::Point2f>& predicted);
     void update_feature_track_count(std::shared_ptr<Frame> frame);
-    std::vector<cv::Point2f> extract_points_from_features(const std::vector<std::shared_ptr<Feature>>& features);
-    void update_features_with_points(std::vector<std::shared_ptr<Feature>>& features, 
-                                    const std::vector<cv::Point2f>& points,
-                                    const std::vector<uchar>& status);
+    // Coordinates parallax is measured in: normalized * focal, or pixels
+    const std::vector<cv::Point2f>& parallax_points(const FeatureStore& store, std::vector<cv::Point2f>& buffer) const;
+    bool select_keyframe(const Frame& frame);
+    void record_keyframe(const Frame& frame);
 };
 
 } // namespace lightweight_vio
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "FrontendPipeline.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+
+namespace lightweight_vio {
+
+FrontendPipeline::FrontendPipeline(DatasetReader& reader, FeatureTracker& tracker)
+    : m_reader(reader)
+    , m_tracker(tracker)
+    , m_queue_capacity(4)
+    , m_baseline(0.0f)
+    , m_focal_length(0.0f)
+    , m_rectified_stereo(false)
+    , m_stereo_reuse(false)
+    , m_disparity_estimator(nullptr)
+    , m_pose_estimator(nullptr)
+    , m_skipped_frames(0)
+{
+}
+
+FrontendPipeline::~FrontendPipeline() {
+    stop();
+}
+
+void FrontendPipeline::start() {
+    stop();
+
+    m_track_queue = std::make_unique<Queue>(m_queue_capacity);
+    m_stereo_queue = std::make_unique<Queue>(m_queue_capacity);
+    m_depth_queue = std::make_unique<Queue>(m_queue_capacity);
+    m_output_queue = std::make_unique<Queue>(m_queue_capacity);
+    m_skipped_frames.store(0, std::memory_order_relaxed);
+    if (m_disparity_estimator && !m_rectified_stereo) {
+        VIO_LOG_WARN("Dense disparity needs rectified stereo; disparity estimator ignored");
+    }
+
+    m_reader.start(0);
+
+    m_workers.emplace_back(&FrontendPipeline::load_stage, this);
+    m_workers.emplace_back(&FrontendPipeline::track_stage, this);
+    m_workers.emplace_back(&FrontendPipeline::stereo_stage, this);
+    m_workers.emplace_back(&FrontendPipeline::depth_stage, this);
+}
+
+void FrontendPipeline::stop() {
+    if (m_workers.empty()) {
+        return;
+    }
+
+    // Closing every queue unblocks all stages, then the reader unblocks the loader
+    m_track_queue->close();
+    m_stereo_queue->close();
+    m_depth_queue->close();
+    m_output_queue->close();
+    m_reader.stop();
+
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+bool FrontendPipeline::pop(FrontendResult& result) {
+    if (!m_output_queue) {
+        return false;
+    }
+    return m_output_queue->pop(result);
+}
+
+void FrontendPipeline::load_stage() {
+    StereoImageData stereo_data;
+    while (m_reader.pop(stereo_data)) {
+        if (stereo_data.left_image.empty()) {
+            m_skipped_frames.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        FrontendResult item;
+        item.start_ns = Profiler::now_ns();
+        item.frame = std::make_shared<Frame>(stereo_data.timestamp, static_cast<int>(stereo_data.index));
+        if (!stereo_data.right_image.empty()) {
+            item.frame->set_stereo_images(std::move(stereo_data.left_image), std::move(stereo_data.right_image));
+        } else {
+            item.frame->set_left_image(std::move(stereo_data.left_image));
+        }
+
+        if (!m_track_queue->push(std::move(item))) {
+            break;
+        }
+    }
+    m_track_queue->close();
+}
+
+void FrontendPipeline::track_stage() {
+    std::shared_ptr<Frame> previous_frame = nullptr;
+    FrontendResult item;
+    while (m_track_queue->pop(item)) {
+        if (previous_frame && item.frame->get_frame_id() <= previous_frame->get_frame_id()) {
+            VIO_LOG_ERROR("Frontend pipeline received frame " << item.frame->get_frame_id()
+                          << " after " << previous_frame->get_frame_id());
+        }
+
+        m_tracker.track_features(item.frame, previous_frame);
+        previous_frame = item.frame;
+
+        if (!m_stereo_queue->push(std::move(item))) {
+            break;
+        }
+    }
+    m_stereo_queue->close();
+}
+
+void FrontendPipeline::stereo_stage() {
+    FrontendResult item;
+    // Frames leave this stage in order, so the last keyframe matched here is
+    // the one to carry stereo matches over from
+    std::shared_ptr<Frame> previous;
+    while (m_stereo_queue->pop(item)) {
+        if (item.frame->is_keyframe() && item.frame->is_stereo()) {
+            const Frame* reuse_from = m_stereo_reuse ? previous.get() : nullptr;
+            if (m_rectified_stereo) {
+                item.frame->compute_stereo_matches_rectified(m_scanline_params, reuse_from);
+            } else {
+                item.frame->compute_stereo_matches(reuse_from);
+            }
+            previous = item.frame;
+        }
+
+        if (!m_depth_queue->push(std::move(item))) {
+            break;
+        }
+    }
+    m_depth_queue->close();
+}
+
+void FrontendPipeline::depth_stage() {
+    FrontendResult item;
+    while (m_depth_queue->pop(item)) {
+        if (!item.frame->is_keyframe()) {
+            // Non-keyframes pass straight through
+        } else if (item.frame->is_stereo() && m_stereo_camera.is_valid()) {
+            VIO_PROFILE_SCOPE("estimate_depth");
+            item.frame->estimate_depth_from_stereo(m_stereo_camera);
+        } else if (item.frame->is_stereo() && m_baseline > 0.0f && m_focal_length > 0.0f) {
+            VIO_PROFILE_SCOPE("estimate_depth");
+            item.frame->estimate_depth_from_stereo(m_baseline, m_focal_length);
+        }
+        if (m_disparity_estimator && m_rectified_stereo && item.frame->is_keyframe() && item.frame->is_stereo() &&
+            item.frame->compute_disparity_map(*m_disparity_estimator, item.disparity)) {
+            item.frame->estimate_depth_from_disparity(item.disparity, m_stereo_camera);
+        }
+        if (m_pose_estimator) {
+            m_pose_estimator->process(*item.frame);
+        }
+        item.end_ns = Profiler::now_ns();
+
+        if (!m_output_queue->push(std::move(item))) {
+            break;
+        }
+    }
+    m_output_queue->close();
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "../database/Frame.h"
+#include "../dataset/DatasetReader.h"
+#include "../util/CameraModel.h"
+#include "../util/SPSCQueue.h"
+#include "../util/ScanlineStereo.h"
+#include "DisparityEstimator.h"
+#include "FeatureTracker.h"
+#include "PoseEstimator.h"
+
+namespace lightweight_vio {
+
+// A frame leaving the pipeline, with its wall-clock entry/exit times
+struct FrontendResult {
+    std::shared_ptr<Frame> frame;
+    uint64_t start_ns = 0;   // Frame created from decoded images
+    uint64_t end_ns = 0;     // All stages finished
+    cv::Mat disparity;       // Dense disparity (px), when a disparity estimator is set
+};
+
+// Staged frontend: load -> temporal track -> stereo match -> depth (and pose),
+// one worker per stage, linked by bounded SPSC queues. Decoding and CLAHE run on the
+// DatasetReader's own workers. Stereo matching, depth and dense disparity run
+// on keyframes only (the tracker's keyframe selection); other frames pass
+// through those stages untouched. Stereo/depth for frame N only write N's
+// stereo fields, which temporal tracking of N+1 never reads, so stages overlap
+// while producing exactly the serial results. Every stage is FIFO, so frames
+// leave in frame_id order.
+class FrontendPipeline {
+public:
+    FrontendPipeline(DatasetReader& reader, FeatureTracker& tracker);
+    ~FrontendPipeline();
+
+    FrontendPipeline(const FrontendPipeline&) = delete;
+    FrontendPipeline& operator=(const FrontendPipeline&) = delete;
+
+    // Configuration (before start())
+    void set_queue_capacity(size_t capacity) { m_queue_capacity = std::max<size_t>(1, capacity); }
+    void set_stereo_parameters(float baseline, float focal_length) {
+        m_baseline = baseline;
+        m_focal_length = focal_length;
+    }
+    // Calibrated rig: depth is triangulated from undistorted coordinates instead
+    void set_stereo_camera(const StereoCamera& stereo) { m_stereo_camera = stereo; }
+    // The reader delivers rectified pairs: match along scanlines instead of 2D LK
+    void set_rectified_stereo(bool rectified, const ScanlineStereoParams& params = ScanlineStereoParams()) {
+        m_rectified_stereo = rectified;
+        m_scanline_params = params;
+    }
+    // Carry the previous keyframe's stereo matches over instead of re-matching them
+    void set_stereo_reuse(bool reuse) { m_stereo_reuse = reuse; }
+    // Optional; not owned. The depth stage also computes a dense disparity map
+    // (rectified pairs only) and features without a sparse depth look theirs up in it.
+    void set_disparity_estimator(DisparityEstimator* estimator) { m_disparity_estimator = estimator; }
+    // Optional; not owned. The depth stage sets every frame's pose, in order,
+    // once the previous keyframe's depths are in.
+    void set_pose_estimator(PoseEstimator* estimator) { m_pose_estimator = estimator; }
+
+    void start();
+    void stop();
+
+    // Block until the next processed frame is ready. Returns false at end of sequence.
+    bool pop(FrontendResult& result);
+
+    size_t get_skipped_frames() const { return m_skipped_frames.load(std::memory_order_relaxed); }
+
+private:
+    using Queue = SPSCQueue<FrontendResult>;
+
+    void load_stage();
+    void track_stage();
+    void stereo_stage();
+    void depth_stage();
+
+    DatasetReader& m_reader;
+    FeatureTracker& m_tracker;
+
+    size_t m_queue_capacity;
+    float m_baseline;
+    float m_focal_length;
+    StereoCamera m_stereo_camera;
+    bool m_rectified_stereo;
+    ScanlineStereoParams m_scanline_params;
+    bool m_stereo_reuse;
+    DisparityEstimator* m_disparity_estimator;
+    PoseEstimator* m_pose_estimator;
+
+    std::unique_ptr<Queue> m_track_queue;
+    std::unique_ptr<Queue> m_stereo_queue;
+    std::unique_ptr<Queue> m_depth_queue;
+    std::unique_ptr<Queue> m_output_queue;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_skipped_frames;
+};
+
+} // namespace lightweight_vio
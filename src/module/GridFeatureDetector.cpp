@@ -0,0 +1,251 @@
+#include "GridFeatureDetector.h"
+#include "../util/ExternalAllocationScope.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lightweight_vio {
+
+GridFeatureDetector::GridFeatureDetector()
+    : m_grid_cols(8)
+    , m_grid_rows(6)
+    , m_quality_level(0.01)
+    , m_min_distance(30.0)
+    , m_block_size(3)
+    , m_use_cell_quota(true)
+    , m_thread_pool(nullptr)
+{
+}
+
+void GridFeatureDetector::set_grid_size(int cols, int rows) {
+    m_grid_cols = std::max(1, cols);
+    m_grid_rows = std::max(1, rows);
+}
+
+int GridFeatureDetector::cell_index(float x, float y) const {
+    // Cell cx covers integer columns [ceil(cx * W / cols), ceil((cx + 1) * W / cols))
+    int ix = std::min(std::max(static_cast<int>(x), 0), m_image_size.width - 1);
+    int iy = std::min(std::max(static_cast<int>(y), 0), m_image_size.height - 1);
+    int cx = ix * m_grid_cols / m_image_size.width;
+    int cy = iy * m_grid_rows / m_image_size.height;
+    return cy * m_grid_cols + cx;
+}
+
+void GridFeatureDetector::set_occupancy(const std::vector<cv::Point2f>& points, const std::vector<uchar>& valid,
+                                        const cv::Size& image_size) {
+    m_image_size = image_size;
+    m_cell_counts.assign(static_cast<size_t>(m_grid_cols) * m_grid_rows, 0);
+
+    // Distance bins: a point can only conflict with points in its own or adjacent bins
+    double bin_size = std::max(m_min_distance, 1.0);
+    m_distance_cols = std::max(1, static_cast<int>(std::ceil(image_size.width / bin_size)));
+    m_distance_rows = std::max(1, static_cast<int>(std::ceil(image_size.height / bin_size)));
+    m_distance_bins.resize(static_cast<size_t>(m_distance_cols) * m_distance_rows);
+    for (auto& bin : m_distance_bins) {
+        bin.clear();  // Keep capacity across frames
+        bin.reserve(DISTANCE_BIN_CAPACITY);
+    }
+
+    if (image_size.width <= 0 || image_size.height <= 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (i < valid.size() && !valid[i]) continue;
+        m_cell_counts[cell_index(points[i].x, points[i].y)]++;
+        add_to_distance_grid(points[i]);
+    }
+}
+
+void GridFeatureDetector::add_to_distance_grid(const cv::Point2f& point) {
+    double bin_size = std::max(m_min_distance, 1.0);
+    int bx = std::min(std::max(static_cast<int>(point.x / bin_size), 0), m_distance_cols - 1);
+    int by = std::min(std::max(static_cast<int>(point.y / bin_size), 0), m_distance_rows - 1);
+    m_distance_bins[by * m_distance_cols + bx].push_back(point);
+}
+
+bool GridFeatureDetector::is_far_from_existing(const cv::Point2f& point) const {
+    double bin_size = std::max(m_min_distance, 1.0);
+    double min_distance_sq = m_min_distance * m_min_distance;
+    int bx = static_cast<int>(point.x / bin_size);
+    int by = static_cast<int>(point.y / bin_size);
+
+    for (int y = std::max(by - 1, 0); y <= std::min(by + 1, m_distance_rows - 1); ++y) {
+        for (int x = std::max(bx - 1, 0); x <= std::min(bx + 1, m_distance_cols - 1); ++x) {
+            for (const cv::Point2f& other : m_distance_bins[y * m_distance_cols + x]) {
+                double dx = point.x - other.x;
+                double dy = point.y - other.y;
+                if (dx * dx + dy * dy < min_distance_sq) {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void GridFeatureDetector::detect(const cv::Mat& image, int max_features, int max_new,
+                                 std::vector<cv::Point2f>& corners) {
+    VIO_PROFILE_SCOPE("grid_detect");
+
+    m_skipped_cells = 0;
+    if (image.empty() || max_new <= 0) {
+        return;
+    }
+    if (image.size() != m_image_size || m_cell_counts.empty()) {
+        set_occupancy({}, {}, image.size());  // No prior set_occupancy() for this image
+    }
+
+    const int num_cells = m_grid_cols * m_grid_rows;
+    const int quota = m_use_cell_quota ? std::max(1, (max_features + num_cells - 1) / num_cells) : max_new;
+    const int width = image.cols;
+    const int height = image.rows;
+
+    // Tiles are the grid cells; full cells are skipped. Sobel reads the real
+    // pixels around an ROI but the covariance box filter extrapolates at the
+    // tile edge, so tiles overlap by the box radius plus one pixel: every
+    // response the 3x3 maximum test reads then equals a full-image computation.
+    const int overlap = m_block_size / 2 + 1;
+    m_tiles.resize(num_cells);
+    m_active_tiles.clear();
+    size_t max_candidates = 0;
+    for (int cy = 0; cy < m_grid_rows; ++cy) {
+        for (int cx = 0; cx < m_grid_cols; ++cx) {
+            int index = cy * m_grid_cols + cx;
+            Tile& tile = m_tiles[index];
+            tile.candidates.clear();
+            tile.max_response = 0.0f;
+
+            int x0 = (cx * width + m_grid_cols - 1) / m_grid_cols;
+            int x1 = ((cx + 1) * width + m_grid_cols - 1) / m_grid_cols;
+            int y0 = (cy * height + m_grid_rows - 1) / m_grid_rows;
+            int y1 = ((cy + 1) * height + m_grid_rows - 1) / m_grid_rows;
+            if (x1 <= x0 || y1 <= y0) continue;
+            if (m_use_cell_quota && m_cell_counts[index] >= quota) {
+                m_skipped_cells++;
+                continue;
+            }
+
+            tile.cell = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+            int ex0 = std::max(x0 - overlap, 0), ey0 = std::max(y0 - overlap, 0);
+            int ex1 = std::min(x1 + overlap, width), ey1 = std::min(y1 + overlap, height);
+            tile.expanded = cv::Rect(ex0, ey0, ex1 - ex0, ey1 - ey0);
+            // No two neighbouring pixels can both be maxima, so this bound
+            // keeps pass 2 from ever reallocating
+            tile.candidates.reserve(static_cast<size_t>((tile.cell.width + 1) / 2) * ((tile.cell.height + 1) / 2));
+            max_candidates += tile.candidates.capacity();
+            m_active_tiles.push_back(index);
+        }
+    }
+
+    if (m_active_tiles.empty()) {
+        VIO_LOG_DEBUG("Grid detector: all " << num_cells << " cells full");
+        return;
+    }
+
+    // Pass 1: min-eigenvalue response per tile
+    auto compute_response = [&](size_t i) {
+        VIO_PROFILE_SCOPE("corner_response");
+        Tile& tile = m_tiles[m_active_tiles[i]];
+        {
+            // Sobel and box-filter temporaries are OpenCV's own
+            ExternalAllocationScope external;
+            cv::cornerMinEigenVal(image(tile.expanded), tile.response, m_block_size, 3);
+        }
+
+        double tile_max = 0.0;
+        cv::Rect inner(tile.cell.x - tile.expanded.x, tile.cell.y - tile.expanded.y,
+                       tile.cell.width, tile.cell.height);
+        cv::minMaxLoc(tile.response(inner), nullptr, &tile_max);
+        tile.max_response = static_cast<float>(tile_max);
+    };
+    run_tiles(compute_response);
+
+    float max_response = 0.0f;
+    for (int index : m_active_tiles) {
+        max_response = std::max(max_response, m_tiles[index].max_response);
+    }
+    if (max_response <= 0.0f) {
+        VIO_LOG_DEBUG("Grid detector: no corner response");
+        return;
+    }
+
+    // Pass 2: local maxima above the quality threshold. On equal responses the
+    // earlier pixel in raster order wins, so plateaus yield one candidate.
+    const float threshold = static_cast<float>(m_quality_level * max_response);
+    auto collect_candidates = [&](size_t i) {
+        Tile& tile = m_tiles[m_active_tiles[i]];
+        const cv::Mat& response = tile.response;
+        for (int y = tile.cell.y; y < tile.cell.y + tile.cell.height; ++y) {
+            int ry = y - tile.expanded.y;
+            const float* row = response.ptr<float>(ry);
+            const float* row_above = ry > 0 ? response.ptr<float>(ry - 1) : nullptr;
+            const float* row_below = ry + 1 < response.rows ? response.ptr<float>(ry + 1) : nullptr;
+
+            for (int x = tile.cell.x; x < tile.cell.x + tile.cell.width; ++x) {
+                int rx = x - tile.expanded.x;
+                float r = row[rx];
+                if (r <= threshold) continue;
+
+                int left = std::max(rx - 1, 0);
+                int right = std::min(rx + 1, response.cols - 1);
+                bool is_max = !(rx > 0 && row[rx - 1] >= r) && !(rx + 1 < response.cols && row[rx + 1] > r);
+                for (int nx = left; is_max && nx <= right; ++nx) {
+                    if (row_above && row_above[nx] >= r) is_max = false;
+                    if (row_below && row_below[nx] > r) is_max = false;
+                }
+                if (is_max) {
+                    tile.candidates.push_back({r, x, y});
+                }
+            }
+        }
+    };
+    run_tiles(collect_candidates);
+
+    // Merge in tile order, then strongest first with position as tie-break:
+    // the result does not depend on the number of threads
+    m_candidates.clear();
+    m_candidates.reserve(max_candidates);
+    for (int index : m_active_tiles) {
+        const auto& tile_candidates = m_tiles[index].candidates;
+        m_candidates.insert(m_candidates.end(), tile_candidates.begin(), tile_candidates.end());
+    }
+    std::sort(m_candidates.begin(), m_candidates.end(), [](const Candidate& a, const Candidate& b) {
+        if (a.response != b.response) return a.response > b.response;
+        if (a.y != b.y) return a.y < b.y;
+        return a.x < b.x;
+    });
+
+    // Global min-distance suppression against existing and accepted corners
+    int added = 0;
+    for (const Candidate& candidate : m_candidates) {
+        if (added >= max_new) break;
+        int cell = cell_index(static_cast<float>(candidate.x), static_cast<float>(candidate.y));
+        if (m_use_cell_quota && m_cell_counts[cell] >= quota) continue;
+
+        cv::Point2f point(static_cast<float>(candidate.x), static_cast<float>(candidate.y));
+        if (!is_far_from_existing(point)) continue;
+
+        corners.push_back(point);
+        add_to_distance_grid(point);
+        m_cell_counts[cell]++;
+        added++;
+    }
+
+    VIO_LOG_DEBUG("Grid detector: " << added << " corners from " << m_candidates.size()
+                  << " candidates, skipped " << m_skipped_cells << "/" << num_cells << " full cells");
+}
+
+template<typename Fn>
+void GridFeatureDetector::run_tiles(const Fn& fn) {
+    if (m_thread_pool) {
+        m_thread_pool->parallel_for(m_active_tiles.size(), fn);
+    } else {
+        for (size_t i = 0; i < m_active_tiles.size(); ++i) {
+            fn(i);
+        }
+    }
+}
+
+} // namespace lightweight_vio
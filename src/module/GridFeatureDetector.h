@@ -0,0 +1,99 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+#include "../util/ThreadPool.h"
+
+namespace lightweight_vio {
+
+// Grid-bucketed Shi-Tomasi corner detector. The image is split into
+// cols x rows cells and each cell gets a quota of ceil(max_features / cells).
+// Cells already holding their quota of tracked features are skipped entirely;
+// for the rest the min-eigenvalue response is computed once per cell, local
+// maxima are collected and accepted strongest-first subject to the cell quota
+// and the minimum distance to every existing and accepted feature.
+//
+// Cells double as detection tiles: with a thread pool the per-tile response
+// and candidate passes run in parallel. Tiles overlap so border responses
+// match a full-image computation, and the final suppression is a single
+// global pass in a fixed order, so the output is identical for any number of
+// threads.
+class GridFeatureDetector {
+public:
+    GridFeatureDetector();
+
+    // Configuration
+    void set_grid_size(int cols, int rows);
+    int get_grid_cols() const { return m_grid_cols; }
+    int get_grid_rows() const { return m_grid_rows; }
+    void set_quality_level(double quality_level) { m_quality_level = quality_level; }
+    void set_min_distance(double min_distance) { m_min_distance = min_distance; }
+    void set_block_size(int block_size) { m_block_size = block_size; }
+    // Without the per-cell quota, cells are only tiles and detection behaves
+    // like a global goodFeaturesToTrack (strongest corners, min distance)
+    void set_cell_quota(bool enabled) { m_use_cell_quota = enabled; }
+    // Optional; not owned. nullptr runs the tiles on the calling thread.
+    void set_thread_pool(ThreadPool* thread_pool) { m_thread_pool = thread_pool; }
+
+    // Record the features already present (cell occupancy + min-distance exclusion)
+    void set_occupancy(const std::vector<cv::Point2f>& points, const std::vector<uchar>& valid,
+                       const cv::Size& image_size);
+
+    // Detect up to max_new corners so that the frame holds at most max_features.
+    // Corners are appended to `corners` strongest first.
+    void detect(const cv::Mat& image, int max_features, int max_new, std::vector<cv::Point2f>& corners);
+
+    // Cells skipped by the last detect() because they were already full
+    int get_skipped_cell_count() const { return m_skipped_cells; }
+
+private:
+    struct Candidate {
+        float response;
+        int x;
+        int y;
+    };
+
+    struct Tile {
+        cv::Rect cell;                      // Pixels owned by this tile
+        cv::Rect expanded;                  // cell plus the overlap, clipped to the image
+        cv::Mat response;                   // Response over `expanded`
+        float max_response = 0.0f;          // Max over `cell`
+        std::vector<Candidate> candidates;  // Local maxima inside `cell`
+    };
+
+    // Points a distance bin holds before it reallocates; detected points are
+    // min_distance apart, so only clusters of tracked features exceed it
+    static constexpr size_t DISTANCE_BIN_CAPACITY = 8;
+
+    int cell_index(float x, float y) const;
+    bool is_far_from_existing(const cv::Point2f& point) const;
+    void add_to_distance_grid(const cv::Point2f& point);
+    template<typename Fn>
+    void run_tiles(const Fn& fn);
+
+    // Parameters
+    int m_grid_cols;
+    int m_grid_rows;
+    double m_quality_level;
+    double m_min_distance;
+    int m_block_size;
+    bool m_use_cell_quota;
+    ThreadPool* m_thread_pool;
+
+    // Occupancy of the current image
+    cv::Size m_image_size;
+    std::vector<int> m_cell_counts;
+
+    // Coarse grid with min_distance-sized bins for the distance test
+    int m_distance_cols = 0;
+    int m_distance_rows = 0;
+    std::vector<std::vector<cv::Point2f>> m_distance_bins;
+
+    // Reused buffers
+    std::vector<Tile> m_tiles;
+    std::vector<int> m_active_tiles;
+    std::vector<Candidate> m_candidates;
+    int m_skipped_cells = 0;
+};
+
+} // namespace lightweight_vio
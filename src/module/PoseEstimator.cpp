@@ -0,0 +1,484 @@
+#include "PoseEstimator.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lightweight_vio {
+
+namespace {
+
+// Real roots of x^2 + b x + c (the one of larger magnitude first)
+bool solve_quadratic(double b, double c, double& r1, double& r2) {
+    const double discriminant = b * b - 4.0 * c;
+    if (discriminant < 0.0) return false;
+    const double root = std::sqrt(discriminant);
+    r1 = b < 0.0 ? 0.5 * (-b + root) : 0.5 * (-b - root);
+    r2 = r1 != 0.0 ? c / r1 : 0.0;
+    return true;
+}
+
+// One real root of x^3 + b x^2 + c x + d: Newton from a start past the
+// outermost stationary point, so it converges to the outermost root
+double solve_cubic(double b, double c, double d) {
+    double r;
+    if (b * b >= 3.0 * c) {
+        const double v = std::sqrt(b * b - 3.0 * c);
+        const double t1 = (-b - v) / 3.0;
+        const double k1 = ((t1 + b) * t1 + c) * t1 + d;
+        if (k1 > 0.0) {
+            r = t1 - std::sqrt(-k1 / (3.0 * t1 + b));
+        } else {
+            const double t2 = (-b + v) / 3.0;
+            const double k2 = ((t2 + b) * t2 + c) * t2 + d;
+            r = t2 + std::sqrt(-k2 / (3.0 * t2 + b));
+        }
+    } else {
+        r = -b / 3.0;
+        if (std::abs((3.0 * r + 2.0 * b) * r + c) < 1e-4) r += 1.0;
+    }
+    for (int i = 0; i < 50; ++i) {
+        const double f = ((r + b) * r + c) * r + d;
+        if (i >= 7 && std::abs(f) < 1e-13) break;
+        const double df = (3.0 * r + 2.0 * b) * r + c;
+        if (df == 0.0) break;
+        r -= f / df;
+    }
+    return r;
+}
+
+// Adjugate (transposed cofactors) of a 3x3 matrix
+Eigen::Matrix3d adjugate(const Eigen::Matrix3d& m) {
+    Eigen::Matrix3d adj;
+    adj.row(0) = m.col(1).cross(m.col(2)).transpose();
+    adj.row(1) = m.col(2).cross(m.col(0)).transpose();
+    adj.row(2) = m.col(0).cross(m.col(1)).transpose();
+    return adj;
+}
+
+// Newton steps on the three distance equations |l_i y_i - l_j y_j|^2 = a_ij
+void refine_lambdas(Eigen::Vector3d& l, double a12, double a13, double a23, double b12, double b13, double b23) {
+    auto residual = [&](const Eigen::Vector3d& v) {
+        return Eigen::Vector3d(v(0) * v(0) + v(1) * v(1) + b12 * v(0) * v(1) - a12,
+                               v(0) * v(0) + v(2) * v(2) + b13 * v(0) * v(2) - a13,
+                               v(1) * v(1) + v(2) * v(2) + b23 * v(1) * v(2) - a23);
+    };
+    Eigen::Vector3d r = residual(l);
+    for (int i = 0; i < 5; ++i) {
+        if (r.lpNorm<1>() < 1e-10) break;
+        Eigen::Matrix3d J;
+        J << 2.0 * l(0) + b12 * l(1), 2.0 * l(1) + b12 * l(0), 0.0,
+             2.0 * l(0) + b13 * l(2), 0.0, 2.0 * l(2) + b13 * l(0),
+             0.0, 2.0 * l(1) + b23 * l(2), 2.0 * l(2) + b23 * l(1);
+        const double det = J.determinant();
+        if (std::abs(det) < 1e-15) break;
+        const Eigen::Vector3d next = l - J.inverse() * r;
+        const Eigen::Vector3d next_r = residual(next);
+        if (next_r.lpNorm<1>() >= r.lpNorm<1>()) break;
+        l = next;
+        r = next_r;
+    }
+}
+
+// Lambda Twist P3P. y: unit bearings, x: world points. Writes up to four
+// world -> camera poses (y_i * l_i = R x_i + t); returns how many.
+int solve_p3p(const Eigen::Vector3d* y, const Eigen::Vector3d* x, Eigen::Matrix3d* rotations,
+              Eigen::Vector3d* translations) {
+    const double b12 = -2.0 * y[0].dot(y[1]);
+    const double b13 = -2.0 * y[0].dot(y[2]);
+    const double b23 = -2.0 * y[1].dot(y[2]);
+    const Eigen::Vector3d d12 = x[0] - x[1];
+    const Eigen::Vector3d d13 = x[0] - x[2];
+    const Eigen::Vector3d n = d12.cross(d13);
+    const double a12 = d12.squaredNorm();
+    const double a13 = d13.squaredNorm();
+    const double a23 = (x[1] - x[2]).squaredNorm();
+    if (n.squaredNorm() < 1e-12 * a12 * a13) {
+        return 0;  // Collinear points
+    }
+
+    // Homogeneous pair of the distance quadrics: D1 = a23 Q12 - a12 Q23, D2 = a23 Q13 - a13 Q23
+    Eigen::Matrix3d D1, D2;
+    D1 << a23, 0.5 * a23 * b12, 0.0,
+          0.5 * a23 * b12, a23 - a12, -0.5 * a12 * b23,
+          0.0, -0.5 * a12 * b23, -a12;
+    D2 << a23, 0.0, 0.5 * a23 * b13,
+          0.0, -a13, -0.5 * a13 * b23,
+          0.5 * a23 * b13, -0.5 * a13 * b23, a23 - a13;
+
+    // g with det(D1 - g D2) = 0 makes D0 = D1 - g D2 a degenerate conic (a line pair)
+    const Eigen::Matrix3d E = -D2;
+    const double p3 = E.determinant();
+    if (std::abs(p3) < 1e-15) return 0;
+    const double p2 = (adjugate(E) * D1).trace();
+    const double p1 = (adjugate(D1) * E).trace();
+    const double p0 = D1.determinant();
+    const double g = solve_cubic(p2 / p3, p1 / p3, p0 / p3);
+    const Eigen::Matrix3d D0 = D1 - g * D2;
+
+    // D0 = L0 v0 v0^T + L1 v1 v1^T (third eigenvalue 0), so lambda^T D0 lambda = 0
+    // splits into the planes (v0 -+ s v1) . lambda = 0 with s = sqrt(-L1 / L0)
+    Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> eigen;
+    eigen.computeDirect(D0);
+    const Eigen::Vector3d& values = eigen.eigenvalues();
+    int zero = 0;
+    for (int i = 1; i < 3; ++i) {
+        if (std::abs(values(i)) < std::abs(values(zero))) zero = i;
+    }
+    int i0 = (zero + 1) % 3, i1 = (zero + 2) % 3;
+    if (std::abs(values(i0)) < std::abs(values(i1))) std::swap(i0, i1);
+    if (values(i0) == 0.0) return 0;
+    const Eigen::Vector3d v0 = eigen.eigenvectors().col(i0);
+    const Eigen::Vector3d v1 = eigen.eigenvectors().col(i1);
+    const double s = std::sqrt(std::max(0.0, -values(i1) / values(i0)));
+
+    Eigen::Vector3d lambdas[4];
+    int count = 0;
+    for (const double sign : {1.0, -1.0}) {
+        // Plane: l1 = w0 l2 + w1 l3
+        const Eigen::Vector3d plane = v0 - sign * s * v1;
+        if (std::abs(plane(0)) < 1e-12) continue;
+        const double w0 = -plane(1) / plane(0);
+        const double w1 = -plane(2) / plane(0);
+
+        // a13 Q12 - a12 Q13 on the plane, as a quadratic in tau = l3 / l2
+        const double qa = (a13 - a12) * w1 * w1 - a12 * b13 * w1 - a12;
+        if (std::abs(qa) < 1e-15) continue;
+        const double qb = (2.0 * (a13 - a12) * w0 * w1 + a13 * b12 * w1 - a12 * b13 * w0) / qa;
+        const double qc = ((a13 - a12) * w0 * w0 + a13 * b12 * w0 + a13) / qa;
+        double taus[2];
+        if (!solve_quadratic(qb, qc, taus[0], taus[1])) continue;
+        for (const double tau : taus) {
+            if (tau <= 0.0) continue;
+            // Q23 fixes the scale
+            const double l2 = std::sqrt(a23 / (tau * (b23 + tau) + 1.0));
+            const double l3 = tau * l2;
+            const double l1 = w0 * l2 + w1 * l3;
+            if (l1 >= 0.0 && count < 4) {
+                lambdas[count++] = Eigen::Vector3d(l1, l2, l3);
+            }
+        }
+    }
+
+    // R maps the world triangle (d12, d13, normal) onto the camera one
+    Eigen::Matrix3d X;
+    X << d12, d13, n;
+    const Eigen::Matrix3d X_inv = X.inverse();
+    int solutions = 0;
+    for (int i = 0; i < count; ++i) {
+        Eigen::Vector3d& l = lambdas[i];
+        refine_lambdas(l, a12, a13, a23, b12, b13, b23);
+        const Eigen::Vector3d p1 = y[0] * l(0);
+        const Eigen::Vector3d e12 = p1 - y[1] * l(1);
+        const Eigen::Vector3d e13 = p1 - y[2] * l(2);
+        Eigen::Matrix3d Y;
+        Y << e12, e13, e12.cross(e13);
+        const Eigen::Matrix3d R = Eigen::Quaterniond(Y * X_inv).normalized().toRotationMatrix();
+        rotations[solutions] = R;
+        translations[solutions] = p1 - R * x[0];
+        solutions++;
+    }
+    return solutions;
+}
+
+// exp of a rotation vector (Rodrigues)
+Eigen::Matrix3d so3_exp(const Eigen::Vector3d& omega) {
+    const double angle = omega.norm();
+    if (angle < 1e-10) {
+        Eigen::Matrix3d R = Eigen::Matrix3d::Identity();
+        R(0, 1) = -omega(2); R(0, 2) = omega(1);
+        R(1, 0) = omega(2);  R(1, 2) = -omega(0);
+        R(2, 0) = -omega(1); R(2, 1) = omega(0);
+        return R;
+    }
+    return Eigen::AngleAxisd(angle, omega / angle).toRotationMatrix();
+}
+
+} // namespace
+
+PoseEstimator::PoseEstimator(const PoseEstimatorParams& params)
+    : m_params(params)
+    , m_focal_length(0.0)
+    , m_has_pose(false)
+    , m_pose_count(0)
+    , m_rng(20240613u)
+{
+}
+
+void PoseEstimator::reset() {
+    m_reference_ids.clear();
+    m_reference_points.clear();
+    m_has_pose = false;
+    m_pose_count = 0;
+    m_last_pose = Pose();
+    m_motion = Pose();
+}
+
+PoseEstimator::Result PoseEstimator::process(Frame& frame) {
+    Result result;
+    if (!m_has_pose) {
+        accept(frame, Pose());
+    } else {
+        result = estimate(frame);
+    }
+    if (frame.is_keyframe()) {
+        set_reference(frame);
+    }
+    return result;
+}
+
+int PoseEstimator::set_reference(const Frame& keyframe) {
+    const FeatureStore& store = keyframe.get_feature_store();
+    const std::vector<int>& ids = store.get_ids();
+    const std::vector<cv::Point2f>& normalized = store.get_normalized_coords();
+    const std::vector<float>& depths = store.get_depths();
+    const std::vector<uchar>& valid = store.get_valid_flags();
+
+    // Camera -> world with the keyframe's pose
+    const Eigen::Matrix3d R = keyframe.get_rotation().cast<double>();
+    const Eigen::Vector3d t = keyframe.get_translation().cast<double>();
+
+    int count = 0;
+    for (size_t i = 0; i < store.size(); ++i) {
+        count += valid[i] && depths[i] > 0.0f && depths[i] <= m_params.max_depth;
+    }
+    if (count < m_params.min_inliers) {
+        VIO_LOG_DEBUG("Keyframe " << keyframe.get_frame_id() << " has " << count
+                      << " points with depth; keeping the previous reference");
+        return count;
+    }
+
+    m_reference_ids.clear();
+    m_reference_points.clear();
+    for (size_t i = 0; i < store.size(); ++i) {
+        if (!valid[i] || depths[i] <= 0.0f || depths[i] > m_params.max_depth) continue;
+        const Eigen::Vector3d camera_point = depths[i] * Eigen::Vector3d(normalized[i].x, normalized[i].y, 1.0);
+        m_reference_ids.push_back(ids[i]);
+        m_reference_points.push_back(R * camera_point + t);
+    }
+
+    // Ids are normally ascending already (see Frame)
+    if (!std::is_sorted(m_reference_ids.begin(), m_reference_ids.end())) {
+        std::vector<std::pair<int, Eigen::Vector3d>> sorted(m_reference_ids.size());
+        for (size_t i = 0; i < sorted.size(); ++i) sorted[i] = {m_reference_ids[i], m_reference_points[i]};
+        std::sort(sorted.begin(), sorted.end(),
+                  [](const std::pair<int, Eigen::Vector3d>& a, const std::pair<int, Eigen::Vector3d>& b) {
+                      return a.first < b.first;
+                  });
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            m_reference_ids[i] = sorted[i].first;
+            m_reference_points[i] = sorted[i].second;
+        }
+    }
+    return count;
+}
+
+int PoseEstimator::gather_correspondences(const Frame& frame) {
+    const FeatureStore& store = frame.get_feature_store();
+    const std::vector<int>& ids = store.get_ids();
+    const std::vector<cv::Point2f>& normalized = store.get_normalized_coords();
+    const std::vector<uchar>& valid = store.get_valid_flags();
+    m_world_points.clear();
+    m_bearings.clear();
+    m_observations.clear();
+
+    // Merge over the two ascending id columns; out-of-order ids binary search
+    size_t k = 0;
+    int last_id = -1;
+    for (size_t i = 0; i < ids.size(); ++i) {
+        const int id = ids[i];
+        if (id < last_id) {
+            k = std::lower_bound(m_reference_ids.begin(), m_reference_ids.end(), id) - m_reference_ids.begin();
+        }
+        last_id = id;
+        while (k < m_reference_ids.size() && m_reference_ids[k] < id) {
+            k++;
+        }
+        if (k == m_reference_ids.size() || m_reference_ids[k] != id || !valid[i]) {
+            continue;
+        }
+        const Eigen::Vector2d observation(normalized[i].x, normalized[i].y);
+        m_world_points.push_back(m_reference_points[k]);
+        m_bearings.push_back(observation.homogeneous().normalized());
+        m_observations.push_back(observation);
+    }
+    return static_cast<int>(m_world_points.size());
+}
+
+int PoseEstimator::score(const Pose& pose, double threshold_sq, std::vector<uchar>* inlier_mask) const {
+    int inliers = 0;
+    for (size_t i = 0; i < m_world_points.size(); ++i) {
+        const Eigen::Vector3d p = pose.rotation * m_world_points[i] + pose.translation;
+        bool inlier = false;
+        if (p.z() > 1e-6) {
+            const double inv_z = 1.0 / p.z();
+            const double dx = p.x() * inv_z - m_observations[i].x();
+            const double dy = p.y() * inv_z - m_observations[i].y();
+            inlier = dx * dx + dy * dy < threshold_sq;
+        }
+        inliers += inlier;
+        if (inlier_mask) (*inlier_mask)[i] = inlier;
+    }
+    return inliers;
+}
+
+void PoseEstimator::refine(Pose& pose, const std::vector<uchar>& inlier_mask) const {
+    VIO_PROFILE_SCOPE("pose_refine");
+
+    // Left perturbation in the camera frame: p' = exp(phi) p + dt, with
+    // d(u, v)/d(phi, dt) = d(u, v)/dp * [-[p]x | I]
+    for (int iteration = 0; iteration < m_params.refine_iterations; ++iteration) {
+        Eigen::Matrix<double, 6, 6> H = Eigen::Matrix<double, 6, 6>::Zero();
+        Eigen::Matrix<double, 6, 1> b = Eigen::Matrix<double, 6, 1>::Zero();
+        for (size_t i = 0; i < m_world_points.size(); ++i) {
+            if (!inlier_mask[i]) continue;
+            const Eigen::Vector3d p = pose.rotation * m_world_points[i] + pose.translation;
+            if (p.z() <= 1e-6) continue;
+            const double inv_z = 1.0 / p.z();
+            const double u = p.x() * inv_z;
+            const double v = p.y() * inv_z;
+            const Eigen::Vector2d r(u - m_observations[i].x(), v - m_observations[i].y());
+
+            Eigen::Matrix<double, 2, 6> J;
+            J << -u * v, 1.0 + u * u, -v, inv_z, 0.0, -u * inv_z,
+                 -(1.0 + v * v), u * v, u, 0.0, inv_z, -v * inv_z;
+            H.noalias() += J.transpose() * J;
+            b.noalias() -= J.transpose() * r;
+        }
+
+        const Eigen::Matrix<double, 6, 1> delta = H.ldlt().solve(b);
+        if (!delta.allFinite()) break;
+        const Eigen::Matrix3d dR = so3_exp(delta.head<3>());
+        pose.rotation = dR * pose.rotation;
+        pose.translation = dR * pose.translation + delta.tail<3>();
+        if (delta.squaredNorm() < 1e-16) break;
+    }
+    // Re-orthonormalize after the first-order updates
+    pose.rotation = Eigen::Quaterniond(pose.rotation).normalized().toRotationMatrix();
+}
+
+PoseEstimator::Pose PoseEstimator::predict() const {
+    Pose predicted;
+    predicted.rotation = m_motion.rotation * m_last_pose.rotation;
+    predicted.translation = m_motion.rotation * m_last_pose.translation + m_motion.translation;
+    return predicted;
+}
+
+void PoseEstimator::accept(Frame& frame, const Pose& pose) {
+    if (m_has_pose) {
+        // Step from the last camera to this one: T_new * T_last^-1
+        m_motion.rotation = pose.rotation * m_last_pose.rotation.transpose();
+        m_motion.translation = pose.translation - m_motion.rotation * m_last_pose.translation;
+    }
+    m_last_pose = pose;
+    m_has_pose = true;
+    m_pose_count++;
+
+    // Frame pose is camera -> world
+    const Eigen::Matrix3d R_wc = pose.rotation.transpose();
+    frame.set_pose(R_wc.cast<float>(), (-R_wc * pose.translation).cast<float>());
+}
+
+int PoseEstimator::adaptive_iterations(int inliers, int count) const {
+    const double ratio = static_cast<double>(inliers) / std::max(count, 1);
+    const double all_inlier_sample = ratio * ratio * ratio;
+    if (all_inlier_sample >= 1.0) return 0;
+    if (all_inlier_sample <= 0.0) return m_params.max_iterations;
+    const double n = std::log(1.0 - m_params.confidence) / std::log(1.0 - all_inlier_sample);
+    return static_cast<int>(std::min<double>(std::ceil(n), m_params.max_iterations));
+}
+
+PoseEstimator::Result PoseEstimator::estimate(Frame& frame) {
+    VIO_PROFILE_SCOPE("estimate_pose");
+
+    Result result;
+    const Pose predicted = predict();
+    if (m_focal_length <= 0.0) {
+        VIO_LOG_ERROR("Pose estimation needs the focal length");
+        accept(frame, predicted);
+        return result;
+    }
+
+    const int count = gather_correspondences(frame);
+    result.correspondences = count;
+    if (count < std::max(m_params.min_inliers, 4)) {
+        VIO_LOG_WARN("Frame " << frame.get_frame_id() << ": " << count
+                     << " 2D-3D matches, using the predicted pose");
+        accept(frame, predicted);
+        return result;
+    }
+
+    const double threshold = m_params.threshold_px / m_focal_length;
+    const double threshold_sq = threshold * threshold;
+    m_inlier_mask.resize(count);
+    m_candidate_mask.resize(count);
+
+    // The prediction is a free hypothesis; with slow motion it is often the winner
+    Pose best = predicted;
+    int best_inliers = score(predicted, threshold_sq, nullptr);
+    int max_iterations = best_inliers > 0 ? adaptive_iterations(best_inliers, count) : m_params.max_iterations;
+
+    std::uniform_int_distribution<int> pick(0, count - 1);
+    Eigen::Matrix3d rotations[4];
+    Eigen::Vector3d translations[4];
+    int iteration = 0;
+    for (; iteration < max_iterations; ++iteration) {
+        int sample[3];
+        sample[0] = pick(m_rng);
+        do { sample[1] = pick(m_rng); } while (sample[1] == sample[0]);
+        do { sample[2] = pick(m_rng); } while (sample[2] == sample[0] || sample[2] == sample[1]);
+
+        const Eigen::Vector3d y[3] = {m_bearings[sample[0]], m_bearings[sample[1]], m_bearings[sample[2]]};
+        const Eigen::Vector3d x[3] = {m_world_points[sample[0]], m_world_points[sample[1]],
+                                      m_world_points[sample[2]]};
+        const int solutions = solve_p3p(y, x, rotations, translations);
+        for (int s = 0; s < solutions; ++s) {
+            Pose candidate;
+            candidate.rotation = rotations[s];
+            candidate.translation = translations[s];
+            const int inliers = score(candidate, threshold_sq, nullptr);
+            if (inliers > best_inliers) {
+                best_inliers = inliers;
+                best = candidate;
+                max_iterations = std::min(max_iterations, adaptive_iterations(inliers, count));
+            }
+        }
+    }
+    result.iterations = iteration;
+    VIO_PROFILE_COUNTER(PnpRansacIterations, iteration);
+
+    if (best_inliers < m_params.min_inliers) {
+        VIO_LOG_WARN("Frame " << frame.get_frame_id() << ": " << best_inliers << "/" << count
+                     << " pose inliers, using the predicted pose");
+        accept(frame, predicted);
+        return result;
+    }
+
+    // Refine on the inliers, re-select with the better pose, refine again
+    score(best, threshold_sq, &m_inlier_mask);
+    refine(best, m_inlier_mask);
+    result.inlier_count = score(best, threshold_sq, &m_inlier_mask);
+    refine(best, m_inlier_mask);
+    result.inlier_count = score(best, threshold_sq, &m_inlier_mask);
+
+    double error_sq = 0.0;
+    for (int i = 0; i < count; ++i) {
+        if (!m_inlier_mask[i]) continue;
+        const Eigen::Vector3d p = best.rotation * m_world_points[i] + best.translation;
+        error_sq += (p.hnormalized() - m_observations[i]).squaredNorm();
+    }
+    result.rms_error_px = result.inlier_count > 0
+                              ? std::sqrt(error_sq / result.inlier_count) * m_focal_length : 0.0;
+    result.success = result.inlier_count >= m_params.min_inliers;
+
+    if (!result.success) {
+        accept(frame, predicted);
+        return result;
+    }
+    accept(frame, best);
+    VIO_LOG_DEBUG("Frame " << frame.get_frame_id() << " pose: " << result.inlier_count << "/" << count
+                  << " inliers, " << result.iterations << " samples, rms " << result.rms_error_px << " px");
+    return result;
+}
+
+} // namespace lightweight_vio
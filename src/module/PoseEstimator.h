@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <random>
+#include <vector>
+#include "../database/Frame.h"
+
+namespace lightweight_vio {
+
+struct PoseEstimatorParams {
+    double threshold_px = 2.0;      // Reprojection error of an inlier
+    double confidence = 0.99;
+    int max_iterations = 200;       // Minimal samples drawn at most
+    int min_inliers = 15;           // Fewer and the frame keeps the predicted pose
+    int refine_iterations = 5;      // Gauss-Newton steps per refinement round
+    float max_depth = 40.0f;        // Reference points farther away are not used
+};
+
+// Camera pose of every frame from 2D-3D matches against the last keyframe.
+// The keyframe's features with stereo depth are back-projected into the world
+// with its pose; the frame's features are matched to them by id. P3P (Lambda
+// Twist, Persson & Nordberg 2018) inside RANSAC finds the inliers, with the
+// constant-velocity prediction scored first as a free hypothesis, and
+// Gauss-Newton on the inliers refines the pose.
+//
+// Poses are camera-to-world (Frame::set_pose); the world frame is the camera
+// of the first frame processed. Needs undistorted normalized coordinates, i.e.
+// a FeatureTracker with a camera model.
+class PoseEstimator {
+public:
+    struct Result {
+        bool success = false;
+        int correspondences = 0;      // Frame features with a reference point
+        int inlier_count = 0;
+        int iterations = 0;           // Minimal samples drawn
+        double rms_error_px = 0.0;    // Over the final inliers
+    };
+
+    explicit PoseEstimator(const PoseEstimatorParams& params = PoseEstimatorParams());
+
+    void set_params(const PoseEstimatorParams& params) { m_params = params; }
+    const PoseEstimatorParams& get_params() const { return m_params; }
+    // Converts the pixel threshold to normalized coordinates; required
+    void set_focal_length(double focal_length) { m_focal_length = focal_length; }
+
+    // Frames in order: estimate the frame's pose and set it, then make a
+    // keyframe (with its depths) the reference for the frames after it. The
+    // first frame gets the identity. On failure the frame gets the
+    // constant-velocity prediction.
+    Result process(Frame& frame);
+    // The two halves of process()
+    Result estimate(Frame& frame);
+    // Returns the number of reference points; with fewer than min_inliers the
+    // previous reference is kept
+    int set_reference(const Frame& keyframe);
+
+    // Forget the reference, the motion model and the world frame
+    void reset();
+    bool has_reference() const { return !m_reference_ids.empty(); }
+
+private:
+    // World -> camera
+    struct Pose {
+        Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+        Eigen::Vector3d translation = Eigen::Vector3d::Zero();
+    };
+
+    int gather_correspondences(const Frame& frame);
+    int score(const Pose& pose, double threshold_sq, std::vector<uchar>* inlier_mask) const;
+    void refine(Pose& pose, const std::vector<uchar>& inlier_mask) const;
+    Pose predict() const;
+    void accept(Frame& frame, const Pose& pose);
+    int adaptive_iterations(int inliers, int count) const;
+
+    PoseEstimatorParams m_params;
+    double m_focal_length;
+
+    // Reference keyframe: world points sorted by feature id
+    std::vector<int> m_reference_ids;
+    std::vector<Eigen::Vector3d> m_reference_points;
+
+    // Motion model (last two accepted poses)
+    bool m_has_pose;
+    int m_pose_count;
+    Pose m_last_pose;
+    Pose m_motion;  // Last camera-to-camera step
+
+    std::mt19937 m_rng;
+
+    // Correspondences of the current frame (reused buffers)
+    std::vector<Eigen::Vector3d> m_world_points;
+    std::vector<Eigen::Vector3d> m_bearings;   // Unit rays
+    std::vector<Eigen::Vector2d> m_observations;  // Normalized coordinates
+    std::vector<uchar> m_inlier_mask;
+    std::vector<uchar> m_candidate_mask;
+};
+
+} // namespace lightweight_vio
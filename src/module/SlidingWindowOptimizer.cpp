@@ -0,0 +1,587 @@
+#include "SlidingWindowOptimizer.h"
+#include "../util/Logger.h"
+#include "../util/Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lightweight_vio {
+
+namespace {
+
+constexpr double kMinDepth = 1e-3;
+
+// exp of a rotation vector (Rodrigues)
+Eigen::Matrix3d so3_exp(const Eigen::Vector3d& omega) {
+    const double angle = omega.norm();
+    if (angle < 1e-12) {
+        return Eigen::Matrix3d::Identity();
+    }
+    return Eigen::AngleAxisd(angle, omega / angle).toRotationMatrix();
+}
+
+Eigen::Vector3d so3_log(const Eigen::Matrix3d& rotation) {
+    const Eigen::AngleAxisd angle_axis(rotation);
+    return angle_axis.angle() * angle_axis.axis();
+}
+
+// d(x/z, y/z)/dp
+Eigen::Matrix<double, 2, 3> projection_jacobian(const Eigen::Vector3d& p) {
+    const double inv_z = 1.0 / p.z();
+    Eigen::Matrix<double, 2, 3> J;
+    J << inv_z, 0.0, -p.x() * inv_z * inv_z,
+         0.0, inv_z, -p.y() * inv_z * inv_z;
+    return J;
+}
+
+// Left perturbation in the camera frame, p' = exp(phi) p + dt:
+// dp'/d(phi, dt) = [-[p]x | I]
+Eigen::Matrix<double, 3, 6> perturbation_jacobian(const Eigen::Vector3d& p) {
+    Eigen::Matrix<double, 3, 6> J;
+    J << 0.0, p.z(), -p.y(), 1.0, 0.0, 0.0,
+         -p.z(), 0.0, p.x(), 0.0, 1.0, 0.0,
+         p.y(), -p.x(), 0.0, 0.0, 0.0, 1.0;
+    return J;
+}
+
+// Huber on one image's residual: IRLS weight, and twice the cost
+double huber_weight(double error, double threshold) {
+    return error <= threshold ? 1.0 : threshold / error;
+}
+
+double huber_cost(double error_sq, double threshold) {
+    if (error_sq <= threshold * threshold) {
+        return error_sq;
+    }
+    return 2.0 * threshold * std::sqrt(error_sq) - threshold * threshold;
+}
+
+// Left-image rows by the first weight, right-image rows by the second
+template<int Cols>
+Eigen::Matrix<double, 4, Cols> weight_rows(const Eigen::Matrix<double, 4, Cols>& m, const Eigen::Vector2d& weight) {
+    Eigen::Matrix<double, 4, Cols> weighted = m;
+    weighted.template topRows<2>() *= weight[0];
+    weighted.template bottomRows<2>() *= weight[1];
+    return weighted;
+}
+
+double elapsed_ms(uint64_t start_ns) {
+    return static_cast<double>(Profiler::now_ns() - start_ns) * 1e-6;
+}
+
+} // namespace
+
+SlidingWindowOptimizer::SlidingWindowOptimizer(const StereoCamera& stereo, const WindowOptimizerParams& params)
+    : m_stereo(stereo)
+    , m_params(params)
+    , m_focal_length(stereo.left.is_valid() ? stereo.left.get_focal_length() : 1.0)
+{
+    if (m_params.window_size < 2) {
+        VIO_LOG_WARN("Sliding-window optimization needs at least two keyframes; using 2");
+        m_params.window_size = 2;
+    }
+    if (m_params.use_stereo && !m_stereo.is_valid()) {
+        VIO_LOG_WARN("No stereo extrinsics; optimizing left-image residuals only");
+        m_params.use_stereo = false;
+    }
+}
+
+void SlidingWindowOptimizer::reset() {
+    m_keyframes.clear();
+    m_window_index.clear();
+    m_landmarks.clear();
+    m_consumed_until.clear();
+    m_prior_ids.clear();
+    m_prior_poses.clear();
+    m_prior_H.resize(0, 0);
+    m_prior_g.resize(0);
+}
+
+Eigen::Matrix4d SlidingWindowOptimizer::get_keyframe_pose(size_t index) const {
+    const Pose& pose = m_keyframes[index].pose;
+    Eigen::Matrix4d T_wc = Eigen::Matrix4d::Identity();
+    T_wc.topLeftCorner<3, 3>() = pose.rotation.transpose();
+    T_wc.topRightCorner<3, 1>() = -pose.rotation.transpose() * pose.translation;
+    return T_wc;
+}
+
+SlidingWindowOptimizer::Result SlidingWindowOptimizer::optimize(const SlidingWindowMap& map) {
+    VIO_PROFILE_SCOPE("window_optimize");
+    const uint64_t start_ns = Profiler::now_ns();
+    Result result;
+
+    result.marginalized = sync_keyframes(map);
+    if (m_keyframes.size() < 2) {
+        result.solve_ms = elapsed_ms(start_ns);
+        return result;
+    }
+
+    collect(map);
+    result.landmarks = static_cast<int>(m_blocks.size());
+    result.observations = static_cast<int>(m_observations.size());
+    if (m_blocks.empty()) {
+        result.solve_ms = elapsed_ms(start_ns);
+        return result;
+    }
+
+    double cost = linearize();
+    result.initial_cost = cost;
+    double lambda = m_params.initial_lambda;
+    for (int iteration = 0; iteration < m_params.max_iterations; ++iteration) {
+        if (elapsed_ms(start_ns) >= m_params.max_solve_ms) {
+            break;
+        }
+        current_poses(m_candidate_poses);
+        m_candidate_points.resize(m_blocks.size());
+        for (size_t i = 0; i < m_blocks.size(); ++i) {
+            m_candidate_points[i] = m_blocks[i].position;
+        }
+        result.iterations++;
+        if (!solve(lambda, m_candidate_poses, m_candidate_points)) {
+            lambda *= 10.0;
+            continue;
+        }
+
+        const double candidate_cost = evaluate(m_candidate_poses, m_candidate_points);
+        if (candidate_cost >= cost) {
+            lambda *= 10.0;
+            continue;
+        }
+        for (size_t i = 0; i < m_keyframes.size(); ++i) {
+            m_keyframes[i].pose = m_candidate_poses[i];
+        }
+        for (size_t i = 0; i < m_blocks.size(); ++i) {
+            m_blocks[i].position = m_candidate_points[i];
+        }
+        lambda = std::max(lambda * 0.1, 1e-8);
+        const bool converged = cost - candidate_cost < 1e-6 * cost;
+        cost = candidate_cost;
+        if (converged || iteration + 1 == m_params.max_iterations) {
+            break;
+        }
+        cost = linearize();
+    }
+
+    for (KeyframeState& keyframe : m_keyframes) {
+        // Re-orthonormalize after the first-order updates
+        keyframe.pose.rotation = Eigen::Quaterniond(keyframe.pose.rotation).normalized().toRotationMatrix();
+    }
+    for (const LandmarkBlock& block : m_blocks) {
+        m_landmarks[block.feature_id] = block.position;
+    }
+
+    result.optimized = true;
+    result.final_cost = cost;
+    result.solve_ms = elapsed_ms(start_ns);
+    return result;
+}
+
+int SlidingWindowOptimizer::sync_keyframes(const SlidingWindowMap& map) {
+    // Keyframes the map dropped before they could be marginalized (map window
+    // too small) take the prior with them
+    if (!m_keyframes.empty() && (map.empty() || m_keyframes.front().frame_id < map.get_keyframe_at(0).frame_id)) {
+        VIO_LOG_WARN("Map window smaller than the optimization window; restarting the optimizer");
+        reset();
+    }
+
+    const int newest = m_keyframes.empty() ? -1 : m_keyframes.back().frame_id;
+    size_t first_new = map.size();
+    while (first_new > 0 && map.get_keyframe_at(first_new - 1).frame_id > newest) {
+        first_new--;
+    }
+    const size_t window = static_cast<size_t>(m_params.window_size);
+    const size_t new_count = std::min(map.size() - first_new, window);
+    if (new_count == 0) {
+        return 0;
+    }
+
+    // Marginalize before adding, so the factors folded into the prior are
+    // linearized at optimized poses
+    int marginalized = 0;
+    while (!m_keyframes.empty() && m_keyframes.size() + new_count > window) {
+        collect(map);
+        linearize();
+        marginalize_oldest();
+        marginalized++;
+    }
+
+    for (size_t i = map.size() - new_count; i < map.size(); ++i) {
+        const MapKeyframe& keyframe = map.get_keyframe_at(i);
+        KeyframeState state;
+        state.frame_id = keyframe.frame_id;
+        state.timestamp = keyframe.timestamp;
+        const Eigen::Matrix3d R_wc = keyframe.rotation.cast<double>();
+        state.pose.rotation = R_wc.transpose();
+        state.pose.translation = -R_wc.transpose() * keyframe.translation.cast<double>();
+        m_keyframes.push_back(state);
+    }
+    index_window();
+    return marginalized;
+}
+
+void SlidingWindowOptimizer::index_window() {
+    m_window_index.clear();
+    for (size_t i = 0; i < m_keyframes.size(); ++i) {
+        m_window_index[m_keyframes[i].frame_id] = static_cast<int>(i);
+    }
+}
+
+void SlidingWindowOptimizer::current_poses(std::vector<Pose>& poses) const {
+    poses.resize(m_keyframes.size());
+    for (size_t i = 0; i < m_keyframes.size(); ++i) {
+        poses[i] = m_keyframes[i].pose;
+    }
+}
+
+void SlidingWindowOptimizer::collect(const SlidingWindowMap& map) {
+    VIO_PROFILE_SCOPE("window_collect");
+    m_blocks.clear();
+    m_observations.clear();
+
+    const TrackStore& tracks = map.get_tracks();
+    tracks.get_feature_ids(m_feature_ids);
+    std::sort(m_feature_ids.begin(), m_feature_ids.end());
+
+    for (int feature_id : m_feature_ids) {
+        const TrackView track = tracks.get_track(feature_id);
+        auto consumed = m_consumed_until.find(feature_id);
+        const int after = consumed != m_consumed_until.end() ? consumed->second : -1;
+
+        LandmarkBlock block;
+        block.feature_id = feature_id;
+        block.first = m_observations.size();
+        block.count = 0;
+        block.H_ll.setZero();
+        block.g_l.setZero();
+        int anchor = -1;  // First observation with depth
+        for (size_t i = 0; i < track.size; ++i) {
+            if (track.frame_ids[i] <= after) continue;
+            auto window = m_window_index.find(track.frame_ids[i]);
+            if (window == m_window_index.end()) continue;
+
+            m_observations.emplace_back();
+            ObservationBlock& obs = m_observations.back();
+            obs.pose = window->second;
+            obs.left = Eigen::Vector2d(track.normalized_coords[i].x, track.normalized_coords[i].y);
+            const double depth = track.depths[i];
+            obs.stereo = false;
+            if (m_params.use_stereo && depth > kMinDepth) {
+                // The right-image observation implied by the stereo depth
+                const Eigen::Vector3d p_right =
+                    m_stereo.right_R_left * (depth * obs.left.homogeneous()) + m_stereo.right_t_left;
+                obs.stereo = p_right.z() > kMinDepth;
+                obs.right = p_right.hnormalized();
+            }
+            if (anchor < 0 && depth > kMinDepth) {
+                anchor = static_cast<int>(i);
+            }
+            block.count++;
+        }
+
+        // A point seen from one keyframe does not constrain any pose
+        auto landmark = m_landmarks.find(feature_id);
+        if (block.count < 2 || (landmark == m_landmarks.end() && anchor < 0)) {
+            m_observations.resize(block.first);
+            if (landmark != m_landmarks.end()) {
+                m_landmarks.erase(landmark);
+            }
+            continue;
+        }
+        if (landmark != m_landmarks.end()) {
+            block.position = landmark->second;
+        } else {
+            const Pose& pose = m_keyframes[m_window_index[track.frame_ids[anchor]]].pose;
+            const Eigen::Vector3d p_camera = track.depths[anchor] *
+                Eigen::Vector3d(track.normalized_coords[anchor].x, track.normalized_coords[anchor].y, 1.0);
+            block.position = pose.rotation.transpose() * (p_camera - pose.translation);
+            m_landmarks.emplace(feature_id, block.position);
+        }
+        m_blocks.push_back(block);
+    }
+
+    // Consumed observations that left the map need no bookkeeping
+    for (auto it = m_consumed_until.begin(); it != m_consumed_until.end();) {
+        const TrackView track = tracks.get_track(it->first);
+        if (track.size == 0 || track.frame_ids[0] > it->second) {
+            it = m_consumed_until.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SlidingWindowOptimizer::linearize_observation(ObservationBlock& obs, const Pose& pose,
+                                                   const Eigen::Vector3d& point) const {
+    obs.residual.setZero();
+    obs.J_pose.setZero();
+    obs.J_point.setZero();
+    obs.weight.setZero();
+    obs.H_pl.setZero();
+
+    const Eigen::Vector3d p = pose.rotation * point + pose.translation;
+    if (p.z() <= kMinDepth) {
+        return;
+    }
+    // Residuals in pixels, so the Huber width is too
+    const Eigen::Matrix<double, 2, 3> J_left = m_focal_length * projection_jacobian(p);
+    const Eigen::Matrix<double, 3, 6> J_perturb = perturbation_jacobian(p);
+    obs.residual.head<2>() = m_focal_length * (p.hnormalized() - obs.left);
+    obs.J_pose.topRows<2>().noalias() = J_left * J_perturb;
+    obs.J_point.topRows<2>().noalias() = J_left * pose.rotation;
+    obs.weight[0] = huber_weight(obs.residual.head<2>().norm(), m_params.huber_px);
+
+    if (obs.stereo) {
+        const Eigen::Vector3d p_right = m_stereo.right_R_left * p + m_stereo.right_t_left;
+        if (p_right.z() > kMinDepth) {
+            const Eigen::Matrix<double, 2, 3> J_right =
+                m_focal_length * projection_jacobian(p_right) * m_stereo.right_R_left;
+            obs.residual.tail<2>() = m_focal_length * (p_right.hnormalized() - obs.right);
+            obs.J_pose.bottomRows<2>().noalias() = J_right * J_perturb;
+            obs.J_point.bottomRows<2>().noalias() = J_right * pose.rotation;
+            obs.weight[1] = huber_weight(obs.residual.tail<2>().norm(), m_params.huber_px);
+        }
+    }
+
+    obs.H_pl.noalias() = obs.J_pose.transpose() * weight_rows(obs.J_point, obs.weight);
+}
+
+double SlidingWindowOptimizer::observation_cost(const ObservationBlock& obs, const Pose& pose,
+                                                const Eigen::Vector3d& point) const {
+    const Eigen::Vector3d p = pose.rotation * point + pose.translation;
+    if (p.z() <= kMinDepth) {
+        return 0.0;
+    }
+    double cost = huber_cost((m_focal_length * (p.hnormalized() - obs.left)).squaredNorm(), m_params.huber_px);
+    if (obs.stereo) {
+        const Eigen::Vector3d p_right = m_stereo.right_R_left * p + m_stereo.right_t_left;
+        if (p_right.z() > kMinDepth) {
+            cost += huber_cost((m_focal_length * (p_right.hnormalized() - obs.right)).squaredNorm(),
+                               m_params.huber_px);
+        }
+    }
+    return 0.5 * cost;
+}
+
+double SlidingWindowOptimizer::linearize() {
+    VIO_PROFILE_SCOPE("window_linearize");
+    const int pose_dim = 6 * static_cast<int>(m_keyframes.size());
+    m_H_pp.setZero(pose_dim, pose_dim);
+    m_g_p.setZero(pose_dim);
+
+    double cost = 0.0;
+    for (LandmarkBlock& block : m_blocks) {
+        block.H_ll.setZero();
+        block.g_l.setZero();
+        for (size_t k = block.first; k < block.first + block.count; ++k) {
+            ObservationBlock& obs = m_observations[k];
+            linearize_observation(obs, m_keyframes[obs.pose].pose, block.position);
+            cost += 0.5 * (huber_cost(obs.residual.head<2>().squaredNorm(), m_params.huber_px) +
+                           huber_cost(obs.residual.tail<2>().squaredNorm(), m_params.huber_px));
+
+            const Eigen::Matrix<double, 4, 1> Wr = weight_rows(obs.residual, obs.weight);
+            const int row = 6 * obs.pose;
+            m_H_pp.block<6, 6>(row, row).noalias() += obs.J_pose.transpose() * weight_rows(obs.J_pose, obs.weight);
+            m_g_p.segment<6>(row).noalias() += obs.J_pose.transpose() * Wr;
+            block.H_ll.noalias() += obs.J_point.transpose() * weight_rows(obs.J_point, obs.weight);
+            block.g_l.noalias() += obs.J_point.transpose() * Wr;
+        }
+    }
+
+    current_poses(m_candidate_poses);
+    return cost + prior_cost(m_candidate_poses);
+}
+
+double SlidingWindowOptimizer::evaluate(const std::vector<Pose>& poses,
+                                        const std::vector<Eigen::Vector3d>& points) const {
+    double cost = 0.0;
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        const LandmarkBlock& block = m_blocks[i];
+        for (size_t k = block.first; k < block.first + block.count; ++k) {
+            const ObservationBlock& obs = m_observations[k];
+            cost += observation_cost(obs, poses[obs.pose], points[i]);
+        }
+    }
+    return cost + prior_cost(poses);
+}
+
+void SlidingWindowOptimizer::prior_delta(const std::vector<Pose>& poses, Eigen::VectorXd& delta) const {
+    // dx such that pose = exp(dx) * linearization pose, first order in t
+    delta.resize(6 * m_prior_ids.size());
+    for (size_t a = 0; a < m_prior_ids.size(); ++a) {
+        const Pose& pose = poses[m_window_index.at(m_prior_ids[a])];
+        const Pose& origin = m_prior_poses[a];
+        const Eigen::Matrix3d dR = pose.rotation * origin.rotation.transpose();
+        delta.segment<3>(6 * a) = so3_log(dR);
+        delta.segment<3>(6 * a + 3) = pose.translation - dR * origin.translation;
+    }
+}
+
+double SlidingWindowOptimizer::prior_cost(const std::vector<Pose>& poses) const {
+    if (m_prior_ids.empty()) {
+        return 0.0;
+    }
+    Eigen::VectorXd delta;
+    prior_delta(poses, delta);
+    return m_prior_g.dot(delta) + 0.5 * delta.dot(m_prior_H * delta);
+}
+
+bool SlidingWindowOptimizer::solve(double lambda, std::vector<Pose>& poses, std::vector<Eigen::Vector3d>& points) {
+    VIO_PROFILE_SCOPE("window_solve");
+
+    // Reduced camera system over the free poses (the oldest fixes the gauge):
+    // S = H_pp - sum_l H_pl H_ll^-1 H_lp, b = -g_p + sum_l H_pl H_ll^-1 g_l
+    const int free_count = static_cast<int>(m_keyframes.size()) - 1;
+    const int n = 6 * free_count;
+    m_reduced = m_H_pp.bottomRightCorner(n, n);
+    m_reduced_b = -m_g_p.tail(n);
+
+    if (!m_prior_ids.empty()) {
+        Eigen::VectorXd delta;
+        prior_delta(poses, delta);
+        const Eigen::VectorXd gradient = m_prior_g + m_prior_H * delta;
+        for (size_t a = 0; a < m_prior_ids.size(); ++a) {
+            const int row = m_window_index.at(m_prior_ids[a]) - 1;
+            if (row < 0) continue;
+            m_reduced_b.segment<6>(6 * row) -= gradient.segment<6>(6 * a);
+            for (size_t b = 0; b < m_prior_ids.size(); ++b) {
+                const int col = m_window_index.at(m_prior_ids[b]) - 1;
+                if (col < 0) continue;
+                m_reduced.block<6, 6>(6 * row, 6 * col) += m_prior_H.block<6, 6>(6 * a, 6 * b);
+            }
+        }
+    }
+    // Marquardt damping, before the points are eliminated
+    m_reduced.diagonal().array() += lambda * (m_reduced.diagonal().array().max(1e-6));
+
+    m_point_inverses.resize(m_blocks.size());
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        const LandmarkBlock& block = m_blocks[i];
+        Eigen::Matrix3d H_ll = block.H_ll;
+        H_ll.diagonal().array() += lambda * H_ll.diagonal().array().max(1e-6);
+        Eigen::Matrix3d& H_ll_inv = m_point_inverses[i];
+        H_ll_inv = H_ll.inverse();
+        if (!H_ll_inv.allFinite()) {
+            return false;
+        }
+
+        const Eigen::Vector3d b_l = -block.g_l;
+        for (size_t k = block.first; k < block.first + block.count; ++k) {
+            const ObservationBlock& obs_k = m_observations[k];
+            if (obs_k.pose == 0) continue;
+            const int row = 6 * (obs_k.pose - 1);
+            const Eigen::Matrix<double, 6, 3> Q = obs_k.H_pl * H_ll_inv;
+            m_reduced_b.segment<6>(row).noalias() -= Q * b_l;
+            // Observations are in keyframe order: fill the upper block and mirror it
+            for (size_t j = k; j < block.first + block.count; ++j) {
+                const int col = 6 * (m_observations[j].pose - 1);
+                const Eigen::Matrix<double, 6, 6> S = Q * m_observations[j].H_pl.transpose();
+                m_reduced.block<6, 6>(row, col) -= S;
+                if (j != k) {
+                    m_reduced.block<6, 6>(col, row) -= S.transpose();
+                }
+            }
+        }
+    }
+
+    const Eigen::VectorXd pose_step = m_reduced.ldlt().solve(m_reduced_b);
+    if (!pose_step.allFinite()) {
+        return false;
+    }
+
+    for (int i = 0; i < free_count; ++i) {
+        Pose& pose = poses[i + 1];
+        const Eigen::Matrix3d dR = so3_exp(pose_step.segment<3>(6 * i));
+        pose.rotation = dR * pose.rotation;
+        pose.translation = dR * pose.translation + pose_step.segment<3>(6 * i + 3);
+    }
+    // Back-substitution: dl = H_ll^-1 (b_l - H_lp dp)
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        const LandmarkBlock& block = m_blocks[i];
+        Eigen::Vector3d b_l = -block.g_l;
+        for (size_t k = block.first; k < block.first + block.count; ++k) {
+            const ObservationBlock& obs = m_observations[k];
+            if (obs.pose == 0) continue;
+            b_l.noalias() -= obs.H_pl.transpose() * pose_step.segment<6>(6 * (obs.pose - 1));
+        }
+        points[i] += m_point_inverses[i] * b_l;
+    }
+    return true;
+}
+
+void SlidingWindowOptimizer::marginalize_oldest() {
+    VIO_PROFILE_SCOPE("window_marginalize");
+
+    // The oldest pose is fixed, so marginalizing it conditions on it: the
+    // prior keeps the rows of the other poses, and the points that leave the
+    // window with it are eliminated from their factors into it
+    const int n = 6 * (static_cast<int>(m_keyframes.size()) - 1);
+    Eigen::MatrixXd H = Eigen::MatrixXd::Zero(n, n);
+    Eigen::VectorXd g = Eigen::VectorXd::Zero(n);
+
+    if (!m_prior_ids.empty()) {
+        current_poses(m_candidate_poses);
+        Eigen::VectorXd delta;
+        prior_delta(m_candidate_poses, delta);
+        const Eigen::VectorXd gradient = m_prior_g + m_prior_H * delta;
+        for (size_t a = 0; a < m_prior_ids.size(); ++a) {
+            const int row = m_window_index.at(m_prior_ids[a]) - 1;
+            if (row < 0) continue;
+            g.segment<6>(6 * row) += gradient.segment<6>(6 * a);
+            for (size_t b = 0; b < m_prior_ids.size(); ++b) {
+                const int col = m_window_index.at(m_prior_ids[b]) - 1;
+                if (col < 0) continue;
+                H.block<6, 6>(6 * row, 6 * col) += m_prior_H.block<6, 6>(6 * a, 6 * b);
+            }
+        }
+    }
+
+    const int oldest = m_keyframes.front().frame_id;
+    const int newest = m_keyframes.back().frame_id;
+    for (const LandmarkBlock& block : m_blocks) {
+        if (m_observations[block.first].pose != 0) continue;
+
+        // Still seen from two keyframes: only the oldest observation goes
+        // (dropped, as in OKVIS), so points never enter the prior
+        if (block.count > 2) {
+            m_consumed_until[block.feature_id] = oldest;
+            continue;
+        }
+        m_consumed_until[block.feature_id] = newest;
+        m_landmarks.erase(block.feature_id);
+
+        Eigen::Matrix3d H_ll_inv;
+        bool invertible = false;
+        double determinant;
+        block.H_ll.computeInverseAndDetWithCheck(H_ll_inv, determinant, invertible, 1e-12);
+        if (!invertible) continue;
+
+        for (size_t k = block.first; k < block.first + block.count; ++k) {
+            const ObservationBlock& obs_k = m_observations[k];
+            if (obs_k.pose == 0) continue;
+            const int row = 6 * (obs_k.pose - 1);
+            H.block<6, 6>(row, row).noalias() += obs_k.J_pose.transpose() * weight_rows(obs_k.J_pose, obs_k.weight);
+            g.segment<6>(row).noalias() += obs_k.J_pose.transpose() * weight_rows(obs_k.residual, obs_k.weight);
+
+            const Eigen::Matrix<double, 6, 3> Q = obs_k.H_pl * H_ll_inv;
+            g.segment<6>(row).noalias() -= Q * block.g_l;
+            for (size_t j = block.first; j < block.first + block.count; ++j) {
+                if (m_observations[j].pose == 0) continue;
+                const int col = 6 * (m_observations[j].pose - 1);
+                H.block<6, 6>(row, col).noalias() -= Q * m_observations[j].H_pl.transpose();
+            }
+        }
+    }
+
+    m_prior_H = 0.5 * (H + H.transpose());
+    m_prior_g = g;
+    m_prior_ids.clear();
+    m_prior_poses.clear();
+    for (size_t i = 1; i < m_keyframes.size(); ++i) {
+        m_prior_ids.push_back(m_keyframes[i].frame_id);
+        m_prior_poses.push_back(m_keyframes[i].pose);
+    }
+
+    m_keyframes.erase(m_keyframes.begin());
+    index_window();
+}
+
+} // namespace lightweight_vio
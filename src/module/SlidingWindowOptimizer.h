@@ -0,0 +1,149 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <unordered_map>
+#include <vector>
+#include "../database/SlidingWindowMap.h"
+#include "../util/CameraModel.h"
+
+namespace lightweight_vio {
+
+struct WindowOptimizerParams {
+    int window_size = 10;         // Keyframes optimized; the map must hold at least one more
+    int max_iterations = 5;       // Levenberg-Marquardt iterations per keyframe
+    double max_solve_ms = 15.0;   // No new iteration starts past this
+    double huber_px = 2.0;        // Robust kernel width
+    bool use_stereo = true;       // Residual on the right image too (from the observation's depth)
+    double initial_lambda = 1e-4;
+};
+
+// Fixed-lag bundle adjustment over the last window_size keyframes of a
+// SlidingWindowMap: keyframe poses and the world points of features seen in
+// at least two of them, minimizing left-image (and, for observations with
+// stereo depth, right-image) reprojection error under a Huber kernel.
+//
+// Levenberg-Marquardt with a hand-written Schur complement: observations are
+// laid out landmark by landmark, each with its fixed-size 4x6 pose and 4x3
+// point Jacobian blocks; the 3x3 point blocks are eliminated into a dense
+// reduced camera system (6 per free pose) solved by LDLT, and points follow by
+// back-substitution. The oldest keyframe in the window fixes the gauge.
+//
+// When a keyframe leaves the window it is marginalized while the map still
+// holds its observations: points it observed that fewer than two remaining
+// keyframes see are eliminated from their factors (and the previous prior)
+// into a linear prior on the remaining poses; points that stay only lose the
+// oldest observation. Either way the observations are consumed and never
+// used again, so information is not counted twice.
+//
+// Poses are camera-to-world like Frame's. Not thread-safe.
+class SlidingWindowOptimizer {
+public:
+    struct Result {
+        bool optimized = false;
+        int iterations = 0;
+        int landmarks = 0;
+        int observations = 0;
+        int marginalized = 0;       // Keyframes marginalized in this call
+        double initial_cost = 0.0;  // Half the robust squared error (px^2), prior included
+        double final_cost = 0.0;
+        double solve_ms = 0.0;
+    };
+
+    SlidingWindowOptimizer(const StereoCamera& stereo, const WindowOptimizerParams& params = WindowOptimizerParams());
+
+    const WindowOptimizerParams& get_params() const { return m_params; }
+
+    // After each SlidingWindowMap::insert_keyframe: takes in the new
+    // keyframes (at their frontend poses), marginalizes those that leave the
+    // window, then optimizes
+    Result optimize(const SlidingWindowMap& map);
+    void reset();
+
+    // Keyframes in the window, oldest first
+    size_t get_keyframe_count() const { return m_keyframes.size(); }
+    int get_keyframe_id(size_t index) const { return m_keyframes[index].frame_id; }
+    long long get_keyframe_timestamp(size_t index) const { return m_keyframes[index].timestamp; }
+    Eigen::Matrix4d get_keyframe_pose(size_t index) const;  // Camera to world
+    size_t get_landmark_count() const { return m_landmarks.size(); }
+
+private:
+    // World -> camera
+    struct Pose {
+        Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+        Eigen::Vector3d translation = Eigen::Vector3d::Zero();
+    };
+
+    struct KeyframeState {
+        int frame_id;
+        long long timestamp;
+        Pose pose;
+    };
+
+    // One landmark's observations are contiguous in m_observations
+    struct LandmarkBlock {
+        int feature_id;
+        Eigen::Vector3d position;
+        size_t first;
+        size_t count;
+        Eigen::Matrix3d H_ll;
+        Eigen::Vector3d g_l;
+    };
+
+    struct ObservationBlock {
+        int pose;                   // Window index
+        bool stereo;
+        Eigen::Vector2d left;       // Normalized coordinates
+        Eigen::Vector2d right;
+        // Linearization: rows 0-1 left image, 2-3 right image (zero when mono), in pixels
+        Eigen::Matrix<double, 4, 1> residual;
+        Eigen::Matrix<double, 4, 6> J_pose;
+        Eigen::Matrix<double, 4, 3> J_point;
+        Eigen::Vector2d weight;     // Huber weight of each image
+        Eigen::Matrix<double, 6, 3> H_pl;
+    };
+
+    int sync_keyframes(const SlidingWindowMap& map);  // Returns the number marginalized
+    void index_window();
+    void current_poses(std::vector<Pose>& poses) const;
+    void marginalize_oldest();
+    void collect(const SlidingWindowMap& map);
+    double linearize();  // Returns the cost at the current state
+    double evaluate(const std::vector<Pose>& poses, const std::vector<Eigen::Vector3d>& points) const;
+    void prior_delta(const std::vector<Pose>& poses, Eigen::VectorXd& delta) const;
+    double prior_cost(const std::vector<Pose>& poses) const;
+    // One damped step from the current linearization, applied to poses/points
+    bool solve(double lambda, std::vector<Pose>& poses, std::vector<Eigen::Vector3d>& points);
+    double observation_cost(const ObservationBlock& obs, const Pose& pose, const Eigen::Vector3d& point) const;
+    void linearize_observation(ObservationBlock& obs, const Pose& pose, const Eigen::Vector3d& point) const;
+
+    StereoCamera m_stereo;
+    WindowOptimizerParams m_params;
+    double m_focal_length;
+
+    std::vector<KeyframeState> m_keyframes;       // Oldest first
+    std::unordered_map<int, int> m_window_index;  // frame_id -> index in m_keyframes
+    std::unordered_map<int, Eigen::Vector3d> m_landmarks;
+    // Feature id -> last frame whose observation went into the prior
+    std::unordered_map<int, int> m_consumed_until;
+
+    // Marginalization prior over some window poses, linearized at prior_poses:
+    // cost(dx) = g^T dx + 1/2 dx^T H dx with dx = pose [-] linearization pose
+    std::vector<int> m_prior_ids;
+    std::vector<Pose> m_prior_poses;
+    Eigen::MatrixXd m_prior_H;
+    Eigen::VectorXd m_prior_g;
+
+    // Per-solve buffers (reused)
+    std::vector<LandmarkBlock> m_blocks;
+    std::vector<ObservationBlock> m_observations;
+    std::vector<int> m_feature_ids;
+    Eigen::MatrixXd m_H_pp;
+    Eigen::VectorXd m_g_p;
+    Eigen::MatrixXd m_reduced;
+    Eigen::VectorXd m_reduced_b;
+    std::vector<Eigen::Matrix3d> m_point_inverses;
+    std::vector<Pose> m_candidate_poses;
+    std::vector<Eigen::Vector3d> m_candidate_points;
+};
+
+} // namespace lightweight_vio
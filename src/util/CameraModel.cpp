@@ -0,0 +1,216 @@
+#include "CameraModel.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace lightweight_vio {
+
+namespace {
+
+// Points per undistortion block: the block's coordinates live in small arrays
+// so each Newton step is a straight loop the compiler vectorizes
+constexpr size_t BLOCK = 64;
+
+// Newton steps; both models converge to float precision in 4-5 steps over the
+// EuRoC field of view, one more is margin for stronger lenses
+constexpr int RADTAN_ITERATIONS = 6;
+constexpr int EQUIDISTANT_ITERATIONS = 6;
+
+} // namespace
+
+CameraModel::CameraModel()
+    : m_image_size(0, 0)
+    , m_fx(0.0), m_fy(0.0), m_cx(0.0), m_cy(0.0)
+    , m_distortion(DistortionModel::None)
+    , m_coefficients{{0.0, 0.0, 0.0, 0.0}}
+    , m_body_from_camera(Eigen::Matrix4d::Identity())
+    , m_grid_step(0)
+    , m_grid_cols(0)
+    , m_grid_rows(0)
+{
+}
+
+CameraModel::CameraModel(const cv::Size& image_size, double fx, double fy, double cx, double cy,
+                         DistortionModel distortion, const std::array<double, 4>& coefficients)
+    : m_image_size(image_size)
+    , m_fx(fx), m_fy(fy), m_cx(cx), m_cy(cy)
+    , m_distortion(distortion)
+    , m_coefficients(coefficients)
+    , m_body_from_camera(Eigen::Matrix4d::Identity())
+    , m_grid_step(0)
+    , m_grid_cols(0)
+    , m_grid_rows(0)
+{
+}
+
+void CameraModel::set_image_size(const cv::Size& image_size) {
+    m_image_size = image_size;
+    m_grid.clear();
+}
+
+cv::Point2f CameraModel::undistort_point(const cv::Point2f& pixel) const {
+    cv::Point2f normalized;
+    undistort_block(&pixel, &normalized, 1);
+    return normalized;
+}
+
+void CameraModel::undistort_points(const cv::Point2f* pixels, cv::Point2f* normalized, size_t count) const {
+    VIO_PROFILE_SCOPE("undistort_points");
+
+    if (m_grid.empty()) {
+        for (size_t start = 0; start < count; start += BLOCK) {
+            undistort_block(pixels + start, normalized + start, std::min(BLOCK, count - start));
+        }
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const cv::Point2f pixel = pixels[i];
+        if (!interpolate_grid(pixel, normalized[i])) {
+            undistort_block(&pixel, &normalized[i], 1);
+        }
+    }
+}
+
+void CameraModel::undistort_block(const cv::Point2f* pixels, cv::Point2f* normalized, size_t count) const {
+    float xd[BLOCK], yd[BLOCK], x[BLOCK], y[BLOCK];
+    const float inv_fx = static_cast<float>(1.0 / m_fx), inv_fy = static_cast<float>(1.0 / m_fy);
+    const float cx = static_cast<float>(m_cx), cy = static_cast<float>(m_cy);
+    for (size_t i = 0; i < count; ++i) {
+        xd[i] = (pixels[i].x - cx) * inv_fx;
+        yd[i] = (pixels[i].y - cy) * inv_fy;
+    }
+
+    const float k1 = static_cast<float>(m_coefficients[0]), k2 = static_cast<float>(m_coefficients[1]);
+    const float k3 = static_cast<float>(m_coefficients[2]), k4 = static_cast<float>(m_coefficients[3]);
+
+    switch (m_distortion) {
+    case DistortionModel::None:
+        for (size_t i = 0; i < count; ++i) {
+            x[i] = xd[i];
+            y[i] = yd[i];
+        }
+        break;
+
+    case DistortionModel::RadialTangential: {
+        // Newton on distort(x, y) = (xd, yd) with the analytic 2x2 Jacobian
+        const float p1 = k3, p2 = k4;
+        for (size_t i = 0; i < count; ++i) {
+            x[i] = xd[i];
+            y[i] = yd[i];
+        }
+        for (int iteration = 0; iteration < RADTAN_ITERATIONS; ++iteration) {
+            for (size_t i = 0; i < count; ++i) {
+                const float xx = x[i], yy = y[i];
+                const float r2 = xx * xx + yy * yy;
+                const float radial = 1.0f + r2 * (k1 + k2 * r2);
+                const float dradial = 2.0f * (k1 + 2.0f * k2 * r2);
+                const float ex = xx * radial + 2.0f * p1 * xx * yy + p2 * (r2 + 2.0f * xx * xx) - xd[i];
+                const float ey = yy * radial + p1 * (r2 + 2.0f * yy * yy) + 2.0f * p2 * xx * yy - yd[i];
+                const float j00 = radial + dradial * xx * xx + 2.0f * p1 * yy + 6.0f * p2 * xx;
+                const float j01 = dradial * xx * yy + 2.0f * p1 * xx + 2.0f * p2 * yy;
+                const float j11 = radial + dradial * yy * yy + 6.0f * p1 * yy + 2.0f * p2 * xx;
+                const float inv_det = 1.0f / (j00 * j11 - j01 * j01);
+                x[i] = xx - (j11 * ex - j01 * ey) * inv_det;
+                y[i] = yy - (j00 * ey - j01 * ex) * inv_det;
+            }
+        }
+        break;
+    }
+
+    case DistortionModel::Equidistant: {
+        // Newton on theta_d(theta) = |(xd, yd)|, then r = tan(theta)
+        float rd[BLOCK], theta[BLOCK];
+        for (size_t i = 0; i < count; ++i) {
+            rd[i] = std::sqrt(xd[i] * xd[i] + yd[i] * yd[i]);
+            theta[i] = rd[i];
+        }
+        for (int iteration = 0; iteration < EQUIDISTANT_ITERATIONS; ++iteration) {
+            for (size_t i = 0; i < count; ++i) {
+                const float t = theta[i], t2 = t * t;
+                const float f = t * (1.0f + t2 * (k1 + t2 * (k2 + t2 * (k3 + t2 * k4)))) - rd[i];
+                const float df = 1.0f + t2 * (3.0f * k1 + t2 * (5.0f * k2 + t2 * (7.0f * k3 + t2 * 9.0f * k4)));
+                theta[i] = t - f / df;
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const float t = std::min(std::max(theta[i], 0.0f), 1.5f);
+            const float scale = rd[i] > 1e-8f ? std::tan(t) / rd[i] : 1.0f;
+            x[i] = xd[i] * scale;
+            y[i] = yd[i] * scale;
+        }
+        break;
+    }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        normalized[i] = cv::Point2f(x[i], y[i]);
+    }
+}
+
+cv::Point2f CameraModel::project(const cv::Point2f& normalized) const {
+    const double x = normalized.x, y = normalized.y;
+    const double k1 = m_coefficients[0], k2 = m_coefficients[1];
+    const double k3 = m_coefficients[2], k4 = m_coefficients[3];
+    double xd = x, yd = y;
+
+    if (m_distortion == DistortionModel::RadialTangential) {
+        const double p1 = k3, p2 = k4;
+        const double r2 = x * x + y * y;
+        const double radial = 1.0 + r2 * (k1 + k2 * r2);
+        xd = x * radial + 2.0 * p1 * x * y + p2 * (r2 + 2.0 * x * x);
+        yd = y * radial + p1 * (r2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+    } else if (m_distortion == DistortionModel::Equidistant) {
+        const double r = std::sqrt(x * x + y * y);
+        if (r > 1e-8) {
+            const double theta = std::atan(r), t2 = theta * theta;
+            const double theta_d = theta * (1.0 + t2 * (k1 + t2 * (k2 + t2 * (k3 + t2 * k4))));
+            xd = x * theta_d / r;
+            yd = y * theta_d / r;
+        }
+    }
+
+    return cv::Point2f(static_cast<float>(m_fx * xd + m_cx), static_cast<float>(m_fy * yd + m_cy));
+}
+
+bool CameraModel::build_undistortion_grid(int step) {
+    if (!is_valid() || m_image_size.width <= 0 || m_image_size.height <= 0 || step <= 0) {
+        VIO_LOG_WARN("Cannot build undistortion grid: camera size or step not set");
+        m_grid.clear();
+        return false;
+    }
+
+    // Nodes every step pixels, one past the last pixel so every in-image point has four
+    m_grid_step = step;
+    m_grid_cols = (m_image_size.width - 1) / step + 2;
+    m_grid_rows = (m_image_size.height - 1) / step + 2;
+    std::vector<cv::Point2f> grid(static_cast<size_t>(m_grid_cols) * m_grid_rows);
+    for (int r = 0; r < m_grid_rows; ++r) {
+        for (int c = 0; c < m_grid_cols; ++c) {
+            grid[static_cast<size_t>(r) * m_grid_cols + c] = cv::Point2f(static_cast<float>(c * step),
+                                                                         static_cast<float>(r * step));
+        }
+    }
+    m_grid.clear();  // undistort_points() below must take the exact path
+    undistort_points(grid.data(), grid.data(), grid.size());
+    m_grid = std::move(grid);
+
+    VIO_LOG_DEBUG("Undistortion grid " << m_grid_cols << "x" << m_grid_rows << " (step " << step << " px)");
+    return true;
+}
+
+bool CameraModel::interpolate_grid(const cv::Point2f& pixel, cv::Point2f& normalized) const {
+    const float gx = pixel.x / m_grid_step, gy = pixel.y / m_grid_step;
+    if (!(gx >= 0.0f && gy >= 0.0f)) return false;
+    const int c = static_cast<int>(gx), r = static_cast<int>(gy);
+    if (c + 1 >= m_grid_cols || r + 1 >= m_grid_rows) return false;
+
+    const float ax = gx - c, ay = gy - r;
+    const cv::Point2f* row0 = &m_grid[static_cast<size_t>(r) * m_grid_cols + c];
+    const cv::Point2f* row1 = row0 + m_grid_cols;
+    normalized = (row0[0] * (1.0f - ax) + row0[1] * ax) * (1.0f - ay) + (row1[0] * (1.0f - ax) + row1[1] * ax) * ay;
+    return true;
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace lightweight_vio {
+
+enum class DistortionModel {
+    None,
+    RadialTangential,   // k1, k2, p1, p2 (OpenCV / Kalibr "radial-tangential")
+    Equidistant         // k1..k4 on theta (Kannala-Brandt, Kalibr "equidistant")
+};
+
+// Pinhole camera with optional lens distortion. Maps pixels to undistorted
+// normalized coordinates (x/z, y/z) and back.
+class CameraModel {
+public:
+    CameraModel();
+    CameraModel(const cv::Size& image_size, double fx, double fy, double cx, double cy,
+                DistortionModel distortion = DistortionModel::None,
+                const std::array<double, 4>& coefficients = {{0.0, 0.0, 0.0, 0.0}});
+
+    bool is_valid() const { return m_fx > 0.0 && m_fy > 0.0; }
+
+    // Getters
+    const cv::Size& get_image_size() const { return m_image_size; }
+    double get_fx() const { return m_fx; }
+    double get_fy() const { return m_fy; }
+    double get_cx() const { return m_cx; }
+    double get_cy() const { return m_cy; }
+    double get_focal_length() const { return 0.5 * (m_fx + m_fy); }
+    DistortionModel get_distortion_model() const { return m_distortion; }
+    const std::array<double, 4>& get_distortion_coefficients() const { return m_coefficients; }
+    // Camera-to-body transform (EuRoC T_BS); identity unless loaded
+    const Eigen::Matrix4d& get_body_from_camera() const { return m_body_from_camera; }
+
+    // Setters (drop the undistortion grid, which depends on them)
+    void set_image_size(const cv::Size& image_size);
+    void set_body_from_camera(const Eigen::Matrix4d& body_from_camera) { m_body_from_camera = body_from_camera; }
+
+    // Pixel -> normalized, one point (iterative inversion of the distortion)
+    cv::Point2f undistort_point(const cv::Point2f& pixel) const;
+    // Pixel -> normalized for a whole column. Points are inverted in blocks with
+    // a fixed Newton iteration count so the loops vectorize; with a grid built,
+    // points inside the image are bilinearly interpolated from it instead.
+    // pixels and normalized may alias.
+    void undistort_points(const cv::Point2f* pixels, cv::Point2f* normalized, size_t count) const;
+    // Normalized -> pixel (applies the distortion)
+    cv::Point2f project(const cv::Point2f& normalized) const;
+
+    // Lookup grid of normalized coordinates every step pixels over the image.
+    // Needs the image size. On the EuRoC lens the interpolation error is about
+    // 0.01 px at step 4 and 0.04 px at step 8 (image corners).
+    bool build_undistortion_grid(int step = 4);
+    void clear_undistortion_grid() { m_grid.clear(); }
+    bool has_undistortion_grid() const { return !m_grid.empty(); }
+
+private:
+    void undistort_block(const cv::Point2f* pixels, cv::Point2f* normalized, size_t count) const;
+    bool interpolate_grid(const cv::Point2f& pixel, cv::Point2f& normalized) const;
+
+    cv::Size m_image_size;
+    double m_fx, m_fy, m_cx, m_cy;
+    DistortionModel m_distortion;
+    std::array<double, 4> m_coefficients;
+    Eigen::Matrix4d m_body_from_camera;
+
+    // Undistortion lookup grid (row-major, m_grid_cols x m_grid_rows nodes)
+    std::vector<cv::Point2f> m_grid;
+    int m_grid_step;
+    int m_grid_cols;
+    int m_grid_rows;
+};
+
+// Two cameras with the transform taking left-camera points to the right camera
+struct StereoCamera {
+    CameraModel left;
+    CameraModel right;
+    Eigen::Matrix3d right_R_left = Eigen::Matrix3d::Identity();
+    Eigen::Vector3d right_t_left = Eigen::Vector3d::Zero();
+
+    bool is_valid() const { return left.is_valid() && right.is_valid() && right_t_left.norm() > 0.0; }
+    double get_baseline() const { return right_t_left.norm(); }
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,197 @@
+#include "EpipolarKernel.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VIO_EPIPOLAR_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VIO_EPIPOLAR_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VIO_EPIPOLAR_NEON 1
+#endif
+
+namespace lightweight_vio {
+
+namespace {
+
+// Keeps the Sampson division finite for degenerate F / points
+constexpr float MIN_SAMPSON_DENOMINATOR = 1e-30f;
+
+inline void epipolar_errors_one(const float* F, float x1, float y1, float x2, float y2,
+                                float* algebraic, float* sampson) {
+    // F x1 (epipolar line in image 2) and F^T x2 (line in image 1)
+    float a = F[0] * x1 + F[1] * y1 + F[2];
+    float b = F[3] * x1 + F[4] * y1 + F[5];
+    float c = F[6] * x1 + F[7] * y1 + F[8];
+    float d = F[0] * x2 + F[3] * y2 + F[6];
+    float g = F[1] * x2 + F[4] * y2 + F[7];
+    float e = x2 * a + y2 * b + c;
+
+    if (algebraic) *algebraic = std::fabs(e);
+    if (sampson) {
+        float denominator = a * a + b * b + d * d + g * g;
+        *sampson = e * e / std::max(denominator, MIN_SAMPSON_DENOMINATOR);
+    }
+}
+
+void epipolar_errors_tail(const float* F, const float* pts1, const float* pts2, size_t begin, size_t count,
+                          float* algebraic, float* sampson) {
+    for (size_t i = begin; i < count; ++i) {
+        epipolar_errors_one(F, pts1[2 * i], pts1[2 * i + 1], pts2[2 * i], pts2[2 * i + 1],
+                            algebraic ? algebraic + i : nullptr, sampson ? sampson + i : nullptr);
+    }
+}
+
+#if defined(VIO_EPIPOLAR_AVX2)
+
+// Eight pairs per iteration. _mm256_shuffle_ps works per 128-bit lane, so the
+// de-interleaved x/y come out as [0 1 4 5 | 2 3 6 7]; permute4x64 restores order.
+inline void load_points8(const float* pts, __m256& x, __m256& y) {
+    __m256 lo = _mm256_loadu_ps(pts);
+    __m256 hi = _mm256_loadu_ps(pts + 8);
+    __m256 xs = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    __m256 ys = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+    x = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(xs), _MM_SHUFFLE(3, 1, 2, 0)));
+    y = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(ys), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+size_t epipolar_errors_simd(const float* F, const float* pts1, const float* pts2, size_t count,
+                            float* algebraic, float* sampson) {
+    __m256 f[9];
+    for (int k = 0; k < 9; ++k) f[k] = _mm256_set1_ps(F[k]);
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 min_denominator = _mm256_set1_ps(MIN_SAMPSON_DENOMINATOR);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x1, y1, x2, y2;
+        load_points8(pts1 + 2 * i, x1, y1);
+        load_points8(pts2 + 2 * i, x2, y2);
+
+        __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f[0], x1), _mm256_mul_ps(f[1], y1)), f[2]);
+        __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f[3], x1), _mm256_mul_ps(f[4], y1)), f[5]);
+        __m256 c = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f[6], x1), _mm256_mul_ps(f[7], y1)), f[8]);
+        __m256 e = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x2, a), _mm256_mul_ps(y2, b)), c);
+
+        if (algebraic) _mm256_storeu_ps(algebraic + i, _mm256_and_ps(e, abs_mask));
+        if (sampson) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f[0], x2), _mm256_mul_ps(f[3], y2)), f[6]);
+            __m256 g = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(f[1], x2), _mm256_mul_ps(f[4], y2)), f[7]);
+            __m256 denominator = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a, a), _mm256_mul_ps(b, b)),
+                                               _mm256_add_ps(_mm256_mul_ps(d, d), _mm256_mul_ps(g, g)));
+            denominator = _mm256_max_ps(denominator, min_denominator);
+            _mm256_storeu_ps(sampson + i, _mm256_div_ps(_mm256_mul_ps(e, e), denominator));
+        }
+    }
+    return i;
+}
+
+#elif defined(VIO_EPIPOLAR_SSE2)
+
+// Four pairs per iteration
+inline void load_points4(const float* pts, __m128& x, __m128& y) {
+    __m128 lo = _mm_loadu_ps(pts);
+    __m128 hi = _mm_loadu_ps(pts + 4);
+    x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+    y = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+size_t epipolar_errors_simd(const float* F, const float* pts1, const float* pts2, size_t count,
+                            float* algebraic, float* sampson) {
+    __m128 f[9];
+    for (int k = 0; k < 9; ++k) f[k] = _mm_set1_ps(F[k]);
+    const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 min_denominator = _mm_set1_ps(MIN_SAMPSON_DENOMINATOR);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x1, y1, x2, y2;
+        load_points4(pts1 + 2 * i, x1, y1);
+        load_points4(pts2 + 2 * i, x2, y2);
+
+        __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f[0], x1), _mm_mul_ps(f[1], y1)), f[2]);
+        __m128 b = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f[3], x1), _mm_mul_ps(f[4], y1)), f[5]);
+        __m128 c = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f[6], x1), _mm_mul_ps(f[7], y1)), f[8]);
+        __m128 e = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x2, a), _mm_mul_ps(y2, b)), c);
+
+        if (algebraic) _mm_storeu_ps(algebraic + i, _mm_and_ps(e, abs_mask));
+        if (sampson) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f[0], x2), _mm_mul_ps(f[3], y2)), f[6]);
+            __m128 g = _mm_add_ps(_mm_add_ps(_mm_mul_ps(f[1], x2), _mm_mul_ps(f[4], y2)), f[7]);
+            __m128 denominator = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, a), _mm_mul_ps(b, b)),
+                                            _mm_add_ps(_mm_mul_ps(d, d), _mm_mul_ps(g, g)));
+            denominator = _mm_max_ps(denominator, min_denominator);
+            _mm_storeu_ps(sampson + i, _mm_div_ps(_mm_mul_ps(e, e), denominator));
+        }
+    }
+    return i;
+}
+
+#elif defined(VIO_EPIPOLAR_NEON)
+
+// Four pairs per iteration; vld2q de-interleaves x/y directly
+size_t epipolar_errors_simd(const float* F, const float* pts1, const float* pts2, size_t count,
+                            float* algebraic, float* sampson) {
+    float32x4_t f[9];
+    for (int k = 0; k < 9; ++k) f[k] = vdupq_n_f32(F[k]);
+    const float32x4_t min_denominator = vdupq_n_f32(MIN_SAMPSON_DENOMINATOR);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t p1 = vld2q_f32(pts1 + 2 * i);
+        float32x4x2_t p2 = vld2q_f32(pts2 + 2 * i);
+        float32x4_t x1 = p1.val[0], y1 = p1.val[1];
+        float32x4_t x2 = p2.val[0], y2 = p2.val[1];
+
+        float32x4_t a = vaddq_f32(vaddq_f32(vmulq_f32(f[0], x1), vmulq_f32(f[1], y1)), f[2]);
+        float32x4_t b = vaddq_f32(vaddq_f32(vmulq_f32(f[3], x1), vmulq_f32(f[4], y1)), f[5]);
+        float32x4_t c = vaddq_f32(vaddq_f32(vmulq_f32(f[6], x1), vmulq_f32(f[7], y1)), f[8]);
+        float32x4_t e = vaddq_f32(vaddq_f32(vmulq_f32(x2, a), vmulq_f32(y2, b)), c);
+
+        if (algebraic) vst1q_f32(algebraic + i, vabsq_f32(e));
+        if (sampson) {
+            float32x4_t d = vaddq_f32(vaddq_f32(vmulq_f32(f[0], x2), vmulq_f32(f[3], y2)), f[6]);
+            float32x4_t g = vaddq_f32(vaddq_f32(vmulq_f32(f[1], x2), vmulq_f32(f[4], y2)), f[7]);
+            float32x4_t denominator = vaddq_f32(vaddq_f32(vmulq_f32(a, a), vmulq_f32(b, b)),
+                                                vaddq_f32(vmulq_f32(d, d), vmulq_f32(g, g)));
+            denominator = vmaxq_f32(denominator, min_denominator);
+            vst1q_f32(sampson + i, vdivq_f32(vmulq_f32(e, e), denominator));
+        }
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+void compute_epipolar_errors(const float* F, const float* pts1, const float* pts2, size_t count,
+                             float* algebraic, float* sampson) {
+    size_t done = 0;
+#if defined(VIO_EPIPOLAR_AVX2) || defined(VIO_EPIPOLAR_SSE2) || defined(VIO_EPIPOLAR_NEON)
+    done = epipolar_errors_simd(F, pts1, pts2, count, algebraic, sampson);
+#endif
+    epipolar_errors_tail(F, pts1, pts2, done, count, algebraic, sampson);
+}
+
+void compute_epipolar_errors_scalar(const float* F, const float* pts1, const float* pts2, size_t count,
+                                    float* algebraic, float* sampson) {
+    epipolar_errors_tail(F, pts1, pts2, 0, count, algebraic, sampson);
+}
+
+const char* epipolar_kernel_backend() {
+#if defined(VIO_EPIPOLAR_AVX2)
+    return "avx2";
+#elif defined(VIO_EPIPOLAR_SSE2)
+    return "sse2";
+#elif defined(VIO_EPIPOLAR_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lightweight_vio {
+
+// Batched epipolar residuals for n correspondences x1[i] <-> x2[i].
+//   F          : row-major 3x3 fundamental matrix (x2^T F x1 = 0)
+//   pts1, pts2 : interleaved x,y pairs (a std::vector<cv::Point2f>'s data() works as-is)
+//   algebraic  : |x2^T F x1| per pair (may be null)
+//   sampson    : first-order geometric (Sampson) distance, squared px (may be null)
+// Uses AVX2 / SSE2 / NEON when available, scalar otherwise; all backends agree
+// to float rounding.
+void compute_epipolar_errors(const float* F, const float* pts1, const float* pts2, size_t count,
+                             float* algebraic, float* sampson);
+
+// Plain C++ reference, always available (used for verification and benchmarking)
+void compute_epipolar_errors_scalar(const float* F, const float* pts1, const float* pts2, size_t count,
+                                    float* algebraic, float* sampson);
+
+// Name of the backend compute_epipolar_errors dispatches to
+const char* epipolar_kernel_backend();
+
+} // namespace lightweight_vio
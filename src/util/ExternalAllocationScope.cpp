@@ -0,0 +1,7 @@
+#include "ExternalAllocationScope.h"
+
+namespace lightweight_vio {
+
+thread_local bool ExternalAllocationScope::s_active = false;
+
+} // namespace lightweight_vio
@@ -0,0 +1,25 @@
+#pragma once
+
+namespace lightweight_vio {
+
+// Marks the current thread as inside a third-party call (OpenCV filtering,
+// pyramid building, ...) whose internal temporaries the project cannot reuse.
+// Allocation counters (bench_euroc --check-allocations) attribute whatever is
+// allocated meanwhile to the library instead of the project. Scopes nest; the
+// cost is one thread_local store on entry and exit.
+class ExternalAllocationScope {
+public:
+    ExternalAllocationScope() : m_was_active(s_active) { s_active = true; }
+    ~ExternalAllocationScope() { s_active = m_was_active; }
+
+    ExternalAllocationScope(const ExternalAllocationScope&) = delete;
+    ExternalAllocationScope& operator=(const ExternalAllocationScope&) = delete;
+
+    static bool is_active() { return s_active; }
+
+private:
+    static thread_local bool s_active;
+    bool m_was_active;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,62 @@
+#include "ImagePool.h"
+
+namespace lightweight_vio {
+
+namespace {
+
+// Only the pool's own header references the buffer. The count is read
+// atomically; it can only grow again through acquire(), under the pool mutex.
+bool is_free(cv::Mat& buffer) {
+    return buffer.u && CV_XADD(&buffer.u->refcount, 0) == 1;
+}
+
+} // namespace
+
+ImagePool::ImagePool(size_t max_buffers)
+    : m_max_buffers(max_buffers)
+    , m_allocations(0)
+    , m_reuses(0)
+{
+}
+
+cv::Mat ImagePool::acquire(const cv::Size& size, int type) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (cv::Mat& buffer : m_buffers) {
+        if (buffer.size() == size && buffer.type() == type && is_free(buffer)) {
+            m_reuses++;
+            return buffer;
+        }
+    }
+
+    m_allocations++;
+    cv::Mat image(size, type);
+    if (m_buffers.size() < m_max_buffers) {
+        m_buffers.push_back(image);
+    } else {
+        // Full: replace a free buffer of another size (after a resolution change)
+        for (cv::Mat& buffer : m_buffers) {
+            if (is_free(buffer)) {
+                buffer = image;
+                break;
+            }
+        }
+    }
+    return image;
+}
+
+size_t ImagePool::get_buffer_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_buffers.size();
+}
+
+size_t ImagePool::get_allocation_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_allocations;
+}
+
+size_t ImagePool::get_reuse_count() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_reuses;
+}
+
+} // namespace lightweight_vio
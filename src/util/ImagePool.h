@@ -0,0 +1,38 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Recycling allocator for frame-sized images. acquire() returns a buffer that
+// nobody else references, so the caller may write it and hand it on (e.g. into
+// a Frame). The pool keeps one reference to every buffer it made; a buffer is
+// free again once all other references are gone, i.e. once the frame holding
+// it is destroyed. When every pooled buffer is in use a plain, unpooled image
+// is returned, so running out only costs an allocation. Thread-safe.
+class ImagePool {
+public:
+    explicit ImagePool(size_t max_buffers = 32);
+
+    ImagePool(const ImagePool&) = delete;
+    ImagePool& operator=(const ImagePool&) = delete;
+
+    cv::Mat acquire(const cv::Size& size, int type);
+
+    // Statistics
+    size_t get_buffer_count() const;      // Buffers owned by the pool
+    size_t get_allocation_count() const;  // Images allocated (pooled or not) since construction
+    size_t get_reuse_count() const;       // acquire() calls served by a free buffer
+
+private:
+    mutable std::mutex m_mutex;
+    size_t m_max_buffers;
+    std::vector<cv::Mat> m_buffers;
+    size_t m_allocations;
+    size_t m_reuses;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,327 @@
+#include "ImagePreprocessor.h"
+#include "Logger.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+namespace lightweight_vio {
+
+namespace {
+
+constexpr int ROW_BLOCK = 16;  // Rows per fused block (a few cache lines per column)
+constexpr int BINS = 256;
+
+// Row `row` of the image, counted in tile row `tile_row`. Columns past the
+// image up to padded_width (the grid is padded to a multiple of the tile
+// size, reflect-101 like cv::CLAHE) count as their mirrored pixel.
+void add_row_to_histograms(const uchar* row, int width, int padded_width, int tile_row, int tiles_x,
+                           int tile_width, int* histograms) {
+    int* tile_histograms = histograms + tile_row * tiles_x * BINS;
+    for (int x = 0, tx = 0; x < width; ++tx) {
+        int* histogram = tile_histograms + tx * BINS;
+        const int end = std::min(width, x + tile_width);
+        for (; x < end; ++x) {
+            histogram[row[x]]++;
+        }
+    }
+    for (int x = width; x < padded_width; ++x) {
+        tile_histograms[(x / tile_width) * BINS + row[2 * (width - 1) - x]]++;
+    }
+}
+
+// Reflect-101 border of the view's rows [row_begin, row_end), left and right
+void fill_side_borders(const cv::Mat& view, const cv::Size& border, int row_begin, int row_end) {
+    const int width = view.cols;
+    for (int y = row_begin; y < row_end; ++y) {
+        uchar* row = view.data + static_cast<ptrdiff_t>(y) * view.step[0];
+        for (int i = 1; i <= border.width; ++i) {
+            row[-i] = row[i];
+            row[width - 1 + i] = row[width - 1 - i];
+        }
+    }
+}
+
+// Reflect-101 border above and below the view, corners included
+void fill_top_bottom_borders(const cv::Mat& view, const cv::Size& border) {
+    const size_t row_bytes = view.cols + 2 * border.width;
+    auto row_start = [&](int y) { return view.data + static_cast<ptrdiff_t>(y) * view.step[0] - border.width; };
+    for (int i = 1; i <= border.height; ++i) {
+        std::memcpy(row_start(-i), row_start(i), row_bytes);
+        std::memcpy(row_start(view.rows - 1 + i), row_start(view.rows - 1 - i), row_bytes);
+    }
+}
+
+} // namespace
+
+ImagePreprocessor::ImagePreprocessor()
+    : m_apply_clahe(false)
+    , m_clip_limit(2.0)
+    , m_tile_grid(8, 8)
+    , m_fused(false)
+    , m_pyramid_border(21, 21)
+{
+}
+
+void ImagePreprocessor::set_clahe(bool enabled, double clip_limit, const cv::Size& tile_grid) {
+    m_apply_clahe = enabled;
+    m_clip_limit = clip_limit;
+    m_tile_grid = cv::Size(std::max(1, tile_grid.width), std::max(1, tile_grid.height));
+    for (CameraState& state : m_cameras) {
+        state.clahe.reset();
+        state.table_size = cv::Size();
+    }
+}
+
+void ImagePreprocessor::set_fused(bool fused, const cv::Size& pyramid_border) {
+    m_fused = fused;
+    m_pyramid_border = cv::Size(std::max(0, pyramid_border.width), std::max(0, pyramid_border.height));
+}
+
+void ImagePreprocessor::set_concurrent_stereo(bool concurrent) {
+    if (!concurrent) {
+        m_thread_pool.reset();
+    } else if (!m_thread_pool) {
+        m_thread_pool = std::make_unique<ThreadPool>(1);
+    }
+}
+
+cv::Mat ImagePreprocessor::output_image(const cv::Size& size, const cv::Size& border) const {
+    const cv::Size full(size.width + 2 * border.width, size.height + 2 * border.height);
+    cv::Mat buffer = m_image_pool ? m_image_pool->acquire(full, CV_8UC1) : cv::Mat(full, CV_8UC1);
+    if (border.width == 0 && border.height == 0) {
+        return buffer;
+    }
+    return buffer(cv::Rect(border.width, border.height, size.width, size.height));
+}
+
+bool ImagePreprocessor::process(int camera, const cv::Mat& src, cv::Mat& dst) {
+    if (src.empty() || src.type() != CV_8UC1) {
+        VIO_LOG_ERROR("Image preprocessing needs a non-empty 8-bit grayscale image");
+        return false;
+    }
+    if (!m_apply_clahe && !m_rectifier && !m_fused) {
+        dst = src;
+        return true;
+    }
+
+    CameraState& state = m_cameras[camera == 0 ? 0 : 1];
+    const cv::Size size = m_rectifier ? m_rectifier->get_rectified_camera().left.get_image_size() : src.size();
+    // The reflected border needs more pixels than it is wide
+    if (m_fused && size.width > 2 * m_pyramid_border.width && size.height > 2 * m_pyramid_border.height) {
+        process_fused(state, camera, src, dst);
+    } else {
+        process_standard(state, camera, src, dst);
+    }
+    return true;
+}
+
+bool ImagePreprocessor::process_stereo(const cv::Mat& left, const cv::Mat& right, cv::Mat& left_dst,
+                                       cv::Mat& right_dst) {
+    if (right.empty()) {
+        right_dst.release();
+        return process(0, left, left_dst);
+    }
+    if (!m_thread_pool) {
+        const bool left_ok = process(0, left, left_dst);
+        const bool right_ok = process(1, right, right_dst);
+        return left_ok && right_ok;
+    }
+
+    // Each camera only touches its own state
+    bool ok[2] = {false, false};
+    m_thread_pool->parallel_for(2, [&](size_t i) {
+        ok[i] = i == 0 ? process(0, left, left_dst) : process(1, right, right_dst);
+    });
+    return ok[0] && ok[1];
+}
+
+void ImagePreprocessor::process_standard(CameraState& state, int camera, const cv::Mat& src, cv::Mat& dst) {
+    const cv::Size size = m_rectifier ? m_rectifier->get_rectified_camera().left.get_image_size() : src.size();
+
+    // Without CLAHE the remap is the last step and writes the output
+    const cv::Mat* input = &src;
+    if (m_rectifier) {
+        cv::Mat& target = m_apply_clahe ? state.rectified : (dst = output_image(size, cv::Size()));
+        if (camera == 0) {
+            m_rectifier->rectify_left(src, target);
+        } else {
+            m_rectifier->rectify_right(src, target);
+        }
+        if (!m_apply_clahe) {
+            return;
+        }
+        input = &state.rectified;
+    } else if (!m_apply_clahe) {
+        // Only reached as the fallback of the fused path
+        dst = output_image(size, cv::Size());
+        src.copyTo(dst);
+        return;
+    }
+
+    VIO_PROFILE_SCOPE("clahe");
+    if (!state.clahe) {
+        state.clahe = cv::createCLAHE(m_clip_limit, m_tile_grid);
+    }
+    dst = output_image(size, cv::Size());
+    state.clahe->apply(*input, dst);
+}
+
+void ImagePreprocessor::process_fused(CameraState& state, int camera, const cv::Mat& src, cv::Mat& dst) {
+    VIO_PROFILE_SCOPE("preprocess_fused");
+
+    const cv::Size size = m_rectifier ? m_rectifier->get_rectified_camera().left.get_image_size() : src.size();
+    dst = output_image(size, m_pyramid_border);
+
+    if (!m_apply_clahe) {
+        // Remap (or copy) each block straight into the bordered buffer
+        for (int y0 = 0; y0 < size.height; y0 += ROW_BLOCK) {
+            const int y1 = std::min(size.height, y0 + ROW_BLOCK);
+            if (m_rectifier) {
+                m_rectifier->rectify_rows(camera, src, dst, y0, y1);
+            } else {
+                cv::Mat rows = dst.rowRange(y0, y1);
+                src.rowRange(y0, y1).copyTo(rows);
+            }
+            fill_side_borders(dst, m_pyramid_border, y0, y1);
+        }
+        fill_top_bottom_borders(dst, m_pyramid_border);
+        return;
+    }
+
+    // cv::CLAHE's grid: the image is padded up to a multiple of the tile size
+    const int tiles_x = m_tile_grid.width;
+    const int tiles_y = m_tile_grid.height;
+    const int tile_width = (size.width + tiles_x - 1) / tiles_x;
+    const int tile_height = (size.height + tiles_y - 1) / tiles_y;
+    const int padded_width = tile_width * tiles_x;
+    const int padded_height = tile_height * tiles_y;
+
+    const cv::Mat* input = &src;
+    if (m_rectifier) {
+        state.rectified.create(size, CV_8UC1);
+        input = &state.rectified;
+    }
+
+    // Pass 1: remap a block and add it to the tile histograms while it is in cache
+    {
+        VIO_PROFILE_SCOPE("preprocess_fused_histogram");
+        state.histograms.assign(static_cast<size_t>(tiles_x) * tiles_y * BINS, 0);
+        for (int y0 = 0; y0 < size.height; y0 += ROW_BLOCK) {
+            const int y1 = std::min(size.height, y0 + ROW_BLOCK);
+            if (m_rectifier) {
+                m_rectifier->rectify_rows(camera, src, state.rectified, y0, y1);
+            }
+            for (int y = y0; y < y1; ++y) {
+                add_row_to_histograms(input->ptr<uchar>(y), size.width, padded_width, y / tile_height, tiles_x,
+                                      tile_width, state.histograms.data());
+            }
+        }
+        for (int y = size.height; y < padded_height; ++y) {
+            add_row_to_histograms(input->ptr<uchar>(2 * (size.height - 1) - y), size.width, padded_width,
+                                  y / tile_height, tiles_x, tile_width, state.histograms.data());
+        }
+    }
+
+    build_luts(state, tile_width * tile_height);
+    if (state.table_size != size) {
+        build_column_tables(state, size, tile_width);
+    }
+
+    // Pass 2: equalize each block into the bordered buffer and close its side borders
+    VIO_PROFILE_SCOPE("preprocess_fused_equalize");
+    for (int y0 = 0; y0 < size.height; y0 += ROW_BLOCK) {
+        const int y1 = std::min(size.height, y0 + ROW_BLOCK);
+        equalize_rows(state, *input, dst, y0, y1, tile_height);
+        fill_side_borders(dst, m_pyramid_border, y0, y1);
+    }
+    fill_top_bottom_borders(dst, m_pyramid_border);
+}
+
+void ImagePreprocessor::build_luts(CameraState& state, int tile_area) const {
+    // Same clip limit, excess redistribution and rounding as cv::CLAHE
+    int clip_limit = 0;
+    if (m_clip_limit > 0.0) {
+        clip_limit = std::max(1, static_cast<int>(m_clip_limit * tile_area / BINS));
+    }
+    const float lut_scale = static_cast<float>(BINS - 1) / tile_area;
+    const size_t tiles = state.histograms.size() / BINS;
+    state.luts.resize(state.histograms.size());
+
+    for (size_t tile = 0; tile < tiles; ++tile) {
+        int* histogram = state.histograms.data() + tile * BINS;
+        if (clip_limit > 0) {
+            int clipped = 0;
+            for (int i = 0; i < BINS; ++i) {
+                if (histogram[i] > clip_limit) {
+                    clipped += histogram[i] - clip_limit;
+                    histogram[i] = clip_limit;
+                }
+            }
+            const int batch = clipped / BINS;
+            int residual = clipped - batch * BINS;
+            for (int i = 0; i < BINS; ++i) {
+                histogram[i] += batch;
+            }
+            if (residual != 0) {
+                const int step = std::max(BINS / residual, 1);
+                for (int i = 0; i < BINS && residual > 0; i += step, residual--) {
+                    histogram[i]++;
+                }
+            }
+        }
+
+        uchar* lut = state.luts.data() + tile * BINS;
+        int sum = 0;
+        for (int i = 0; i < BINS; ++i) {
+            sum += histogram[i];
+            lut[i] = cv::saturate_cast<uchar>(sum * lut_scale);
+        }
+    }
+}
+
+void ImagePreprocessor::build_column_tables(CameraState& state, const cv::Size& size, int tile_width) const {
+    // Each column blends the LUTs of the two nearest tile centers
+    const float inv_tile_width = 1.0f / tile_width;
+    state.lut_offset1.resize(size.width);
+    state.lut_offset2.resize(size.width);
+    state.weight2.resize(size.width);
+    for (int x = 0; x < size.width; ++x) {
+        const float txf = x * inv_tile_width - 0.5f;
+        const int tx1 = cvFloor(txf);
+        state.weight2[x] = txf - tx1;
+        state.lut_offset1[x] = std::max(tx1, 0) * BINS;
+        state.lut_offset2[x] = std::min(tx1 + 1, m_tile_grid.width - 1) * BINS;
+    }
+    state.table_size = size;
+}
+
+void ImagePreprocessor::equalize_rows(const CameraState& state, const cv::Mat& src, cv::Mat& dst, int row_begin,
+                                      int row_end, int tile_height) const {
+    const float inv_tile_height = 1.0f / tile_height;
+    const int tiles_x = m_tile_grid.width;
+    const int* offset1 = state.lut_offset1.data();
+    const int* offset2 = state.lut_offset2.data();
+    const float* weight2 = state.weight2.data();
+
+    for (int y = row_begin; y < row_end; ++y) {
+        const float tyf = y * inv_tile_height - 0.5f;
+        const int ty1 = cvFloor(tyf);
+        const float ya = tyf - ty1;
+        const float ya1 = 1.0f - ya;
+        const uchar* lut1 = state.luts.data() + std::max(ty1, 0) * tiles_x * BINS;
+        const uchar* lut2 = state.luts.data() + std::min(ty1 + 1, m_tile_grid.height - 1) * tiles_x * BINS;
+
+        const uchar* in = src.ptr<uchar>(y);
+        uchar* out = dst.ptr<uchar>(y);
+        for (int x = 0; x < dst.cols; ++x) {
+            const int v = in[x];
+            const float xa = weight2[x];
+            const float xa1 = 1.0f - xa;
+            const float value = (lut1[offset1[x] + v] * xa1 + lut1[offset2[x] + v] * xa) * ya1 +
+                                (lut2[offset1[x] + v] * xa1 + lut2[offset2[x] + v] * xa) * ya;
+            out[x] = cv::saturate_cast<uchar>(value);
+        }
+    }
+}
+
+} // namespace lightweight_vio
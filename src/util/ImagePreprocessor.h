@@ -0,0 +1,86 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <array>
+#include <memory>
+#include <vector>
+#include "ImagePool.h"
+#include "StereoRectifier.h"
+#include "ThreadPool.h"
+
+namespace lightweight_vio {
+
+// Per-camera image preprocessing: optional rectification, then CLAHE, with
+// the CLAHE state kept per camera from frame to frame.
+//
+// Standard path: cv::remap, then cv::CLAHE; the frame later copies the image
+// once more into a bordered pyramid level 0.
+// Fused path: an in-project CLAHE (OpenCV's tiling, clip redistribution and
+// bilinear LUT interpolation) run over row blocks. Each block is remapped and
+// added to the tile histograms while it is still in cache; once the LUTs are
+// built, each block is equalized straight into a buffer with a reflected
+// border of pyramid_border pixels, and that block's side borders are filled.
+// The returned image is a view into that buffer, so
+// cv::buildOpticalFlowPyramid takes it as level 0 without copying.
+//
+// Not thread-safe; one instance per thread (process_stereo may use its own
+// helper thread for the right image).
+class ImagePreprocessor {
+public:
+    ImagePreprocessor();
+
+    ImagePreprocessor(const ImagePreprocessor&) = delete;
+    ImagePreprocessor& operator=(const ImagePreprocessor&) = delete;
+
+    // Configuration
+    void set_clahe(bool enabled, double clip_limit = 2.0, const cv::Size& tile_grid = cv::Size(8, 8));
+    void set_rectifier(std::shared_ptr<const StereoRectifier> rectifier) { m_rectifier = std::move(rectifier); }
+    // pyramid_border must be at least the frame's pyramid window (Frame::set_pyramid_parameters)
+    void set_fused(bool fused, const cv::Size& pyramid_border = cv::Size(21, 21));
+    bool is_fused() const { return m_fused; }
+    // Outputs go into recycled buffers (null = fresh allocations)
+    void set_image_pool(std::shared_ptr<ImagePool> pool) { m_image_pool = std::move(pool); }
+    // Process the right image on a helper thread while the caller does the left
+    void set_concurrent_stereo(bool concurrent);
+
+    // camera: 0 = left, 1 = right (rectification map and CLAHE state).
+    // dst receives a new image nobody else references (src itself when nothing
+    // is enabled); src is not modified. Returns false for an empty or
+    // non-8-bit-grayscale src.
+    bool process(int camera, const cv::Mat& src, cv::Mat& dst);
+    // right may be empty (right_dst is then left empty)
+    bool process_stereo(const cv::Mat& left, const cv::Mat& right, cv::Mat& left_dst, cv::Mat& right_dst);
+
+private:
+    struct CameraState {
+        cv::Ptr<cv::CLAHE> clahe;   // Standard path
+        cv::Mat rectified;          // Intermediate before CLAHE
+        // Fused path
+        std::vector<int> histograms;  // 256 bins per tile
+        std::vector<uchar> luts;      // 256 entries per tile
+        cv::Size table_size;          // Image size the column tables are for
+        std::vector<int> lut_offset1; // Per column: left / right tile LUT offsets
+        std::vector<int> lut_offset2;
+        std::vector<float> weight2;   // Per column: weight of the right tile
+    };
+
+    void process_standard(CameraState& state, int camera, const cv::Mat& src, cv::Mat& dst);
+    void process_fused(CameraState& state, int camera, const cv::Mat& src, cv::Mat& dst);
+    void build_luts(CameraState& state, int tile_area) const;
+    void build_column_tables(CameraState& state, const cv::Size& size, int tile_width) const;
+    void equalize_rows(const CameraState& state, const cv::Mat& src, cv::Mat& dst, int row_begin, int row_end,
+                       int tile_height) const;
+    cv::Mat output_image(const cv::Size& size, const cv::Size& border) const;
+
+    bool m_apply_clahe;
+    double m_clip_limit;
+    cv::Size m_tile_grid;
+    std::shared_ptr<const StereoRectifier> m_rectifier;
+    bool m_fused;
+    cv::Size m_pyramid_border;
+    std::shared_ptr<ImagePool> m_image_pool;
+    std::unique_ptr<ThreadPool> m_thread_pool;
+    std::array<CameraState, 2> m_cameras;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,31 @@
+#include "Logger.h"
+#include <iostream>
+#include <mutex>
+
+namespace lightweight_vio {
+
+std::atomic<int> Logger::s_level(static_cast<int>(LogLevel::Warn));
+
+void Logger::write(LogLevel level, const std::string& message) {
+    static std::mutex write_mutex;
+    std::lock_guard<std::mutex> lock(write_mutex);
+
+    // No std::endl: the streams flush on their own schedule
+    if (level >= LogLevel::Warn) {
+        std::cerr << message << '\n';
+    } else {
+        std::cout << message << '\n';
+    }
+}
+
+bool Logger::parse_level(const std::string& name, LogLevel& level) {
+    if (name == "debug") level = LogLevel::Debug;
+    else if (name == "info") level = LogLevel::Info;
+    else if (name == "warn") level = LogLevel::Warn;
+    else if (name == "error") level = LogLevel::Error;
+    else if (name == "off") level = LogLevel::Off;
+    else return false;
+    return true;
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <sstream>
+#include <string>
+
+namespace lightweight_vio {
+
+enum class LogLevel : int {
+    Debug = 0,
+    Info,
+    Warn,
+    Error,
+    Off
+};
+
+// Process-wide console logger. Messages below the current level are never
+// formatted, so a production run (default: Warn) does no I/O in the tracking loop.
+class Logger {
+public:
+    static void set_level(LogLevel level) { s_level.store(static_cast<int>(level), std::memory_order_relaxed); }
+    static LogLevel get_level() { return static_cast<LogLevel>(s_level.load(std::memory_order_relaxed)); }
+    static bool is_enabled(LogLevel level) {
+        return static_cast<int>(level) >= s_level.load(std::memory_order_relaxed);
+    }
+
+    // Write one line; Warn/Error go to stderr, everything else to stdout
+    static void write(LogLevel level, const std::string& message);
+
+    // Parse "debug", "info", "warn", "error" or "off" (case-sensitive)
+    static bool parse_level(const std::string& name, LogLevel& level);
+
+private:
+    static std::atomic<int> s_level;
+};
+
+} // namespace lightweight_vio
+
+#define VIO_LOG(level, message)                                                   \
+    do {                                                                          \
+        if (::lightweight_vio::Logger::is_enabled(level)) {                       \
+            std::ostringstream vio_log_stream;                                    \
+            vio_log_stream << message;                                            \
+            ::lightweight_vio::Logger::write(level, vio_log_stream.str());        \
+        }                                                                         \
+    } while (0)
+
+#define VIO_LOG_DEBUG(message) VIO_LOG(::lightweight_vio::LogLevel::Debug, message)
+#define VIO_LOG_INFO(message) VIO_LOG(::lightweight_vio::LogLevel::Info, message)
+#define VIO_LOG_WARN(message) VIO_LOG(::lightweight_vio::LogLevel::Warn, message)
+#define VIO_LOG_ERROR(message) VIO_LOG(::lightweight_vio::LogLevel::Error, message)
@@ -0,0 +1,119 @@
+#include "ParallaxKernel.h"
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VIO_PARALLAX_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VIO_PARALLAX_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VIO_PARALLAX_NEON 1
+#endif
+
+namespace lightweight_vio {
+
+namespace {
+
+float point_distances_tail(const float* pts_a, const float* pts_b, size_t begin, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = begin; i < count; ++i) {
+        const float dx = pts_a[2 * i] - pts_b[2 * i];
+        const float dy = pts_a[2 * i + 1] - pts_b[2 * i + 1];
+        sum += std::sqrt(dx * dx + dy * dy);
+    }
+    return sum;
+}
+
+#if defined(VIO_PARALLAX_AVX2)
+
+// Eight pairs per iteration. The in-lane shuffle leaves the squared distances
+// as [0 1 4 5 | 2 3 6 7], which does not matter for a sum.
+size_t point_distances_simd(const float* pts_a, const float* pts_b, size_t count, float& sum) {
+    __m256 acc = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 lo = _mm256_sub_ps(_mm256_loadu_ps(pts_a + 2 * i), _mm256_loadu_ps(pts_b + 2 * i));
+        __m256 hi = _mm256_sub_ps(_mm256_loadu_ps(pts_a + 2 * i + 8), _mm256_loadu_ps(pts_b + 2 * i + 8));
+        lo = _mm256_mul_ps(lo, lo);
+        hi = _mm256_mul_ps(hi, hi);
+        __m256 dx2 = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 dy2 = _mm256_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        acc = _mm256_add_ps(acc, _mm256_sqrt_ps(_mm256_add_ps(dx2, dy2)));
+    }
+    __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    half = _mm_add_ss(half, _mm_shuffle_ps(half, half, _MM_SHUFFLE(1, 1, 1, 1)));
+    sum = _mm_cvtss_f32(half);
+    return i;
+}
+
+#elif defined(VIO_PARALLAX_SSE2)
+
+// Four pairs per iteration
+size_t point_distances_simd(const float* pts_a, const float* pts_b, size_t count, float& sum) {
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 lo = _mm_sub_ps(_mm_loadu_ps(pts_a + 2 * i), _mm_loadu_ps(pts_b + 2 * i));
+        __m128 hi = _mm_sub_ps(_mm_loadu_ps(pts_a + 2 * i + 4), _mm_loadu_ps(pts_b + 2 * i + 4));
+        lo = _mm_mul_ps(lo, lo);
+        hi = _mm_mul_ps(hi, hi);
+        __m128 dx2 = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 dy2 = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        acc = _mm_add_ps(acc, _mm_sqrt_ps(_mm_add_ps(dx2, dy2)));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    sum = _mm_cvtss_f32(acc);
+    return i;
+}
+
+#elif defined(VIO_PARALLAX_NEON)
+
+// Four pairs per iteration; vld2q de-interleaves x/y directly
+size_t point_distances_simd(const float* pts_a, const float* pts_b, size_t count, float& sum) {
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t a = vld2q_f32(pts_a + 2 * i);
+        float32x4x2_t b = vld2q_f32(pts_b + 2 * i);
+        float32x4_t dx = vsubq_f32(a.val[0], b.val[0]);
+        float32x4_t dy = vsubq_f32(a.val[1], b.val[1]);
+        acc = vaddq_f32(acc, vsqrtq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy))));
+    }
+    sum = vaddvq_f32(acc);
+    return i;
+}
+
+#endif
+
+} // namespace
+
+float sum_point_distances(const float* pts_a, const float* pts_b, size_t count) {
+    size_t done = 0;
+    float sum = 0.0f;
+#if defined(VIO_PARALLAX_AVX2) || defined(VIO_PARALLAX_SSE2) || defined(VIO_PARALLAX_NEON)
+    done = point_distances_simd(pts_a, pts_b, count, sum);
+#endif
+    return sum + point_distances_tail(pts_a, pts_b, done, count);
+}
+
+float sum_point_distances_scalar(const float* pts_a, const float* pts_b, size_t count) {
+    return point_distances_tail(pts_a, pts_b, 0, count);
+}
+
+const char* parallax_kernel_backend() {
+#if defined(VIO_PARALLAX_AVX2)
+    return "avx2";
+#elif defined(VIO_PARALLAX_SSE2)
+    return "sse2";
+#elif defined(VIO_PARALLAX_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace lightweight_vio
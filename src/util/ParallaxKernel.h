@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace lightweight_vio {
+
+// Sum of the Euclidean distances |a[i] - b[i]| over n point pairs.
+//   pts_a, pts_b : interleaved x,y pairs (a std::vector<cv::Point2f>'s data() works as-is)
+// Uses AVX2 / SSE2 / NEON when available, scalar otherwise; the backends only
+// differ in summation order.
+float sum_point_distances(const float* pts_a, const float* pts_b, size_t count);
+
+// Plain C++ reference, always available (used for verification and benchmarking)
+float sum_point_distances_scalar(const float* pts_a, const float* pts_b, size_t count);
+
+// Name of the backend sum_point_distances dispatches to
+const char* parallax_kernel_backend();
+
+} // namespace lightweight_vio
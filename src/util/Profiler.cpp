@@ -0,0 +1,264 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace lightweight_vio {
+
+const char* to_string(ProfileCounter counter) {
+    switch (counter) {
+        case ProfileCounter::FeaturesTracked: return "features_tracked";
+        case ProfileCounter::FeaturesRejected: return "features_rejected";
+        case ProfileCounter::FeaturesExtracted: return "features_extracted";
+        case ProfileCounter::StereoMatches: return "stereo_matches";
+        case ProfileCounter::ForwardBackwardRejected: return "forward_backward_rejected";
+        case ProfileCounter::RansacIterations: return "ransac_iterations";
+        case ProfileCounter::StereoReused: return "stereo_reused";
+        case ProfileCounter::DenseDepths: return "dense_depths";
+        case ProfileCounter::Keyframes: return "keyframes";
+        case ProfileCounter::PnpRansacIterations: return "pnp_ransac_iterations";
+        default: return "unknown";
+    }
+}
+
+void write_json_string(std::ostream& os, const std::string& value) {
+    os << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    const char* hex = "0123456789abcdef";
+                    os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value_ns) {
+    if (value_ns < SUB_BUCKETS) {
+        return static_cast<size_t>(value_ns);
+    }
+    int msb = 63 - __builtin_clzll(value_ns);
+    int shift = msb - SUB_BUCKET_BITS;
+    size_t mantissa = static_cast<size_t>(value_ns >> shift) - SUB_BUCKETS;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + mantissa;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    uint64_t mantissa = SUB_BUCKETS + index % SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::add(uint64_t value_ns) {
+    m_buckets[bucket_index(value_ns)]++;
+    m_count++;
+    m_sum_ns += value_ns;
+    m_max_ns = std::max(m_max_ns, value_ns);
+}
+
+uint64_t LatencyHistogram::value_at_percentile(double q) const {
+    if (m_count == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * m_count + 0.5));
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < m_buckets.size(); ++i) {
+        cumulative += m_buckets[i];
+        if (cumulative >= rank) {
+            return std::min(bucket_upper_bound(i), m_max_ns);
+        }
+    }
+    return m_max_ns;
+}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+Profiler::Profiler()
+    : m_next_thread_id(0)
+    , m_trace_capacity(1 << 18)
+    , m_origin_ns(now_ns())
+{
+    for (auto& counter : m_counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Hands the thread's ring back when the thread exits, so a process that keeps
+// starting threads reuses rings instead of adding one per thread
+class Profiler::ThreadBuffer {
+public:
+    ~ThreadBuffer() {
+        if (buffer) Profiler::instance().release_buffer(buffer);
+    }
+
+    ProfileRingBuffer* buffer = nullptr;
+};
+
+ProfileRingBuffer& Profiler::local_buffer() {
+    // Buffers are owned by the profiler so events survive their thread
+    thread_local ProfileRingBuffer* buffer = nullptr;
+    if (!buffer) {
+        thread_local ThreadBuffer owner;
+        std::lock_guard<std::mutex> lock(m_registry_mutex);
+        const uint32_t thread_id = m_next_thread_id++;
+        if (!m_free_buffers.empty()) {
+            // Events the last owner left behind keep its id and are drained as usual
+            buffer = m_free_buffers.back();
+            m_free_buffers.pop_back();
+            buffer->set_thread_id(thread_id);
+        } else {
+            m_buffers.push_back(std::make_unique<ProfileRingBuffer>(thread_id));
+            buffer = m_buffers.back().get();
+        }
+        owner.buffer = buffer;
+    }
+    return *buffer;
+}
+
+void Profiler::release_buffer(ProfileRingBuffer* buffer) {
+    std::lock_guard<std::mutex> lock(m_registry_mutex);
+    m_free_buffers.push_back(buffer);
+}
+
+void Profiler::collect() {
+    std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+
+    std::vector<ProfileRingBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_registry_mutex);
+        for (auto& buffer : m_buffers) buffers.push_back(buffer.get());
+    }
+
+    for (auto* buffer : buffers) {
+        buffer->drain([this](const ProfileEvent& event) {
+            auto it = m_histograms.find(event.name);
+            if (it == m_histograms.end()) {
+                m_stage_order.push_back(event.name);
+                it = m_histograms.emplace(event.name, LatencyHistogram()).first;
+            }
+            it->second.add(event.duration_ns);
+
+            if (m_trace_events.size() < m_trace_capacity) {
+                m_trace_events.push_back(event);
+            }
+        });
+    }
+}
+
+void Profiler::reset() {
+    collect();
+    std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+    m_stage_order.clear();
+    m_histograms.clear();
+    m_trace_events.clear();
+    m_origin_ns = now_ns();
+    for (auto& counter : m_counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::set_trace_capacity(size_t capacity) {
+    std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+    m_trace_capacity = capacity;
+    if (m_trace_events.size() > capacity) {
+        m_trace_events.resize(capacity);
+    }
+}
+
+std::vector<ProfileStats> Profiler::get_stats() {
+    collect();
+    std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+
+    std::vector<ProfileStats> stats;
+    for (const auto& name : m_stage_order) {
+        const LatencyHistogram& histogram = m_histograms.at(name);
+        stats.push_back(ProfileStats{
+            name,
+            histogram.get_count(),
+            histogram.get_mean_ns() * 1e-6,
+            histogram.value_at_percentile(0.50) * 1e-6,
+            histogram.value_at_percentile(0.95) * 1e-6,
+            histogram.value_at_percentile(0.99) * 1e-6,
+            histogram.get_max_ns() * 1e-6});
+    }
+    return stats;
+}
+
+uint64_t Profiler::get_dropped_events() const {
+    std::lock_guard<std::mutex> lock(m_registry_mutex);
+    uint64_t dropped = 0;
+    for (const auto& buffer : m_buffers) dropped += buffer->get_dropped();
+    return dropped;
+}
+
+void Profiler::write_stats_json(std::ostream& os) {
+    std::vector<ProfileStats> stats = get_stats();
+
+    os << "{\"stages\": {";
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const ProfileStats& s = stats[i];
+        os << (i ? ", " : "");
+        write_json_string(os, s.name);
+        os << ": {"
+           << "\"count\": " << s.count
+           << ", \"mean_ms\": " << s.mean_ms
+           << ", \"p50_ms\": " << s.p50_ms
+           << ", \"p95_ms\": " << s.p95_ms
+           << ", \"p99_ms\": " << s.p99_ms
+           << ", \"max_ms\": " << s.max_ms
+           << "}";
+    }
+    os << "}, \"counters\": {";
+    for (int i = 0; i < static_cast<int>(ProfileCounter::Count); ++i) {
+        ProfileCounter counter = static_cast<ProfileCounter>(i);
+        os << (i ? ", " : "") << "\"" << to_string(counter) << "\": " << get_counter(counter);
+    }
+    os << "}, \"dropped_events\": " << get_dropped_events() << "}";
+}
+
+bool Profiler::write_chrome_trace(const std::string& path) {
+    collect();
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> collect_lock(m_collect_mutex);
+
+    // Chrome trace event format (chrome://tracing, ui.perfetto.dev): complete events in microseconds
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < m_trace_events.size(); ++i) {
+        const ProfileEvent& event = m_trace_events[i];
+        double ts_us = event.start_ns >= m_origin_ns ? (event.start_ns - m_origin_ns) * 1e-3 : 0.0;
+        out << (i ? ",\n" : "") << "{\"name\": ";
+        write_json_string(out, event.name);
+        out << ", \"ph\": \"X\", \"pid\": 1"
+            << ", \"tid\": " << event.thread_id
+            << ", \"ts\": " << ts_us
+            << ", \"dur\": " << event.duration_ns * 1e-3 << "}";
+    }
+    out << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {";
+    for (int i = 0; i < static_cast<int>(ProfileCounter::Count); ++i) {
+        ProfileCounter counter = static_cast<ProfileCounter>(i);
+        out << (i ? ", " : "") << "\"" << to_string(counter) << "\": " << get_counter(counter);
+    }
+    out << "}}\n";
+    return true;
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lightweight_vio {
+
+enum class ProfileCounter : int {
+    FeaturesTracked = 0,
+    FeaturesRejected,
+    FeaturesExtracted,
+    StereoMatches,
+    ForwardBackwardRejected,
+    RansacIterations,
+    StereoReused,
+    DenseDepths,
+    Keyframes,
+    PnpRansacIterations,
+    Count
+};
+
+const char* to_string(ProfileCounter counter);
+
+// Writes value as a quoted JSON string, escaping quotes, backslashes and
+// control characters (shared by the stats / trace writers and bench_euroc)
+void write_json_string(std::ostream& os, const std::string& value);
+
+struct ProfileEvent {
+    const char* name;      // Static string literal, never owned
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t thread_id;
+};
+
+// Lock-free single-producer/single-consumer ring. The owning thread pushes,
+// Profiler::collect() drains. Events are dropped (and counted) when full.
+class ProfileRingBuffer {
+public:
+    static constexpr size_t CAPACITY = 1 << 14;
+
+    explicit ProfileRingBuffer(uint32_t thread_id) : m_thread_id(thread_id) {}
+
+    bool push(const ProfileEvent& event) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == CAPACITY) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_events[head & (CAPACITY - 1)] = event;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    template<typename Consumer>
+    size_t drain(Consumer&& consumer) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+        for (size_t i = tail; i != head; ++i) {
+            consumer(m_events[i & (CAPACITY - 1)]);
+        }
+        m_tail.store(head, std::memory_order_release);
+        return head - tail;
+    }
+
+    uint32_t get_thread_id() const { return m_thread_id; }
+    // Only while no thread owns the ring (see Profiler::local_buffer)
+    void set_thread_id(uint32_t thread_id) { m_thread_id = thread_id; }
+    uint64_t get_dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    uint32_t m_thread_id;
+    std::array<ProfileEvent, CAPACITY> m_events;
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::atomic<uint64_t> m_dropped{0};
+};
+
+// Log-linear latency histogram: 16 sub-buckets per power of two (~6% resolution)
+class LatencyHistogram {
+public:
+    LatencyHistogram() : m_buckets(NUM_BUCKETS, 0) {}
+
+    void add(uint64_t value_ns);
+    uint64_t get_count() const { return m_count; }
+    double get_mean_ns() const { return m_count ? static_cast<double>(m_sum_ns) / m_count : 0.0; }
+    uint64_t get_max_ns() const { return m_max_ns; }
+    uint64_t value_at_percentile(double q) const;
+    const std::vector<uint64_t>& get_buckets() const { return m_buckets; }
+    static uint64_t bucket_upper_bound(size_t index);
+
+private:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t bucket_index(uint64_t value_ns);
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count = 0;
+    uint64_t m_sum_ns = 0;
+    uint64_t m_max_ns = 0;
+};
+
+struct ProfileStats {
+    std::string name;
+    uint64_t count;
+    double mean_ms;
+    double p50_ms;
+    double p95_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+// Process-wide profiler. Scoped timers push into per-thread rings without
+// locking; collect() folds them into histograms and a bounded trace buffer.
+class Profiler {
+public:
+    static Profiler& instance();
+
+    static uint64_t now_ns() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void record(const char* name, uint64_t start_ns, uint64_t duration_ns) {
+        ProfileRingBuffer& buffer = local_buffer();
+        buffer.push(ProfileEvent{name, start_ns, duration_ns, buffer.get_thread_id()});
+    }
+    void add_counter(ProfileCounter counter, int64_t value) {
+        m_counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+    int64_t get_counter(ProfileCounter counter) const {
+        return m_counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    // Drain all thread rings. Call periodically (e.g. once per frame).
+    void collect();
+    void reset();
+
+    // Keep at most this many raw events for trace export (0 = histograms only)
+    void set_trace_capacity(size_t capacity);
+
+    std::vector<ProfileStats> get_stats();
+    uint64_t get_dropped_events() const;
+    void write_stats_json(std::ostream& os);
+    bool write_chrome_trace(const std::string& path);
+
+private:
+    class ThreadBuffer;
+
+    Profiler();
+    ProfileRingBuffer& local_buffer();
+    void release_buffer(ProfileRingBuffer* buffer);
+
+    mutable std::mutex m_registry_mutex;
+    std::vector<std::unique_ptr<ProfileRingBuffer>> m_buffers;
+    std::vector<ProfileRingBuffer*> m_free_buffers;  // Rings of exited threads, still drained
+    uint32_t m_next_thread_id;
+
+    std::mutex m_collect_mutex;
+    std::vector<std::string> m_stage_order;
+    std::unordered_map<std::string, LatencyHistogram> m_histograms;
+    std::vector<ProfileEvent> m_trace_events;
+    size_t m_trace_capacity;
+    uint64_t m_origin_ns;
+
+    std::array<std::atomic<int64_t>, static_cast<size_t>(ProfileCounter::Count)> m_counters;
+};
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : m_name(name), m_start_ns(Profiler::now_ns()) {}
+    ~ScopedTimer() { Profiler::instance().record(m_name, m_start_ns, Profiler::now_ns() - m_start_ns); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start_ns;
+};
+
+} // namespace lightweight_vio
+
+// Build with -DLIGHTWEIGHT_VIO_PROFILING=OFF to compile every probe out
+#ifdef LIGHTWEIGHT_VIO_ENABLE_PROFILING
+#define VIO_PROFILE_CONCAT_INNER(a, b) a##b
+#define VIO_PROFILE_CONCAT(a, b) VIO_PROFILE_CONCAT_INNER(a, b)
+#define VIO_PROFILE_SCOPE(name) \
+    ::lightweight_vio::ScopedTimer VIO_PROFILE_CONCAT(vio_scoped_timer_, __LINE__)(name)
+#define VIO_PROFILE_COUNTER(counter, value) \
+    ::lightweight_vio::Profiler::instance().add_counter(::lightweight_vio::ProfileCounter::counter, (value))
+#else
+#define VIO_PROFILE_SCOPE(name) ((void)0)
+#define VIO_PROFILE_COUNTER(counter, value) ((void)sizeof(value))  // Not evaluated
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Bounded lock-free single-producer/single-consumer queue. The blocking
+// push()/pop() spin, then yield, then nap, so a full queue back-pressures
+// the producer without a mutex on the hot path.
+template<typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(size_t capacity)
+        : m_slots(capacity + 1)
+        , m_head(0)
+        , m_tail(0)
+        , m_closed(false)
+    {
+    }
+
+    SPSCQueue(const SPSCQueue&) = delete;
+    SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+    // Producer side
+    bool try_push(T& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t next = increment(tail);
+        if (next == m_head.load(std::memory_order_acquire)) {
+            return false; // Full
+        }
+        m_slots[tail] = std::move(item);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Blocks while full. Returns false if the queue was closed.
+    bool push(T item) {
+        Backoff backoff;
+        while (!try_push(item)) {
+            if (is_closed()) return false;
+            backoff.wait();
+        }
+        return true;
+    }
+
+    // Consumer side
+    bool try_pop(T& item) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false; // Empty
+        }
+        item = std::move(m_slots[head]);
+        m_slots[head] = T();
+        m_head.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    // Blocks while empty. Returns false once the queue is closed and drained.
+    bool pop(T& item) {
+        Backoff backoff;
+        while (!try_pop(item)) {
+            if (is_closed()) {
+                return try_pop(item);
+            }
+            backoff.wait();
+        }
+        return true;
+    }
+
+    // Either side: no more items will be pushed
+    void close() { m_closed.store(true, std::memory_order_release); }
+    bool is_closed() const { return m_closed.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return m_slots.size() - 1; }
+    size_t size_approx() const {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        return tail >= head ? tail - head : tail + m_slots.size() - head;
+    }
+
+private:
+    class Backoff {
+    public:
+        void wait() {
+            if (m_count < 64) {
+                // Busy-spin briefly: the other side is usually mid-frame
+            } else if (m_count < 1024) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+            m_count++;
+        }
+    private:
+        int m_count = 0;
+    };
+
+    size_t increment(size_t index) const { return (index + 1 == m_slots.size()) ? 0 : index + 1; }
+
+    std::vector<T> m_slots;
+    alignas(64) std::atomic<size_t> m_head;   // Next slot to pop (written by consumer)
+    alignas(64) std::atomic<size_t> m_tail;   // Next slot to fill (written by producer)
+    alignas(64) std::atomic<bool> m_closed;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,212 @@
+#include "ScanlineStereo.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VIO_SCANLINE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VIO_SCANLINE_NEON 1
+#endif
+
+namespace lightweight_vio {
+
+namespace {
+
+constexpr int PATCH_COLS = 16;
+constexpr int HALF_COLS = PATCH_COLS / 2;
+constexpr int MAX_PATCH_ROWS = 15;
+constexpr int MAX_DISPARITY = 255;
+
+// SAD between the stored left patch and the right patch starting at right
+struct ScalarSad {
+    const uchar* left;
+    size_t left_step;
+    int rows;
+
+    void load(const uchar* left_patch, size_t step, int patch_rows) {
+        left = left_patch;
+        left_step = step;
+        rows = patch_rows;
+    }
+
+    uint32_t sad(const uchar* right, size_t right_step) const {
+        uint32_t sum = 0;
+        for (int r = 0; r < rows; ++r) {
+            const uchar* a = left + r * left_step;
+            const uchar* b = right + r * right_step;
+            for (int c = 0; c < PATCH_COLS; ++c) {
+                sum += static_cast<uint32_t>(std::abs(static_cast<int>(a[c]) - static_cast<int>(b[c])));
+            }
+        }
+        return sum;
+    }
+};
+
+#if defined(VIO_SCANLINE_SSE2)
+// One PSADBW per patch row; the left rows stay in registers across disparities
+struct SimdSad {
+    __m128i left[MAX_PATCH_ROWS];
+    int rows;
+
+    void load(const uchar* left_patch, size_t step, int patch_rows) {
+        rows = patch_rows;
+        for (int r = 0; r < rows; ++r) {
+            left[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(left_patch + r * step));
+        }
+    }
+
+    uint32_t sad(const uchar* right, size_t right_step) const {
+        __m128i acc = _mm_setzero_si128();
+        for (int r = 0; r < rows; ++r) {
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + r * right_step));
+            acc = _mm_add_epi64(acc, _mm_sad_epu8(left[r], b));
+        }
+        return static_cast<uint32_t>(_mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(acc, acc)));
+    }
+};
+#elif defined(VIO_SCANLINE_NEON)
+struct SimdSad {
+    uint8x16_t left[MAX_PATCH_ROWS];
+    int rows;
+
+    void load(const uchar* left_patch, size_t step, int patch_rows) {
+        rows = patch_rows;
+        for (int r = 0; r < rows; ++r) {
+            left[r] = vld1q_u8(left_patch + r * step);
+        }
+    }
+
+    uint32_t sad(const uchar* right, size_t right_step) const {
+        // 16-bit lanes hold at most 2 * 255 * MAX_PATCH_ROWS
+        uint16x8_t acc = vdupq_n_u16(0);
+        for (int r = 0; r < rows; ++r) {
+            acc = vpadalq_u8(acc, vabdq_u8(left[r], vld1q_u8(right + r * right_step)));
+        }
+        return vaddlvq_u16(acc);
+    }
+};
+#endif
+
+template<typename Sad>
+void match_points(const cv::Mat& left, const cv::Mat& right, const cv::Point2f* left_pts, size_t count,
+                  const ScanlineStereoParams& params, cv::Point2f* right_pts, float* disparities, uchar* status,
+                  const float* disparity_priors) {
+    const int patch_rows = std::min(MAX_PATCH_ROWS, std::max(1, params.patch_rows | 1));
+    const int half_rows = patch_rows / 2;
+    const int min_disparity = std::max(0, params.min_disparity);
+    const int search_limit = std::min(MAX_DISPARITY, params.max_disparity);
+    const uint32_t max_cost = static_cast<uint32_t>(params.max_mean_cost * PATCH_COLS * patch_rows);
+    const size_t left_step = left.step[0], right_step = right.step[0];
+    const bool same_size = left.size() == right.size();
+    uint32_t costs[MAX_DISPARITY + 1];
+
+    Sad sad;
+    const uchar* right_row = nullptr;
+    int max_disparity = 0;
+
+    // Best disparity in [lo, hi]. A window around a prior must contain the
+    // minimum strictly inside; the full range must have a unique minimum.
+    auto search = [&](int lo, int hi, bool windowed, float& disparity) {
+        int best = lo;
+        for (int d = lo; d <= hi; ++d) {
+            costs[d] = sad.sad(right_row - d, right_step);
+            if (costs[d] < costs[best]) best = d;
+        }
+        if (costs[best] > max_cost) return false;
+
+        if (windowed) {
+            if ((best == lo && lo > min_disparity) || (best == hi && hi < max_disparity)) return false;
+        } else {
+            // Uniqueness against the best cost outside the minimum's +-1 basin
+            uint32_t second = std::numeric_limits<uint32_t>::max();
+            for (int d = lo; d <= hi; ++d) {
+                if (std::abs(d - best) > 1) second = std::min(second, costs[d]);
+            }
+            if (second != std::numeric_limits<uint32_t>::max() &&
+                static_cast<float>(costs[best]) > params.uniqueness_ratio * static_cast<float>(second)) {
+                return false;
+            }
+        }
+
+        // Equiangular fit, which suits the V-shaped SAD minimum better than a parabola
+        float delta = 0.0f;
+        if (best > lo && best < hi) {
+            const float c_minus = static_cast<float>(costs[best - 1]);
+            const float c_zero = static_cast<float>(costs[best]);
+            const float c_plus = static_cast<float>(costs[best + 1]);
+            const float denominator = 2.0f * (std::max(c_minus, c_plus) - c_zero);
+            if (denominator > 0.0f) delta = (c_minus - c_plus) / denominator;
+        }
+        disparity = static_cast<float>(best) + delta;
+        return true;
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        status[i] = 0;
+        right_pts[i] = left_pts[i];
+        disparities[i] = -1.0f;
+
+        const float x = left_pts[i].x, y = left_pts[i].y;
+        if (!same_size || !(x >= 0.0f && y >= 0.0f)) continue;
+        const int x0 = static_cast<int>(std::lround(x)), y0 = static_cast<int>(std::lround(y));
+        if (y0 - half_rows < 0 || y0 + half_rows >= left.rows || x0 - HALF_COLS < 0 || x0 + HALF_COLS > left.cols) {
+            continue;
+        }
+        max_disparity = std::min(search_limit, x0 - HALF_COLS);
+        if (max_disparity < min_disparity) continue;
+
+        sad.load(left.ptr<uchar>(y0 - half_rows) + x0 - HALF_COLS, left_step, patch_rows);
+        right_row = right.ptr<uchar>(y0 - half_rows) + x0 - HALF_COLS;
+
+        float disparity = -1.0f;
+        bool found = false;
+        if (disparity_priors && disparity_priors[i] >= 0.0f) {
+            const int center = static_cast<int>(std::lround(disparity_priors[i]));
+            const int lo = std::max(min_disparity, center - params.prior_radius);
+            const int hi = std::min(max_disparity, center + params.prior_radius);
+            found = lo <= hi && search(lo, hi, true, disparity);
+        }
+        if (!found) {
+            found = search(min_disparity, max_disparity, false, disparity);
+        }
+        if (!found) continue;
+
+        right_pts[i] = cv::Point2f(x - disparity, y);
+        disparities[i] = disparity;
+        status[i] = 1;
+    }
+}
+
+} // namespace
+
+void scanline_stereo_match(const cv::Mat& left, const cv::Mat& right, const cv::Point2f* left_pts, size_t count,
+                           const ScanlineStereoParams& params, cv::Point2f* right_pts, float* disparities,
+                           uchar* status, const float* disparity_priors) {
+#if defined(VIO_SCANLINE_SSE2) || defined(VIO_SCANLINE_NEON)
+    match_points<SimdSad>(left, right, left_pts, count, params, right_pts, disparities, status, disparity_priors);
+#else
+    match_points<ScalarSad>(left, right, left_pts, count, params, right_pts, disparities, status, disparity_priors);
+#endif
+}
+
+void scanline_stereo_match_scalar(const cv::Mat& left, const cv::Mat& right, const cv::Point2f* left_pts,
+                                  size_t count, const ScanlineStereoParams& params, cv::Point2f* right_pts,
+                                  float* disparities, uchar* status, const float* disparity_priors) {
+    match_points<ScalarSad>(left, right, left_pts, count, params, right_pts, disparities, status, disparity_priors);
+}
+
+const char* scanline_stereo_backend() {
+#if defined(VIO_SCANLINE_SSE2)
+    return "sse2";
+#elif defined(VIO_SCANLINE_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace lightweight_vio
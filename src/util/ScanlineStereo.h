@@ -0,0 +1,40 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+
+namespace lightweight_vio {
+
+struct ScanlineStereoParams {
+    int min_disparity = 1;
+    int max_disparity = 96;         // At most 255
+    int patch_rows = 9;             // Odd, at most 15; the patch is 16 columns wide
+    float max_mean_cost = 16.0f;    // Reject when the best SAD per pixel exceeds this
+    float uniqueness_ratio = 0.9f;  // Reject when best > ratio * best cost more than 1 px away
+    int prior_radius = 2;           // Search half-width around a disparity prior
+};
+
+// Stereo matching on rectified 8-bit images: for each left point a 1D search
+// along the same row of the right image, minimizing the SAD of a 16 x patch_rows
+// patch, with equiangular (V-shaped) sub-pixel interpolation of the SAD curve.
+//   right_pts   : (x - disparity, y)
+//   disparities : sub-pixel disparity (px)
+//   status      : 1 where a unique, low-cost match was found
+//   disparity_priors (optional, < 0 = none): e.g. the previous frame's disparity.
+//     Only prior +- prior_radius is searched, and the minimum must lie inside
+//     that window instead of passing the uniqueness test; otherwise the point
+//     falls back to the full range.
+// Uses SSE2 (PSADBW) / NEON when available; all backends give identical results.
+void scanline_stereo_match(const cv::Mat& left, const cv::Mat& right, const cv::Point2f* left_pts, size_t count,
+                           const ScanlineStereoParams& params, cv::Point2f* right_pts, float* disparities,
+                           uchar* status, const float* disparity_priors = nullptr);
+
+// Plain C++ reference (used for verification and benchmarking)
+void scanline_stereo_match_scalar(const cv::Mat& left, const cv::Mat& right, const cv::Point2f* left_pts,
+                                  size_t count, const ScanlineStereoParams& params, cv::Point2f* right_pts,
+                                  float* disparities, uchar* status, const float* disparity_priors = nullptr);
+
+// Name of the backend scanline_stereo_match dispatches to
+const char* scanline_stereo_backend();
+
+} // namespace lightweight_vio
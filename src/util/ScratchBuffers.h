@@ -0,0 +1,82 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Reusable transient buffers for one frontend pass (LK outputs, point subsets,
+// masks). Passes clear() and refill them; capacity is kept, so once the buffers
+// have grown to the working-set size the hot paths stop allocating.
+// Not thread-safe: each thread/owner keeps its own instance.
+struct ScratchBuffers {
+    std::vector<cv::Point2f> tracked_points;  // LK output points
+    std::vector<uchar> status;                // LK status
+    std::vector<float> err;                   // LK error
+    std::vector<cv::Point2f> predicted_points; // Motion-model LK seeds
+    std::vector<uchar> retry_status;          // Full-depth LK retry of lost points
+    std::vector<float> retry_err;
+    std::vector<cv::Point2f> back_points;     // Backward LK output (forward-backward check)
+    std::vector<uchar> back_status;
+    std::vector<float> back_err;
+    std::vector<cv::Point2f> points_a;        // Gathered correspondences
+    std::vector<cv::Point2f> points_b;
+    std::vector<cv::Point2f> query_points;    // Gathered subset of a point column
+    std::vector<size_t> indices;              // Store slot of each gathered correspondence
+    std::vector<size_t> match_indices;        // Previous-frame slot of each tracked slot
+    std::vector<int> priorities;              // RANSAC sampling order (track length)
+    std::vector<float> residuals;             // Per-slot errors (e.g. epipolar)
+    std::vector<uchar> inlier_mask;           // RANSAC output
+    std::vector<uchar> keep_mask;             // Compaction mask
+    std::vector<cv::Point2f> corners;         // Detector output
+    cv::Mat mask;                             // Detection mask image
+
+    // Size every per-point buffer for `points` points up front, so that no
+    // pass reallocates after the first frame at full feature count
+    void reserve(size_t points) {
+        tracked_points.reserve(points);
+        status.reserve(points);
+        err.reserve(points);
+        predicted_points.reserve(points);
+        retry_status.reserve(points);
+        retry_err.reserve(points);
+        back_points.reserve(points);
+        back_status.reserve(points);
+        back_err.reserve(points);
+        points_a.reserve(points);
+        points_b.reserve(points);
+        query_points.reserve(points);
+        indices.reserve(points);
+        match_indices.reserve(points);
+        priorities.reserve(points);
+        residuals.reserve(points);
+        inlier_mask.reserve(points);
+        keep_mask.reserve(points);
+        corners.reserve(points);
+    }
+
+    void clear() {
+        tracked_points.clear();
+        status.clear();
+        err.clear();
+        predicted_points.clear();
+        retry_status.clear();
+        retry_err.clear();
+        back_points.clear();
+        back_status.clear();
+        back_err.clear();
+        points_a.clear();
+        points_b.clear();
+        query_points.clear();
+        indices.clear();
+        match_indices.clear();
+        priorities.clear();
+        residuals.clear();
+        inlier_mask.clear();
+        keep_mask.clear();
+        corners.clear();
+    }
+};
+
+} // namespace lightweight_vio
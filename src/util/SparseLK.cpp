@@ -0,0 +1,479 @@
+#include "SparseLK.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VIO_SPARSE_LK_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define VIO_SPARSE_LK_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VIO_SPARSE_LK_NEON 1
+#endif
+
+namespace lightweight_vio {
+
+namespace {
+
+// Same fixed-point layout as OpenCV's LK: 14-bit bilinear weights, window
+// intensities with 5 fractional bits, Scharr derivatives at full scale
+constexpr int W_BITS = 14;
+constexpr int INTENSITY_SHIFT = W_BITS - 5;
+constexpr float FLT_SCALE = 1.0f / (1 << 20);
+constexpr int MAX_LEVELS = 16;  // Coarser levels of a deeper pyramid are not used
+
+// Per-row sums stay within int32 (|diff| <= 255 * 32, |Scharr| <= 16 * 255,
+// at most 31 products per lane); rows are accumulated in int64
+
+struct PlaneView {
+    const uchar* data;
+    ptrdiff_t step;
+    int cols;
+    int rows;
+    // Valid for x/y inside the pyramid border as well
+    const uchar* at(int x, int y) const { return data + y * step + x; }
+};
+
+struct DerivView {
+    const short* data;
+    ptrdiff_t step;  // In shorts
+    const short* at(int x, int y) const { return data + y * step + 2 * x; }
+};
+
+struct PyramidLevel {
+    PlaneView prev;
+    DerivView prev_deriv;
+    PlaneView next;
+};
+
+struct Weights {
+    int w00, w01, w10, w11;
+};
+
+inline Weights bilinear_weights(float a, float b) {
+    Weights w;
+    w.w00 = cvRound((1.0f - a) * (1.0f - b) * (1 << W_BITS));
+    w.w01 = cvRound(a * (1.0f - b) * (1 << W_BITS));
+    w.w10 = cvRound((1.0f - a) * b * (1 << W_BITS));
+    w.w11 = (1 << W_BITS) - w.w00 - w.w01 - w.w10;
+    return w;
+}
+
+// Lane backends. Each provides LANES int32 lanes with the handful of
+// operations the window loops need.
+
+struct ScalarLanes {
+    static constexpr int LANES = 1;
+    using Reg = int32_t;
+    static Reg zero() { return 0; }
+    static Reg set1(int32_t v) { return v; }
+    static Reg load_u8(const uchar* p) { return *p; }
+    static void load_deriv(const short* p, Reg& dx, Reg& dy) { dx = p[0]; dy = p[1]; }
+    static Reg load(const int32_t* p) { return *p; }
+    static void store(int32_t* p, Reg v) { *p = v; }
+    static Reg add(Reg a, Reg b) { return a + b; }
+    static Reg sub(Reg a, Reg b) { return a - b; }
+    static Reg mul(Reg a, Reg b) { return a * b; }
+    template<int N> static Reg shift_right(Reg v) { return v >> N; }
+    static Reg bit_and(Reg a, Reg b) { return a & b; }
+    static Reg keep_from(int) { return -1; }
+    static int64_t sum(Reg v) { return v; }
+};
+
+#if defined(VIO_SPARSE_LK_AVX2)
+
+struct SimdLanes {
+    static constexpr int LANES = 8;
+    using Reg = __m256i;
+    static Reg zero() { return _mm256_setzero_si256(); }
+    static Reg set1(int32_t v) { return _mm256_set1_epi32(v); }
+    static Reg load_u8(const uchar* p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+    // (dx, dy) int16 pairs: dx is the low half of each 32-bit lane
+    static void load_deriv(const short* p, Reg& dx, Reg& dy) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        dx = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+        dy = _mm256_srai_epi32(v, 16);
+    }
+    static Reg load(const int32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(int32_t* p, Reg v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Reg add(Reg a, Reg b) { return _mm256_add_epi32(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm256_sub_epi32(a, b); }
+    static Reg mul(Reg a, Reg b) { return _mm256_mullo_epi32(a, b); }
+    template<int N> static Reg shift_right(Reg v) { return _mm256_srai_epi32(v, N); }
+    static Reg bit_and(Reg a, Reg b) { return _mm256_and_si256(a, b); }
+    // All-ones in lanes >= lane
+    static Reg keep_from(int lane) {
+        return _mm256_cmpgt_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(lane - 1));
+    }
+    static int64_t sum(Reg v) {
+        __m256i wide = _mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)),
+                                        _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+        return _mm_cvtsi128_si64(half) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(half, half));
+    }
+};
+
+#elif defined(VIO_SPARSE_LK_SSE2)
+
+struct SimdLanes {
+    static constexpr int LANES = 4;
+    using Reg = __m128i;
+    static Reg zero() { return _mm_setzero_si128(); }
+    static Reg set1(int32_t v) { return _mm_set1_epi32(v); }
+    static Reg load_u8(const uchar* p) {
+        int32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+        return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+    }
+    static void load_deriv(const short* p, Reg& dx, Reg& dy) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        dx = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        dy = _mm_srai_epi32(v, 16);
+    }
+    static Reg load(const int32_t* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(int32_t* p, Reg v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Reg add(Reg a, Reg b) { return _mm_add_epi32(a, b); }
+    static Reg sub(Reg a, Reg b) { return _mm_sub_epi32(a, b); }
+    static Reg mul(Reg a, Reg b) {
+#if defined(__SSE4_1__)
+        return _mm_mullo_epi32(a, b);
+#else
+        // Low 32 bits of the even and odd unsigned products (same bits as signed)
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+    }
+    template<int N> static Reg shift_right(Reg v) { return _mm_srai_epi32(v, N); }
+    static Reg bit_and(Reg a, Reg b) { return _mm_and_si128(a, b); }
+    static Reg keep_from(int lane) { return _mm_cmpgt_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(lane - 1)); }
+    static int64_t sum(Reg v) {
+        __m128i sign = _mm_srai_epi32(v, 31);
+        __m128i wide = _mm_add_epi64(_mm_unpacklo_epi32(v, sign), _mm_unpackhi_epi32(v, sign));
+        int64_t halves[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(halves), wide);
+        return halves[0] + halves[1];
+    }
+};
+
+#elif defined(VIO_SPARSE_LK_NEON)
+
+struct SimdLanes {
+    static constexpr int LANES = 4;
+    using Reg = int32x4_t;
+    static Reg zero() { return vdupq_n_s32(0); }
+    static Reg set1(int32_t v) { return vdupq_n_s32(v); }
+    static Reg load_u8(const uchar* p) {
+        uint32_t bytes;
+        std::memcpy(&bytes, p, sizeof(bytes));
+        uint16x8_t v = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bytes)));
+        return vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(v)));
+    }
+    // vld2 de-interleaves the (dx, dy) pairs directly
+    static void load_deriv(const short* p, Reg& dx, Reg& dy) {
+        int16x4x2_t d = vld2_s16(p);
+        dx = vmovl_s16(d.val[0]);
+        dy = vmovl_s16(d.val[1]);
+    }
+    static Reg load(const int32_t* p) { return vld1q_s32(p); }
+    static void store(int32_t* p, Reg v) { vst1q_s32(p, v); }
+    static Reg add(Reg a, Reg b) { return vaddq_s32(a, b); }
+    static Reg sub(Reg a, Reg b) { return vsubq_s32(a, b); }
+    static Reg mul(Reg a, Reg b) { return vmulq_s32(a, b); }
+    template<int N> static Reg shift_right(Reg v) { return vshrq_n_s32(v, N); }
+    static Reg bit_and(Reg a, Reg b) { return vandq_s32(a, b); }
+    static Reg keep_from(int lane) {
+        const int32_t lanes[4] = {0, 1, 2, 3};
+        return vreinterpretq_s32_u32(vcgtq_s32(vld1q_s32(lanes), vdupq_n_s32(lane - 1)));
+    }
+    static int64_t sum(Reg v) { return vaddlvq_s32(v); }
+};
+
+#endif
+
+// A window row is covered by CHUNKS groups of LANES columns. The last group is
+// shifted left to end at the window edge (no reads past the window); columns
+// it shares with the previous group get zero gradients, so they add nothing.
+template<int WIN, typename V>
+struct WindowLayout {
+    static_assert(WIN >= V::LANES, "window narrower than a SIMD register");
+    static constexpr int LANES = V::LANES;
+    static constexpr int CHUNKS = (WIN + LANES - 1) / LANES;
+    static constexpr int ROW = CHUNKS * LANES;
+    static constexpr int SIZE = WIN * ROW;
+    static constexpr int offset(int chunk) { return std::min(chunk * LANES, WIN - LANES); }
+    // Buffer index of window column x
+    static constexpr int index(int y, int x) {
+        int chunk = std::min(x / LANES, CHUNKS - 1);
+        return y * ROW + chunk * LANES + (x - offset(chunk));
+    }
+};
+
+// Bilinear sample of LANES consecutive pixels, before descaling
+template<typename V>
+inline typename V::Reg interpolate_u8(const uchar* p, ptrdiff_t step, const typename V::Reg w[4]) {
+    typename V::Reg v = V::mul(V::load_u8(p), w[0]);
+    v = V::add(v, V::mul(V::load_u8(p + 1), w[1]));
+    v = V::add(v, V::mul(V::load_u8(p + step), w[2]));
+    return V::add(v, V::mul(V::load_u8(p + step + 1), w[3]));
+}
+
+inline int interpolate_scalar(const uchar* p, ptrdiff_t step, const Weights& w) {
+    int v = p[0] * w.w00 + p[1] * w.w01 + p[step] * w.w10 + p[step + 1] * w.w11;
+    return (v + (1 << (INTENSITY_SHIFT - 1))) >> INTENSITY_SHIFT;
+}
+
+template<int WIN, typename V>
+void track_point(const PyramidLevel* levels, int max_level, const cv::Point2f& prev_pt, cv::Point2f& next_pt,
+                 uchar& status, float* err, const SparseLKParams& params) {
+    using Layout = WindowLayout<WIN, V>;
+    using Reg = typename V::Reg;
+    const float half_win = (WIN - 1) * 0.5f;
+    const float epsilon_sq = params.epsilon * params.epsilon;
+    const Reg intensity_round = V::set1(1 << (INTENSITY_SHIFT - 1));
+    const Reg deriv_round = V::set1(1 << (W_BITS - 1));
+
+    alignas(32) int32_t iwin[Layout::SIZE];
+    alignas(32) int32_t ixwin[Layout::SIZE];
+    alignas(32) int32_t iywin[Layout::SIZE];
+
+    status = 1;
+    cv::Point2f level_pt;  // Estimate in the current level's coordinates
+    for (int level = max_level; level >= 0; --level) {
+        const PyramidLevel& L = levels[level];
+        const float scale = 1.0f / (1 << level);
+        cv::Point2f prev = prev_pt * scale;
+        if (level == max_level) {
+            level_pt = params.use_initial_flow ? next_pt * scale : prev;
+        } else {
+            level_pt = level_pt * 2.0f;
+        }
+
+        prev.x -= half_win;
+        prev.y -= half_win;
+        const int px = cvFloor(prev.x);
+        const int py = cvFloor(prev.y);
+        if (px < -WIN || px >= L.prev.cols || py < -WIN || py >= L.prev.rows) {
+            if (level == 0) status = 0;
+            continue;
+        }
+
+        // Template window, its gradients and the structure tensor
+        const Weights pw = bilinear_weights(prev.x - px, prev.y - py);
+        const Reg w[4] = {V::set1(pw.w00), V::set1(pw.w01), V::set1(pw.w10), V::set1(pw.w11)};
+        int64_t a11 = 0, a12 = 0, a22 = 0;
+        for (int y = 0; y < WIN; ++y) {
+            const uchar* src = L.prev.at(px, py + y);
+            const short* dsrc = L.prev_deriv.at(px, py + y);
+            Reg r11 = V::zero(), r12 = V::zero(), r22 = V::zero();
+            for (int chunk = 0; chunk < Layout::CHUNKS; ++chunk) {
+                const int off = Layout::offset(chunk);
+                const int at = y * Layout::ROW + chunk * Layout::LANES;
+                Reg ival = V::template shift_right<INTENSITY_SHIFT>(
+                    V::add(interpolate_u8<V>(src + off, L.prev.step, w), intensity_round));
+
+                Reg dx00, dy00, dx01, dy01, dx10, dy10, dx11, dy11;
+                V::load_deriv(dsrc + 2 * off, dx00, dy00);
+                V::load_deriv(dsrc + 2 * (off + 1), dx01, dy01);
+                V::load_deriv(dsrc + L.prev_deriv.step + 2 * off, dx10, dy10);
+                V::load_deriv(dsrc + L.prev_deriv.step + 2 * (off + 1), dx11, dy11);
+                Reg ix = V::add(V::add(V::mul(dx00, w[0]), V::mul(dx01, w[1])),
+                                V::add(V::mul(dx10, w[2]), V::mul(dx11, w[3])));
+                Reg iy = V::add(V::add(V::mul(dy00, w[0]), V::mul(dy01, w[1])),
+                                V::add(V::mul(dy10, w[2]), V::mul(dy11, w[3])));
+                ix = V::template shift_right<W_BITS>(V::add(ix, deriv_round));
+                iy = V::template shift_right<W_BITS>(V::add(iy, deriv_round));
+                if (chunk * Layout::LANES > off) {
+                    Reg keep = V::keep_from(chunk * Layout::LANES - off);
+                    ix = V::bit_and(ix, keep);
+                    iy = V::bit_and(iy, keep);
+                }
+
+                V::store(iwin + at, ival);
+                V::store(ixwin + at, ix);
+                V::store(iywin + at, iy);
+                r11 = V::add(r11, V::mul(ix, ix));
+                r12 = V::add(r12, V::mul(ix, iy));
+                r22 = V::add(r22, V::mul(iy, iy));
+            }
+            a11 += V::sum(r11);
+            a12 += V::sum(r12);
+            a22 += V::sum(r22);
+        }
+
+        const float A11 = a11 * FLT_SCALE;
+        const float A12 = a12 * FLT_SCALE;
+        const float A22 = a22 * FLT_SCALE;
+        float D = A11 * A22 - A12 * A12;
+        float min_eig = (A22 + A11 - std::sqrt((A11 - A22) * (A11 - A22) + 4.0f * A12 * A12)) / (2 * WIN * WIN);
+        if (min_eig < params.min_eig_threshold || D < FLT_EPSILON) {
+            if (level == 0) status = 0;
+            continue;
+        }
+        D = 1.0f / D;
+
+        // Gauss-Newton on the translation
+        cv::Point2f next(level_pt.x - half_win, level_pt.y - half_win);
+        cv::Point2f prev_delta(0.0f, 0.0f);
+        for (int iteration = 0; iteration < params.max_iterations; ++iteration) {
+            const int nx = cvFloor(next.x);
+            const int ny = cvFloor(next.y);
+            if (nx < -WIN || nx >= L.next.cols || ny < -WIN || ny >= L.next.rows) {
+                if (level == 0) status = 0;
+                break;
+            }
+
+            const Weights nw = bilinear_weights(next.x - nx, next.y - ny);
+            const Reg jw[4] = {V::set1(nw.w00), V::set1(nw.w01), V::set1(nw.w10), V::set1(nw.w11)};
+            int64_t b1 = 0, b2 = 0;
+            for (int y = 0; y < WIN; ++y) {
+                const uchar* src = L.next.at(nx, ny + y);
+                Reg r1 = V::zero(), r2 = V::zero();
+                for (int chunk = 0; chunk < Layout::CHUNKS; ++chunk) {
+                    const int at = y * Layout::ROW + chunk * Layout::LANES;
+                    Reg jval = V::template shift_right<INTENSITY_SHIFT>(
+                        V::add(interpolate_u8<V>(src + Layout::offset(chunk), L.next.step, jw), intensity_round));
+                    Reg diff = V::sub(jval, V::load(iwin + at));
+                    r1 = V::add(r1, V::mul(diff, V::load(ixwin + at)));
+                    r2 = V::add(r2, V::mul(diff, V::load(iywin + at)));
+                }
+                b1 += V::sum(r1);
+                b2 += V::sum(r2);
+            }
+
+            const float B1 = b1 * FLT_SCALE;
+            const float B2 = b2 * FLT_SCALE;
+            cv::Point2f delta((A12 * B2 - A22 * B1) * D, (A12 * B1 - A11 * B2) * D);
+            next += delta;
+            level_pt = cv::Point2f(next.x + half_win, next.y + half_win);
+
+            if (delta.dot(delta) <= epsilon_sq) break;
+            if (iteration > 0 && std::abs(delta.x + prev_delta.x) < 0.01f && std::abs(delta.y + prev_delta.y) < 0.01f) {
+                // Oscillating: settle in the middle
+                level_pt.x -= delta.x * 0.5f;
+                level_pt.y -= delta.y * 0.5f;
+                break;
+            }
+            prev_delta = delta;
+        }
+    }
+    next_pt = level_pt;
+
+    if (!status || !err) return;
+
+    // Mean absolute intensity difference over the final window
+    const PlaneView& next0 = levels[0].next;
+    cv::Point2f last(next_pt.x - half_win, next_pt.y - half_win);
+    const int nx = cvFloor(last.x);
+    const int ny = cvFloor(last.y);
+    if (nx < -WIN || nx >= next0.cols || ny < -WIN || ny >= next0.rows) {
+        status = 0;
+        return;
+    }
+    const Weights nw = bilinear_weights(last.x - nx, last.y - ny);
+    int64_t total = 0;
+    for (int y = 0; y < WIN; ++y) {
+        const uchar* src = next0.at(nx, ny + y);
+        for (int x = 0; x < WIN; ++x) {
+            total += std::abs(interpolate_scalar(src + x, next0.step, nw) - iwin[Layout::index(y, x)]);
+        }
+    }
+    *err = total * (1.0f / (32 * WIN * WIN));
+}
+
+// Returns the number of levels filled (0 on a pyramid it cannot read)
+int make_levels(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& next_pyramid,
+                int max_level, PyramidLevel* levels) {
+    // cv::buildOpticalFlowPyramid with derivatives: [image, dx/dy] per level
+    const size_t prev_levels = prev_pyramid.size() / 2;
+    const size_t next_levels = next_pyramid.size() / 2;
+    if (prev_levels == 0 || next_levels == 0 || max_level < 0) return 0;
+
+    const int used = std::min<int>(std::min(max_level + 1, MAX_LEVELS),
+                                   static_cast<int>(std::min(prev_levels, next_levels)));
+    for (int level = 0; level < used; ++level) {
+        const cv::Mat& prev = prev_pyramid[2 * level];
+        const cv::Mat& deriv = prev_pyramid[2 * level + 1];
+        const cv::Mat& next = next_pyramid[2 * level];
+        if (prev.type() != CV_8UC1 || next.type() != CV_8UC1 || deriv.type() != CV_16SC2) return 0;
+        levels[level].prev = {prev.data, static_cast<ptrdiff_t>(prev.step), prev.cols, prev.rows};
+        levels[level].prev_deriv = {reinterpret_cast<const short*>(deriv.data),
+                                    static_cast<ptrdiff_t>(deriv.step / sizeof(short))};
+        levels[level].next = {next.data, static_cast<ptrdiff_t>(next.step), next.cols, next.rows};
+    }
+    return used;
+}
+
+template<typename V>
+bool track_points(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& next_pyramid,
+                  int win_size, const cv::Point2f* prev_pts, cv::Point2f* next_pts,
+                  uchar* status, float* err, size_t count, const SparseLKParams& params) {
+    PyramidLevel levels[MAX_LEVELS];
+    const int used = make_levels(prev_pyramid, next_pyramid, params.max_level, levels);
+    if (used == 0) {
+        VIO_LOG_ERROR("Sparse LK: expected 8-bit pyramids with derivatives (cv::buildOpticalFlowPyramid)");
+        return false;
+    }
+    const int max_level = used - 1;
+
+    auto run = [&](auto track) {
+        for (size_t i = 0; i < count; ++i) {
+            track(levels, max_level, prev_pts[i], next_pts[i], status[i], err ? err + i : nullptr, params);
+        }
+    };
+    switch (win_size) {
+        case 15: run(track_point<15, V>); return true;
+        case 21: run(track_point<21, V>); return true;
+        case 31: run(track_point<31, V>); return true;
+        default:
+            VIO_LOG_ERROR("Sparse LK: no kernel for a " << win_size << "px window");
+            return false;
+    }
+}
+
+} // namespace
+
+bool sparse_lk_track(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& next_pyramid,
+                     int win_size, const cv::Point2f* prev_pts, cv::Point2f* next_pts,
+                     uchar* status, float* err, size_t count, const SparseLKParams& params) {
+#if defined(VIO_SPARSE_LK_AVX2) || defined(VIO_SPARSE_LK_SSE2) || defined(VIO_SPARSE_LK_NEON)
+    return track_points<SimdLanes>(prev_pyramid, next_pyramid, win_size, prev_pts, next_pts, status, err, count, params);
+#else
+    return track_points<ScalarLanes>(prev_pyramid, next_pyramid, win_size, prev_pts, next_pts, status, err, count, params);
+#endif
+}
+
+bool sparse_lk_track_scalar(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& next_pyramid,
+                            int win_size, const cv::Point2f* prev_pts, cv::Point2f* next_pts,
+                            uchar* status, float* err, size_t count, const SparseLKParams& params) {
+    return track_points<ScalarLanes>(prev_pyramid, next_pyramid, win_size, prev_pts, next_pts, status, err, count, params);
+}
+
+bool sparse_lk_supports_window(int win_size) {
+    return win_size == 15 || win_size == 21 || win_size == 31;
+}
+
+const char* sparse_lk_backend() {
+#if defined(VIO_SPARSE_LK_AVX2)
+    return "avx2";
+#elif defined(VIO_SPARSE_LK_SSE2)
+    return "sse2";
+#elif defined(VIO_SPARSE_LK_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace lightweight_vio
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace lightweight_vio {
+
+struct SparseLKParams {
+    int max_level = 3;
+    int max_iterations = 30;
+    float epsilon = 0.01f;           // Stop when an update is shorter than this (px)
+    float min_eig_threshold = 1e-4f; // Reject windows with too little texture (as OpenCV)
+    bool use_initial_flow = false;   // next_pts holds the initial guesses
+};
+
+// Pyramidal sparse Lucas-Kanade for 8-bit grayscale images, a drop-in for
+// cv::calcOpticalFlowPyrLK on pyramids from cv::buildOpticalFlowPyramid (with
+// derivatives, border >= window). Follows OpenCV's iteration scheme; window
+// samples, gradients and the per-iteration mismatch sums are fixed point
+// (14-bit bilinear weights, 5 fractional intensity bits) with the window size
+// fixed at compile time. Uses AVX2 / SSE2 / NEON when available; all backends
+// give bit-identical results.
+//   win_size     : square window side, see sparse_lk_supports_window()
+//   status / err : as calcOpticalFlowPyrLK (err = mean abs intensity difference)
+// Returns false (outputs untouched) if the pyramids do not have this layout.
+bool sparse_lk_track(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& next_pyramid,
+                     int win_size, const cv::Point2f* prev_pts, cv::Point2f* next_pts,
+                     uchar* status, float* err, size_t count, const SparseLKParams& params);
+
+// Plain C++ reference with the same arithmetic (used for verification and benchmarking)
+bool sparse_lk_track_scalar(const std::vector<cv::Mat>& prev_pyramid, const std::vector<cv::Mat>& next_pyramid,
+                            int win_size, const cv::Point2f* prev_pts, cv::Point2f* next_pts,
+                            uchar* status, float* err, size_t count, const SparseLKParams& params);
+
+// Window sides with a compiled kernel (15, 21, 31)
+bool sparse_lk_supports_window(int win_size);
+
+// Name of the backend sparse_lk_track dispatches to
+const char* sparse_lk_backend();
+
+} // namespace lightweight_vio
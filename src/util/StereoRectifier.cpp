@@ -0,0 +1,93 @@
+#include "StereoRectifier.h"
+#include "Logger.h"
+#include "Profiler.h"
+
+namespace lightweight_vio {
+
+StereoRectifier::StereoRectifier(const StereoCamera& stereo) {
+    if (!stereo.is_valid() || stereo.left.get_image_size().area() <= 0) {
+        VIO_LOG_ERROR("Cannot rectify: stereo calibration without baseline or image size");
+        return;
+    }
+
+    // Rectified axes in the left camera frame: x along the baseline (towards the
+    // right camera), z closest to the mean optical axis, y completing the frame
+    const Eigen::Matrix3d& R = stereo.right_R_left;
+    const Eigen::Vector3d right_center = -R.transpose() * stereo.right_t_left;
+    const Eigen::Vector3d x_axis = right_center.normalized();
+    const Eigen::Vector3d mean_axis = (Eigen::Vector3d::UnitZ() + R.transpose() * Eigen::Vector3d::UnitZ()).normalized();
+    const Eigen::Vector3d y_axis = mean_axis.cross(x_axis).normalized();
+    const Eigen::Vector3d z_axis = x_axis.cross(y_axis);
+    m_rectified_R_left.row(0) = x_axis.transpose();
+    m_rectified_R_left.row(1) = y_axis.transpose();
+    m_rectified_R_left.row(2) = z_axis.transpose();
+
+    // One pinhole camera for both sides: mean focal length and principal point
+    const CameraModel& left = stereo.left;
+    const CameraModel& right = stereo.right;
+    const double focal = 0.25 * (left.get_fx() + left.get_fy() + right.get_fx() + right.get_fy());
+    const CameraModel rectified(left.get_image_size(), focal, focal, 0.5 * (left.get_cx() + right.get_cx()),
+                                0.5 * (left.get_cy() + right.get_cy()));
+    m_rectified.left = rectified;
+    m_rectified.right = rectified;
+    m_rectified.right_R_left = Eigen::Matrix3d::Identity();
+    m_rectified.right_t_left = Eigen::Vector3d(-stereo.get_baseline(), 0.0, 0.0);
+    // Rectified cameras are the original ones rotated by camera_R_rectified
+    Eigen::Matrix4d left_T_rectified = Eigen::Matrix4d::Identity();
+    left_T_rectified.topLeftCorner<3, 3>() = m_rectified_R_left.transpose();
+    Eigen::Matrix4d right_T_rectified = Eigen::Matrix4d::Identity();
+    right_T_rectified.topLeftCorner<3, 3>() = R * m_rectified_R_left.transpose();
+    m_rectified.left.set_body_from_camera(left.get_body_from_camera() * left_T_rectified);
+    m_rectified.right.set_body_from_camera(right.get_body_from_camera() * right_T_rectified);
+
+    build_map(left, m_rectified_R_left.transpose(), rectified, m_left_map1, m_left_map2);
+    build_map(right, R * m_rectified_R_left.transpose(), rectified, m_right_map1, m_right_map2);
+
+    VIO_LOG_INFO("Stereo rectification: f = " << focal << " px, baseline " << stereo.get_baseline() << " m");
+}
+
+void StereoRectifier::build_map(const CameraModel& camera, const Eigen::Matrix3d& camera_R_rectified,
+                                const CameraModel& rectified, cv::Mat& map1, cv::Mat& map2) {
+    // Source pixel of every rectified pixel: back-project, rotate, re-distort
+    const cv::Size size = rectified.get_image_size();
+    cv::Mat map_x(size, CV_32FC1), map_y(size, CV_32FC1);
+    for (int v = 0; v < size.height; ++v) {
+        float* row_x = map_x.ptr<float>(v);
+        float* row_y = map_y.ptr<float>(v);
+        for (int u = 0; u < size.width; ++u) {
+            const Eigen::Vector3d ray = camera_R_rectified * Eigen::Vector3d((u - rectified.get_cx()) / rectified.get_fx(),
+                                                                             (v - rectified.get_cy()) / rectified.get_fy(),
+                                                                             1.0);
+            if (ray.z() <= 0.0) {
+                row_x[u] = -1.0f;
+                row_y[u] = -1.0f;
+                continue;
+            }
+            const cv::Point2f source = camera.project(cv::Point2f(static_cast<float>(ray.x() / ray.z()),
+                                                                  static_cast<float>(ray.y() / ray.z())));
+            row_x[u] = source.x;
+            row_y[u] = source.y;
+        }
+    }
+    cv::convertMaps(map_x, map_y, map1, map2, CV_16SC2);
+}
+
+void StereoRectifier::rectify_left(const cv::Mat& src, cv::Mat& dst) const {
+    VIO_PROFILE_SCOPE("rectify");
+    cv::remap(src, dst, m_left_map1, m_left_map2, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+}
+
+void StereoRectifier::rectify_right(const cv::Mat& src, cv::Mat& dst) const {
+    VIO_PROFILE_SCOPE("rectify");
+    cv::remap(src, dst, m_right_map1, m_right_map2, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+}
+
+void StereoRectifier::rectify_rows(int camera, const cv::Mat& src, cv::Mat& dst, int row_begin, int row_end) const {
+    const cv::Mat& map1 = camera == 0 ? m_left_map1 : m_right_map1;
+    const cv::Mat& map2 = camera == 0 ? m_left_map2 : m_right_map2;
+    cv::Mat rows = dst.rowRange(row_begin, row_end);
+    cv::remap(src, rows, map1.rowRange(row_begin, row_end), map2.rowRange(row_begin, row_end), cv::INTER_LINEAR,
+              cv::BORDER_REPLICATE);
+}
+
+} // namespace lightweight_vio
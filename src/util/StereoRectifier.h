@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <Eigen/Dense>
+#include "CameraModel.h"
+
+namespace lightweight_vio {
+
+// Rectification of a calibrated stereo rig. Both cameras are rotated to a
+// common orientation whose x axis is the baseline, and resampled to one
+// distortion-free pinhole camera, so matches lie on the same image row. The
+// remap tables are built once (fixed-point, for cv::remap's fast path).
+class StereoRectifier {
+public:
+    StereoRectifier() = default;
+    explicit StereoRectifier(const StereoCamera& stereo);
+
+    bool is_valid() const { return !m_left_map1.empty(); }
+
+    // Pinhole rig of the rectified images: identical intrinsics, no distortion,
+    // right_R_left = I and right_t_left = (-baseline, 0, 0); body_from_camera
+    // includes the rectifying rotation
+    const StereoCamera& get_rectified_camera() const { return m_rectified; }
+    // Rotation from the original left camera frame to the rectified frame
+    const Eigen::Matrix3d& get_rectified_R_left() const { return m_rectified_R_left; }
+
+    // dst may not alias src
+    void rectify_left(const cv::Mat& src, cv::Mat& dst) const;
+    void rectify_right(const cv::Mat& src, cv::Mat& dst) const;
+    // Rows [row_begin, row_end) only, into an image of the rectified size
+    // (camera 0 = left, 1 = right); for block-wise processing
+    void rectify_rows(int camera, const cv::Mat& src, cv::Mat& dst, int row_begin, int row_end) const;
+
+private:
+    static void build_map(const CameraModel& camera, const Eigen::Matrix3d& camera_R_rectified,
+                          const CameraModel& rectified, cv::Mat& map1, cv::Mat& map2);
+
+    StereoCamera m_rectified;
+    Eigen::Matrix3d m_rectified_R_left = Eigen::Matrix3d::Identity();
+    cv::Mat m_left_map1, m_left_map2;
+    cv::Mat m_right_map1, m_right_map2;
+};
+
+} // namespace lightweight_vio
@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+namespace lightweight_vio {
+
+namespace {
+// Set while this thread is executing pool tasks (nested parallel_for runs inline)
+thread_local bool t_in_pool_task = false;
+}
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    m_workers.reserve(num_threads);
+    for (size_t i = 0; i < num_threads; ++i) {
+        m_workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_cv.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t count, Invoker invoke, const void* callable) {
+    if (count == 0) {
+        return;
+    }
+    if (m_workers.empty() || count == 1 || t_in_pool_task) {
+        for (size_t i = 0; i < count; ++i) {
+            invoke(callable, i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit_lock(m_submit_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_invoke = invoke;
+        m_fn = callable;
+        m_count = count;
+        m_next_index.store(0, std::memory_order_relaxed);
+        m_completed = 0;
+        m_generation++;
+    }
+    m_work_cv.notify_all();
+
+    run_indices();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this] { return m_completed == m_count && m_active_workers == 0; });
+    m_fn = nullptr;
+    m_invoke = nullptr;
+}
+
+void ThreadPool::run_indices() {
+    // m_invoke/m_fn/m_count are stable while the job is active (writes happen
+    // under m_mutex before workers are woken)
+    bool was_in_task = t_in_pool_task;
+    t_in_pool_task = true;
+
+    size_t done = 0;
+    while (true) {
+        size_t index = m_next_index.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_count) break;
+        m_invoke(m_fn, index);
+        done++;
+    }
+
+    t_in_pool_task = was_in_task;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_completed += done;
+    if (m_completed == m_count) {
+        m_done_cv.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop() {
+    uint64_t seen_generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_work_cv.wait(lock, [&] { return m_stopping || m_generation != seen_generation; });
+        if (m_stopping) {
+            return;
+        }
+        seen_generation = m_generation;
+        if (!m_fn) {
+            continue; // Woke after the job already finished
+        }
+
+        m_active_workers++;
+        lock.unlock();
+        run_indices();
+        lock.lock();
+        m_active_workers--;
+        if (m_active_workers == 0 && m_completed == m_count) {
+            m_done_cv.notify_all();
+        }
+    }
+}
+
+} // namespace lightweight_vio
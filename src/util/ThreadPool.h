@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lightweight_vio {
+
+// Fixed-size worker pool for data-parallel loops. parallel_for() blocks until
+// every index has run; the calling thread takes indices too, so a pool of N
+// threads gives N + 1-way parallelism. Calls from several threads are
+// serialized, and a parallel_for issued from inside a task runs inline.
+// The callable is referenced, not copied, so lambdas with large captures cost
+// no heap allocation per call.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t get_num_threads() const { return m_workers.size(); }
+
+    // Run fn(i) for i in [0, count). Indices are handed out dynamically, so
+    // fn must not depend on which thread runs which index.
+    template<typename Fn>
+    void parallel_for(size_t count, const Fn& fn) {
+        run(count, [](const void* callable, size_t index) { (*static_cast<const Fn*>(callable))(index); }, &fn);
+    }
+
+private:
+    using Invoker = void (*)(const void* callable, size_t index);
+
+    void run(size_t count, Invoker invoke, const void* callable);
+    void worker_loop();
+    void run_indices();
+
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_submit_mutex;           // One parallel_for at a time
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    std::condition_variable m_done_cv;
+
+    // Current job (guarded by m_mutex, indices claimed atomically)
+    Invoker m_invoke = nullptr;
+    const void* m_fn = nullptr;
+    size_t m_count = 0;
+    std::atomic<size_t> m_next_index{0};
+    size_t m_completed = 0;
+    size_t m_active_workers = 0;
+    uint64_t m_generation = 0;
+    bool m_stopping = false;
+};
+
+} // namespace lightweight_vio
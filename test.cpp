@@ -1,74 +1,18 @@
 #include <opencv2/opencv.hpp>
 #include <iostream>
-#include <fstream>
 #include <string>
 #include <vector>
-#include <sstream>
 #include <memory>
 #include <chrono>
 
 #include "src/database/Frame.h"
 #include "src/database/Feature.h"
 #include "src/module/FeatureTracker.h"
+#include "src/dataset/DatasetReader.h"
+#include "src/util/Logger.h"
 
 using namespace lightweight_vio;
 
-struct ImageData {
-    long long timestamp;
-    std::string filename;
-};
-
-// Helper function to trim whitespace
-std::string trim(const std::string& str) {
-    size_t first = str.find_first_not_of(" \t\r\n");
-    if (first == std::string::npos) return "";
-    size_t last = str.find_last_not_of(" \t\r\n");
-    return str.substr(first, (last - first + 1));
-}
-
-std::vector<ImageData> load_image_timestamps(const std::string& dataset_path) {
-    std::vector<ImageData> image_data;
-    std::string data_file = dataset_path + "/mav0/cam0/data.csv";
-    
-    std::ifstream file(data_file);
-    if (!file.is_open()) {
-        std::cerr << "Cannot open data.csv file: " << data_file << std::endl;
-        return image_data;
-    }
-    
-    std::string line;
-    std::getline(file, line); // Skip header
-    
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        
-        std::stringstream ss(line);
-        std::string timestamp_str, filename;
-        
-        if (std::getline(ss, timestamp_str, ',') && std::getline(ss, filename)) {
-            ImageData data;
-            data.timestamp = std::stoll(trim(timestamp_str));
-            data.filename = trim(filename);
-            image_data.push_back(data);
-        }
-    }
-    
-    std::cout << "Loaded " << image_data.size() << " image timestamps" << std::endl;
-    return image_data;
-}
-
-cv::Mat load_image(const std::string& dataset_path, const std::string& filename, int cam_id = 0) {
-    std::string cam_folder = (cam_id == 0) ? "cam0" : "cam1";
-    std::string full_path = dataset_path + "/mav0/" + cam_folder + "/data/" + filename;
-    cv::Mat image = cv::imread(full_path, cv::IMREAD_GRAYSCALE);
-    
-    if (image.empty()) {
-        std::cerr << "Cannot load image: " << full_path << std::endl;
-    }
-    
-    return image;
-}
-
 int main(int argc, char* argv[]) {
     if (argc != 2) {
         std::cerr << "Usage: " << argv[0] << " <euroc_dataset_path>" << std::endl;
@@ -77,10 +21,15 @@ int main(int argc, char* argv[]) {
     }
     
     std::string dataset_path = argv[1];
+
+    // Interactive demo: keep the per-stage console output
+    Logger::set_level(LogLevel::Debug);
+
     std::cout << "Loading EuRoC dataset from: " << dataset_path << std::endl;
     
-    // Load image timestamps
-    std::vector<ImageData> image_data = load_image_timestamps(dataset_path);
+    // Load image timestamps; decoding and CLAHE run ahead on the reader's workers
+    DatasetReader reader(dataset_path);
+    const std::vector<ImageData>& image_data = reader.get_image_data();
     if (image_data.empty()) {
         std::cerr << "No images found in dataset" << std::endl;
         return -1;
@@ -107,6 +56,9 @@ int main(int argc, char* argv[]) {
     std::cout << "  's': toggle stereo matching view" << std::endl;
     
     cv::namedWindow("Lightweight VIO - Feature Tracking", cv::WINDOW_AUTOSIZE);
+
+    StereoImageData stereo_data;
+    bool has_stereo_data = false;
     
     while (true) {
         if (current_idx < 0) current_idx = 0;
@@ -118,34 +70,37 @@ int main(int argc, char* argv[]) {
             }
         }
         
-        // Load stereo images
-        cv::Mat left_image = load_image(dataset_path, image_data[current_idx].filename, 0);
-        cv::Mat right_image = load_image(dataset_path, image_data[current_idx].filename, 1);
+        // Fetch stereo images: sequential steps pop the prefetch queue, jumps re-seek the reader
+        size_t wanted_idx = static_cast<size_t>(current_idx);
+        if (!has_stereo_data || stereo_data.index != wanted_idx) {
+            if (!has_stereo_data || wanted_idx != stereo_data.index + 1) {
+                reader.seek(wanted_idx);
+            }
+            if (!reader.pop(stereo_data)) {
+                break;
+            }
+            has_stereo_data = true;
+        }
         
-        if (left_image.empty()) {
+        if (stereo_data.left_image.empty()) {
             current_idx++;
             continue;
         }
         
-        // Image preprocessing for left image
-        cv::Mat processed_left_image;
-        cv::Ptr<cv::CLAHE> clahe = cv::createCLAHE(2.0, cv::Size(8, 8));
-        clahe->apply(left_image, processed_left_image);
-        
-        // Image preprocessing for right image (if available)
-        cv::Mat processed_right_image;
-        if (!right_image.empty()) {
-            clahe->apply(right_image, processed_right_image);
-        }
+        // Images arrive already CLAHE-equalized, in buffers only we reference.
+        // stereo_data may be shown again (paused), so the frame shares them
+        // (header copies) instead of taking them over; nothing writes to them.
+        cv::Mat processed_left_image = stereo_data.left_image;
+        cv::Mat processed_right_image = stereo_data.right_image;
         
         // Create current frame with stereo images
         auto frame_start = std::chrono::high_resolution_clock::now();
         
         auto current_frame = std::make_shared<Frame>(image_data[current_idx].timestamp, current_idx);
         if (!processed_right_image.empty()) {
-            current_frame->set_stereo_images(processed_left_image, processed_right_image);
+            current_frame->set_stereo_images(std::move(processed_left_image), std::move(processed_right_image));
         } else {
-            current_frame->set_left_image(processed_left_image);
+            current_frame->set_left_image(std::move(processed_left_image));
         }
         
         // Track features